@@ -23,14 +23,47 @@
 #include <exception>
 #include <memory>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <set>
 #include <string>
 #include <utility>
+#include <tuple>
+#include <iterator>
+#include <limits>
+#include <initializer_list>
+#include <type_traits>
+#include <algorithm>
+#include <functional>
+#include <deque>
 #include <iostream>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#if __cplusplus >= 201703L
+    #include <string_view>
+    #if defined(__has_include)
+        #if __has_include(<charconv>)
+            #include <charconv>
+        #endif
+    #endif
+#endif
+#ifdef TINYJSON_PROFILE
+    #include <chrono>
+    #if defined(__x86_64__) || defined(__i386__)
+        #include <x86intrin.h>
+    #elif defined(_M_X64) || defined(_M_IX86)
+        #include <intrin.h>
+    #endif
+#endif
 
 #include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define THROW_JSON_EXCEPTION(THE_MESSAGE__)	{throw std::runtime_error("Tiny Json EXCEPTION At: " + std::to_string(__LINE__) + " In " + std::string(__FILE__) + " : " + std::string(THE_MESSAGE__));}
 
@@ -81,11 +114,407 @@ inline std::string JsonValueTypeToString(JsonValueType pType)
     THROW_JSON_EXCEPTION("JsonValueTypeToString passed an unknown type value");
 }
 
+/**
+ * @brief Appends pString to rOutput as the inside of a json string, quotes, back slashes and control characters are escaped.
+ * Everything else, including utf8, is copied as is. Runs of characters that need nothing doing are appended in one go.
+ */
+inline void JsonEscapeString(std::string& rOutput,const char* pString,size_t pLength)
+{
+    static const char HEX[] = "0123456789abcdef";
+    const char* run = pString;
+    const char* const end = pString + pLength;
+    for( const char* c = pString ; c < end ; c++ )
+    {
+        const unsigned char ch = (unsigned char)*c;
+        if( ch >= 0x20 && ch != '\"' && ch != '\\' )
+        {
+            continue;
+        }
+
+        rOutput.append(run,c - run);
+        run = c + 1;
+        rOutput += '\\';
+        switch( ch )
+        {
+        case '\"':  rOutput += '\"'; break;
+        case '\\':  rOutput += '\\'; break;
+        case '\b':  rOutput += 'b'; break;
+        case '\f':  rOutput += 'f'; break;
+        case '\n':  rOutput += 'n'; break;
+        case '\r':  rOutput += 'r'; break;
+        case '\t':  rOutput += 't'; break;
+        default:
+            rOutput += "u00";
+            rOutput += HEX[ch >> 4];
+            rOutput += HEX[ch & 15];
+            break;
+        }
+    }
+    rOutput.append(run,end - run);
+}
+
+/**
+ * @brief Appends the inside of a json string to rOutput with the escapes turned back into the characters they stand for, \u escapes become utf8.
+ * The escapes the parser allows that json does not have, \a \v and \e, become their c characters.
+ */
+inline void JsonUnescapeString(std::string& rOutput,const char* pString,size_t pLength)
+{
+    const char* const end = pString + pLength;
+    auto readHex = [end](const char* pHex)
+    {
+        if( end - pHex < 4 )
+        {
+            THROW_JSON_EXCEPTION("Json string has a \\u escape without four hex digits");
+        }
+        uint32_t code = 0;
+        for( int n = 0 ; n < 4 ; n++ )
+        {
+            const char c = pHex[n];
+            const uint32_t digit = (c >= '0' && c <= '9') ? uint32_t(c - '0') : (c >= 'a' && c <= 'f') ? uint32_t(c - 'a' + 10) : (c >= 'A' && c <= 'F') ? uint32_t(c - 'A' + 10) : 16;
+            if( digit > 15 )
+            {
+                THROW_JSON_EXCEPTION("Json string has a \\u escape without four hex digits");
+            }
+            code = (code << 4) | digit;
+        }
+        return code;
+    };
+
+    const char* run = pString;
+    for( const char* c = pString ; c < end ; c++ )
+    {
+        if( *c != '\\' )
+        {
+            continue;
+        }
+
+        rOutput.append(run,c - run);
+        if( ++c == end )
+        {
+            THROW_JSON_EXCEPTION("Json string ends with an escape");
+        }
+
+        switch( *c )
+        {
+        case 'a': rOutput += '\a'; break;
+        case 'b': rOutput += '\b'; break;
+        case 'e': rOutput += '\x1b'; break;
+        case 'f': rOutput += '\f'; break;
+        case 'n': rOutput += '\n'; break;
+        case 'r': rOutput += '\r'; break;
+        case 't': rOutput += '\t'; break;
+        case 'v': rOutput += '\v'; break;
+        case 'u':
+            {
+                uint32_t code = readHex(c + 1);
+                c += 4;
+                // A high surrogate followed by a low one is a single character outside of the first 64K.
+                if( code >= 0xd800 && code < 0xdc00 && end - c > 6 && c[1] == '\\' && c[2] == 'u' )
+                {
+                    const uint32_t low = readHex(c + 3);
+                    if( low >= 0xdc00 && low < 0xe000 )
+                    {
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                        c += 6;
+                    }
+                }
+
+                if( code < 0x80 )
+                {
+                    rOutput += char(code);
+                }
+                else if( code < 0x800 )
+                {
+                    rOutput += char(0xc0 | (code >> 6));
+                    rOutput += char(0x80 | (code & 0x3f));
+                }
+                else if( code < 0x10000 )
+                {
+                    rOutput += char(0xe0 | (code >> 12));
+                    rOutput += char(0x80 | ((code >> 6) & 0x3f));
+                    rOutput += char(0x80 | (code & 0x3f));
+                }
+                else
+                {
+                    rOutput += char(0xf0 | (code >> 18));
+                    rOutput += char(0x80 | ((code >> 12) & 0x3f));
+                    rOutput += char(0x80 | ((code >> 6) & 0x3f));
+                    rOutput += char(0x80 | (code & 0x3f));
+                }
+            }
+            break;
+
+        default: // \" \\ \/ and anything else stand for themselves.
+            rOutput += *c;
+            break;
+        }
+        run = c + 1;
+    }
+    rOutput.append(run,end - run);
+}
+
+#ifndef __cpp_lib_to_chars
+/**
+ * @brief Rounds pText, a number written with %.16e, to pDigits digits in the same form. Returns false when that could round the
+ * other way from rounding the double itself, a 5 followed by zeros, or when it rounds up to another power of ten.
+ */
+inline bool JsonRoundDigits(const char* pText,int pDigits,char* rRounded)
+{
+    char digits[18];
+    digits[0] = pText[0];
+    memcpy(digits + 1,pText + 2,16);
+    digits[17] = 0;
+    const char* exponent = pText + 18;
+
+    if( digits[pDigits] == '5' && strspn(digits + pDigits + 1,"0") >= size_t(16 - pDigits) )
+    {
+        return false;
+    }
+    if( digits[pDigits] >= '5' )
+    {
+        int n = pDigits - 1;
+        for( ; n >= 0 && digits[n] == '9' ; n-- )
+        {
+            digits[n] = '0';
+        }
+        if( n < 0 )
+        {
+            return false;
+        }
+        digits[n]++;
+    }
+
+    char* out = rRounded;
+    *out++ = digits[0];
+    if( pDigits > 1 )
+    {
+        *out++ = '.';
+        memcpy(out,digits + 1,pDigits - 1);
+        out += pDigits - 1;
+    }
+    strcpy(out,exponent);
+    return true;
+}
+#endif
+
+/**
+ * @brief Puts the fewest digits that read back as pValue, a float or double that is not negative, into rDigits without trailing zeros and
+ * returns how many. rPoint is set so the value is 0.digits times ten to the power of rPoint. rDigits needs room for 17 digits.
+ * Used by JsonAppendNumber and the canonical writer, so there is one answer to how a number is written.
+ */
+template<typename T>
+inline size_t JsonShortestDigits(T pValue,char* rDigits,int64_t& rPoint)
+{
+    rPoint = 0;
+    if( pValue == 0 )
+    {
+        return 0;
+    }
+
+    char text[40];
+#ifdef __cpp_lib_to_chars
+    *std::to_chars(text,text + sizeof(text) - 1,pValue,std::chars_format::scientific).ptr = 0;
+#else
+    // max_digits10 digits always read back the same. When digits10 do any fewer that would are those digits with the zeros taken off,
+    // except for numbers too small to be normal that have fewer bits. The shorter ones are made by rounding 17 as printf is slow.
+    const bool isFloat = std::is_same<T,float>::value;
+    const int maxDigits = std::numeric_limits<T>::max_digits10;
+    snprintf(text,sizeof(text),"%.16e",(double)pValue);
+    for( int digits = pValue < std::numeric_limits<T>::min() ? 1 : std::numeric_limits<T>::digits10 ; digits <= maxDigits ; digits++ )
+    {
+        char shorter[40];
+        if( !JsonRoundDigits(text,digits,shorter) )
+        {
+            snprintf(shorter,sizeof(shorter),"%.*e",digits - 1,(double)pValue);
+        }
+        if( digits == maxDigits || (isFloat ? (T)strtof(shorter,nullptr) : (T)strtod(shorter,nullptr)) == pValue )
+        {
+            memcpy(text,shorter,sizeof(text));
+            break;
+        }
+    }
+#endif
+
+    // The text is d.ddde+x, with the point left out when there is one digit.
+    size_t count = 0;
+    const char* c = text;
+    for( ; *c != 'e' ; c++ )
+    {
+        if( *c != '.' )
+        {
+            rDigits[count++] = *c;
+        }
+    }
+    rPoint = atoi(c + 1) + 1;
+    while( count > 1 && rDigits[count - 1] == '0' )
+    {
+        count--;
+    }
+    return count;
+}
+
+/**
+ * @brief Appends the number as json text, used by the JsonValue constructors and the writers so numbers always look the same.
+ * Floating point values use the fewest digits that read back as the same value, 0.1 and not 0.100000.
+ * Json has no infinity or nan, so they throw.
+ */
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_same<T,bool>::value>::type JsonAppendNumber(std::string& rOutput,T pValue)
+{
+    char digits[24];
+    char* pos = digits + sizeof(digits);
+    // Work with the magnitude as unsigned so the most negative value does not overflow.
+    unsigned long long magnitude = (unsigned long long)pValue;
+    const bool negative = pValue < 0;
+    if( negative )
+    {
+        magnitude = 0ULL - magnitude;
+    }
+
+    do
+    {
+        *--pos = char('0' + magnitude % 10);
+        magnitude /= 10;
+    }while( magnitude > 0 );
+
+    if( negative )
+    {
+        *--pos = '-';
+    }
+    rOutput.append(pos,digits + sizeof(digits) - pos);
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type JsonAppendNumber(std::string& rOutput,T pValue)
+{
+    if( !isfinite(pValue) )
+    {
+        THROW_JSON_EXCEPTION("Infinity and nan can not be written as json numbers");
+    }
+
+    char digits[17];
+    int64_t point;
+    const size_t count = JsonShortestDigits(pValue < 0 ? -pValue : pValue,digits,point);
+    if( signbit(pValue) )
+    {
+        rOutput += '-';
+    }
+    if( count == 0 )
+    {
+        rOutput += '0';
+        return;
+    }
+
+    // Laid out as %g would with the precision it was written with before, digits10 or more, so numbers that were already short look the same.
+    const int64_t exponent = point - 1;
+    if( exponent < -4 || exponent >= std::max<int64_t>(int64_t(count),std::numeric_limits<T>::digits10) )
+    {
+        rOutput += digits[0];
+        if( count > 1 )
+        {
+            rOutput += '.';
+            rOutput.append(digits + 1,count - 1);
+        }
+        rOutput += exponent < 0 ? "e-" : "e+";
+        if( exponent > -10 && exponent < 10 )
+        {
+            rOutput += '0';
+        }
+        JsonAppendNumber(rOutput,exponent < 0 ? -exponent : exponent);
+    }
+    else if( point <= 0 )
+    {
+        rOutput += "0.";
+        rOutput.append(size_t(-point),'0');
+        rOutput.append(digits,count);
+    }
+    else if( point >= int64_t(count) )
+    {
+        rOutput.append(digits,count);
+        rOutput.append(size_t(point) - count,'0');
+    }
+    else
+    {
+        rOutput.append(digits,size_t(point));
+        rOutput += '.';
+        rOutput.append(digits + point,count - size_t(point));
+    }
+}
+
+/**
+ * @brief A quick 64 bit hash of a block of memory, reads eight bytes at a time, for whole documents where FNV-1a a byte at a time would be slow.
+ * Not for security, anyone can make two inputs with the same hash.
+ */
+inline uint64_t JsonHashBytes(const void* pData,size_t pLength,uint64_t pSeed = 0)
+{
+    const uint64_t MULTIPLY = 0x9e3779b97f4a7c15ULL;
+    auto mix = [](uint64_t pWord)
+    {
+        pWord *= 0xbf58476d1ce4e5b9ULL;
+        return pWord ^ (pWord >> 31);
+    };
+
+    const unsigned char* bytes = (const unsigned char*)pData;
+    uint64_t hash = pSeed ^ (pLength * MULTIPLY);
+    for( ; pLength >= 8 ; pLength -= 8, bytes += 8 )
+    {
+        uint64_t word;
+        memcpy(&word,bytes,sizeof(word));
+        hash = (hash ^ mix(word)) * MULTIPLY;
+    }
+    uint64_t word = 0;
+    memcpy(&word,bytes,pLength);
+    hash = (hash ^ mix(word)) * MULTIPLY;
+    return mix(hash ^ (hash >> 29));
+}
+
 /**
  * @brief The key value pairs of a json object.
  */
 typedef std::map<std::string,struct JsonValue> JsonKeyValue;
 
+/**
+ * @brief How much memory a tree uses, from JsonValue::MemoryUsage. Use it to size a cache of parsed documents by memory.
+ * The bytes are worked out from the sizes and capacities of the containers, so are what the tree asked for, the heap will round some of it up.
+ */
+struct JsonMemoryUsage
+{
+    size_t mObjects = 0;
+    size_t mArrays = 0;
+    size_t mStrings = 0;
+    size_t mNumbers = 0;
+    size_t mBooleans = 0;
+    size_t mNulls = 0;
+
+    size_t mValueBytes = 0;     //!< The JsonValues, as the root, in the storage of arrays, by capacity, and in the map nodes of objects.
+    size_t mStringBytes = 0;    //!< The text of strings and numbers too long to fit inside their std::string.
+    size_t mKeyBytes = 0;       //!< The text of keys too long to fit inside their std::string.
+
+    size_t GetValueCount()const{return mObjects + mArrays + mStrings + mNumbers + mBooleans + mNulls;}
+    size_t GetTotalBytes()const{return mValueBytes + mStringBytes + mKeyBytes;}
+};
+
+/**
+ * @brief True for containers that JsonValue can be built from, anything that works with std::begin and std::end that is not a string.
+ */
+template<typename T,typename = void> struct IsJsonRange : std::false_type{};
+template<typename T> struct IsJsonRange<T,decltype(void(std::begin(std::declval<T&>())),void(std::end(std::declval<T&>())))> :
+    std::integral_constant<bool,!std::is_constructible<std::string,T>::value && !std::is_same<typename std::decay<T>::type,struct JsonValue>::value>{};
+
+/**
+ * @brief True for iterators that JsonValue can be built from, char pointers are left out so they are not mistaken for a range of json values.
+ */
+template<typename T,typename = void> struct IsJsonIterator : std::false_type{};
+template<typename T> struct IsJsonIterator<T,decltype(void(*std::declval<T&>()),void(++std::declval<T&>()),void(std::declval<T&>() != std::declval<T&>()))> :
+    std::integral_constant<bool,!std::is_convertible<T,const char*>::value>{};
+
+/**
+ * @brief True for elements that have a first that can be a key and a second, these make an object and not an array.
+ */
+template<typename T,typename = void> struct IsJsonKeyValue : std::false_type{};
+template<typename T> struct IsJsonKeyValue<T,decltype(void(std::declval<T&>().first),void(std::declval<T&>().second))> :
+    std::is_convertible<decltype(std::declval<T&>().first),std::string>{};
+
 /**
  * @brief This represents the core data structure that drives Json.
  * It forms the second part of 1 or more the key value pair that represents a Json object.
@@ -99,7 +528,7 @@ struct JsonValue
      */
     bool mBoolean = false;
 
-	JsonValueType mType;   //<! The type of the json value.
+	JsonValueType mType = JsonValueType::INVALID;   //<! The type of the json value.
 
 	/**
 	 * @brief I hold all number values as a string, this is because until the user asks I do not know what type they want it as.
@@ -120,42 +549,87 @@ struct JsonValue
      */
 	std::vector<struct JsonValue> mArray;
 
+    /**
+     * @brief The hash of an array or object, from UpdateHashes or a parse with JsonProcessor::EnableHashing, 0 if it has not been worked out.
+     * It is not kept up to date as the tree is changed. operator [], Emplace, EmplaceBack and the non const begin and end clear it, but only
+     * on the value they are called on. Writing through mArray or mObject, or through a reference kept from any of these, clears nothing,
+     * so after changing a tree that has hashes call UpdateHashes on every ancestor of what changed, or on the root.
+     */
+    uint64_t mHash = 0;
 
     JsonValue() = default;
     JsonValue(JsonValueType pType):mType(pType){}
 
-    JsonValue(bool pValue):mType(JsonValueType::BOOLEAN){mValue = pValue?"true":"false";}
-    JsonValue(const std::string& pValue):mType(JsonValueType::STRING){mValue = pValue;}
+    JsonValue(bool pValue):mBoolean(pValue),mType(JsonValueType::BOOLEAN){}
+    JsonValue(const std::string& pValue):mType(JsonValueType::STRING),mValue(pValue){}
+    JsonValue(std::string&& pValue):mType(JsonValueType::STRING),mValue(std::move(pValue)){}
+    JsonValue(const char* pValue):mType(JsonValueType::STRING),mValue(pValue){assert(pValue);}
+#if __cplusplus >= 201703L
+    JsonValue(std::string_view pValue):mType(JsonValueType::STRING),mValue(pValue){}
+#endif
 
-    #define MAKE_COPY_CONSTRUCTOR(CTYPE__,JTYPE__)  JsonValue(CTYPE__ pValue):mType(JsonValueType::JTYPE__){mValue = std::to_string(pValue);}
+    #define MAKE_COPY_CONSTRUCTOR(CTYPE__,JTYPE__)  JsonValue(CTYPE__ pValue):mType(JsonValueType::JTYPE__){JsonAppendNumber(mValue,pValue);}
         MAKE_COPY_CONSTRUCTOR(float,NUMBER)
         MAKE_COPY_CONSTRUCTOR(double,NUMBER)
         MAKE_COPY_CONSTRUCTOR(int,NUMBER)
+        MAKE_COPY_CONSTRUCTOR(uint32_t,NUMBER)
         MAKE_COPY_CONSTRUCTOR(uint64_t,NUMBER)
         MAKE_COPY_CONSTRUCTOR(int64_t,NUMBER)
     #undef MAKE_COPY_CONSTRUCTOR
 
-    JsonValue(const std::vector<std::string>& pStrings):mType(JsonValueType::ARRAY)
+    /**
+     * @brief Builds an array, or an object if the elements are key value pairs, from any container, std::vector, std::set, std::map, std::list, a c array...
+     * The elements can be anything a JsonValue can be made from, including more containers.
+     * When the container is passed as an rvalue the elements are moved out of it and not copied.
+     */
+    template<typename CONTAINER,typename = typename std::enable_if<IsJsonRange<CONTAINER>::value>::type>
+    JsonValue(CONTAINER&& pContainer)
     {
-        for( const auto& str : pStrings )
-        {
-            mArray.push_back(str);
-        }
+        AssignRange(std::begin(pContainer),std::end(pContainer),std::is_lvalue_reference<CONTAINER>());
+    }
+
+    /**
+     * @brief Builds an array, or an object if the elements are key value pairs, from an iterator range.
+     * Use std::make_move_iterator to move the elements in.
+     */
+    template<typename ITERATOR,typename = typename std::enable_if<IsJsonIterator<ITERATOR>::value>::type>
+    JsonValue(ITERATOR pBegin,ITERATOR pEnd)
+    {
+        AssignRange(pBegin,pEnd);
+    }
+
+    /**
+     * @brief Copies the whole tree. Done with a list of the values still to copy and not recursion, so any depth of tree can be copied.
+     */
+    JsonValue(const JsonValue& pOther)
+    {
+        CopyTree(pOther);
     }
 
-    JsonValue(const std::set<std::string>& pStrings):mType(JsonValueType::ARRAY)
+    JsonValue(JsonValue&& pOther) = default;
+
+    JsonValue& operator = (const JsonValue& pOther)
     {
-        for( const auto& str : pStrings )
+        if( this != &pOther )
         {
-            mArray.push_back(str);
+            JsonValue copy(pOther);
+            *this = std::move(copy);
         }
+        return *this;
     }
 
-    JsonValue(const std::map<std::string,std::string>& pStrings):mType(JsonValueType::OBJECT)
+    JsonValue& operator = (JsonValue&& pOther) = default;
+
+    /**
+     * @brief Frees the tree without recursion. Left to the std containers a tree a million deep would run out of stack,
+     * and a big one makes a call for every value. Here the values that have children of their own are moved onto a list and freed one at a time,
+     * the values with no children, nearly all of them, are freed by their array or object in one go.
+     */
+    ~JsonValue()
     {
-        for( const auto& str : pStrings )
+        if( mArray.size() > 0 || mObject.size() > 0 )
         {
-            mObject[str.first] = str.second;
+            FreeTree();
         }
     }
 
@@ -169,45 +643,26 @@ struct JsonValue
         return *this;
     }
 
-    JsonValue& operator = (const std::vector<std::string>& pStrings)
+    JsonValue& operator = (std::string&& pString)
     {
         // Can only assign when the type has not yet been set.
         TINYJSON_ASSERT_TYPE(JsonValueType::INVALID);
 
-        mType = JsonValueType::ARRAY;
-        for( const auto& s : pStrings )
-        {
-            mArray.push_back(s);
-        }
+        mType = JsonValueType::STRING;
+        mValue = std::move(pString);
         return *this;
     }
 
-    JsonValue& operator = (const std::set<std::string>& pStrings)
+    template<typename CONTAINER,typename = typename std::enable_if<IsJsonRange<CONTAINER>::value>::type>
+    JsonValue& operator = (CONTAINER&& pContainer)
     {
         // Can only assign when the type has not yet been set.
         TINYJSON_ASSERT_TYPE(JsonValueType::INVALID);
 
-        mType = JsonValueType::ARRAY;
-        for( const auto& s : pStrings )
-        {
-            mArray.push_back(s);
-        }
+        AssignRange(std::begin(pContainer),std::end(pContainer),std::is_lvalue_reference<CONTAINER>());
         return *this;
     }
 
-    JsonValue& operator = (const std::map<std::string,std::string>& pStrings)
-    {
-        // Can only assign when the type has not yet been set.
-        TINYJSON_ASSERT_TYPE(JsonValueType::INVALID);
-
-        mType = JsonValueType::OBJECT;
-        for( const auto& str : pStrings )
-        {
-            mObject[str.first] = str.second;
-        }
-        return *this;        
-    }
-
     /**
      * @brief This is a handy overload that allows you to do ["key1"]["key2"]["key3"].GetInt() type of thing.
      * throws std::runtime_error if key not found.
@@ -227,6 +682,7 @@ struct JsonValue
     JsonValue& operator [](const std::string& pKey)
     {
         TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);
+        mHash = 0;
         return mObject[pKey];
     }
     JsonValue& operator [](const char* pKey){assert(pKey);return (*this)[std::string(pKey)];}
@@ -250,10 +706,10 @@ struct JsonValue
      * E.G or(const auto &res : child.second)
      */
     const JsonKeyValue::const_iterator begin()const{TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);return mObject.cbegin();}
-    const JsonKeyValue::iterator begin(){TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);return mObject.begin();}
+    const JsonKeyValue::iterator begin(){TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);mHash = 0;return mObject.begin();}
 
     const JsonKeyValue::const_iterator end()const{TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);return mObject.cend();}
-    const JsonKeyValue::iterator end(){TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);return mObject.end();}
+    const JsonKeyValue::iterator end(){TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);mHash = 0;return mObject.end();}
 
     operator float()const{return GetFloat();} 
     operator double()const{return GetDouble();} 
@@ -268,75 +724,43 @@ struct JsonValue
 
     /**
      * Object has to either already be an object or be unitialsed for this to be valid. 
+     * The value is built in place in the object from the arguments, pass rvalues to have them moved in.
+     * With no value arguments an unset value is added that can then be filled in, Emplace("list").EmplaceBack(1)
+     * If the key is already there nothing is added. Returns the value for the key.
      */
-    void Emplace(const std::string& pKey,const JsonValue& pValue)
-    {
-        if( mType == JsonValueType::INVALID )
-        {
-            mType = JsonValueType::OBJECT;
-        }
-        else
-        {
-            TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);
-        }
-
-        mObject.emplace(pKey,pValue);
-    }
-
-    void Emplace(const std::string& pKey,const std::string& pValue)
-    {
-        if( mType == JsonValueType::INVALID )
-        {
-            mType = JsonValueType::OBJECT;
-        }
-        else
-        {
-            TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);
-        }
-
-        mObject.emplace(pKey,pValue);
-    }
-
-    void Emplace(const std::string& pKey,const std::vector<std::string>& pValues)
+    template<typename KEY,typename... ARGS>
+    JsonValue& Emplace(KEY&& pKey,ARGS&&... pArgs)
     {
-        if( mType == JsonValueType::INVALID )
-        {
-            mType = JsonValueType::OBJECT;
-        }
-        else
-        {
-            TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);
-        }
-
-        mObject.emplace(pKey,pValues);
+        SetTypeIfUnset(JsonValueType::OBJECT);
+        mHash = 0;
+        return mObject.emplace(std::piecewise_construct,std::forward_as_tuple(std::forward<KEY>(pKey)),std::forward_as_tuple(std::forward<ARGS>(pArgs)...)).first->second;
     }
 
-    void Emplace(const std::string& pKey,const std::set<std::string>& pValues)
+    /**
+     * Array has to either already be an array or be unitialsed for this to be valid. 
+     * Adds a value to the end built in place from the arguments, with no arguments it is an unset value to be filled in.
+     * Returns the new value, it is only valid until the array is next added to.
+     */
+    template<typename... ARGS>
+    JsonValue& EmplaceBack(ARGS&&... pArgs)
     {
-        if( mType == JsonValueType::INVALID )
-        {
-            mType = JsonValueType::OBJECT;
-        }
-        else
-        {
-            TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);
-        }
-
-        mObject.emplace(pKey,pValues);
+        SetTypeIfUnset(JsonValueType::ARRAY);
+        mHash = 0;
+        mArray.emplace_back(std::forward<ARGS>(pArgs)...);
+        return mArray.back();
     }
 
-    void Emplace(const std::string& pKey,const std::map<std::string,std::string>& pValues)
+    /**
+     * @brief Makes room for pCount array elements so filling the array does not reallocate, an unset value becomes an array.
+     * Objects are a std::map that allocates each entry as it is added, so for them there is nothing to reserve.
+     */
+    void Reserve(size_t pCount)
     {
-        if( mType == JsonValueType::INVALID )
-        {
-            mType = JsonValueType::OBJECT;
-        }
-        else
+        if( mType != JsonValueType::OBJECT )
         {
-            TINYJSON_ASSERT_TYPE(JsonValueType::OBJECT);
+            SetTypeIfUnset(JsonValueType::ARRAY);
+            mArray.reserve(pCount);
         }
-
-        mObject.emplace(pKey,pValues);
     }
 
    /**
@@ -507,496 +931,7839 @@ struct JsonValue
     MAKE_SAFE_FUNCTION(GetType,JsonValueType,JsonValueType::INVALID);
 #undef MAKE_SAFE_FUNCTION
 
-private:
-};
-
-/**
- * @brief This is the work horse that builds our data structure that mirrors the json data.
- */
-class JsonProcessor
-{
-public:
     /**
-     * @brief Construct a new Json Processor object and parse the json data.
-     * throws std::runtime_error if the json is not constructed correctly.
-     * If pFailOnDuplicateKeys is true and two keys at the same level are found to have the same name then we'll throw an exception.
+     * @brief A hash of the value that is the same for values that are equal by operator ==, for putting trees in a std::unordered_set with JsonValueHash.
+     * Numbers are hashed by their value, 1, 1.0 and 10e-1 hash the same, strings and keys by their text with the escapes turned back into characters,
+     * and an object by its entries in any order. Uses mHash where it has been worked out, otherwise walks the tree, without recursion.
      */
-	JsonProcessor(const std::string& pJsonString,bool pFailOnDuplicateKeys = false) :
-        mFailOnDuplicateKeys(pFailOnDuplicateKeys),
-        mJsonEnd(pJsonString.c_str() + pJsonString.size()),
-        mPos(pJsonString.c_str())
+    uint64_t GetHash()const
     {
-        mRow = mColumn = 1;
-
-        if( pJsonString.size() < 2 )
-        {
-            THROW_JSON_EXCEPTION("Empty string passed into ParseJson");
-        }
-
-        MakeValue(mRoot); // Now lets get going. :D
-        SkipWhiteSpace();
-        if( mPos < mJsonEnd )// Now should be at the end
-        {
-            THROW_JSON_EXCEPTION("Data found after root object, invalid Json");
-        }
-    }
+        return HashTree(*this,[](const JsonValue& pValue){return pValue.mHash;},[](const JsonValue&,uint64_t){});
+    }
 
     /**
-     * @brief Get the Root object
+     * @brief Works out mHash for every array and object from here down, so GetHash and operator == do not have to walk them again.
+     * The values with no children are quicker to hash again than to look up, so they do not keep one.
      */
-    const JsonValue& GetRoot()const
+    void UpdateHashes()
     {
-        return mRoot;
+        HashTree(*this,[](const JsonValue&){return uint64_t(0);},[](const JsonValue& pValue,uint64_t pHash){const_cast<JsonValue&>(pValue).mHash = pHash;});
     }
 
     /**
-     * Convenient way to access values in the root object.
-    */
-    const JsonValue& operator [](const std::string& pKey)const
+     * @brief Compares two trees by what they hold and not how it was written. Numbers are equal if they have the same value, strings and keys
+     * if they have the same text once unescaped, and objects if they have the same entries. Where both sides have mHash and they differ
+     * the compare stops there without looking inside. Done with a list of the values still to compare, so trees of any depth can be compared.
+     */
+    bool operator == (const JsonValue& pOther)const
     {
-        return GetRoot()[pKey];
-    }
+        std::vector<std::pair<const JsonValue*,const JsonValue*>> pending(1,std::make_pair(this,&pOther));
+        while( pending.size() > 0 )
+        {
+            const JsonValue& a = *pending.back().first;
+            const JsonValue& b = *pending.back().second;
+            pending.pop_back();
+            if( &a == &b )
+            {
+                continue;
+            }
+            if( a.mType != b.mType || (a.mHash != 0 && b.mHash != 0 && a.mHash != b.mHash) )
+            {
+                return false;
+            }
 
-private:
-    const bool mFailOnDuplicateKeys;    //!< If true and two keys at the same level are found to have the same name then we'll throw an exception.
-    const char* const mJsonEnd;         //!< Used to detect when we're at the end of the data.
-    const char* mPos;                   //!< The current position in the data that we are at.  
-    JsonValue mRoot;                    //!< When all is done, this contains the json as usable c++ objects.
-    uint32_t mRow,mColumn;              //!< Keeps track of where we are in the file for error reporting to the user.
+            switch( a.mType )
+            {
+            case JsonValueType::NUMBER:
+                if( !SameNumber(a.mValue,b.mValue) )
+                {
+                    return false;
+                }
+                break;
 
-    /**
-     * @brief This will advance to next char and deal with line and colum tracking as we go.
-     * It was optional, with a version that just incremented mPos. Made little difference to speed when reading massive 2MB file.
-     * So is on all the time now as makes code cleaning and the class easier to use.
-     * Remember, trust your compiler. NextChar will compile into a few instructions. This has been check in compiler explorer.  https://godbolt.org/
-     */
-    inline void NextChar(){mPos++;if(*mPos == '\n'){mRow++;mColumn=1;}else{mColumn++;}}
+            case JsonValueType::STRING:
+                if( !SameText(a.mValue,b.mValue) )
+                {
+                    return false;
+                }
+                break;
 
-    /**
-     * @brief This is used in several place whilst parsing the data to detect json data that is not complete.
-     * For safety does not test for NULL but checks that the mPos pointer has not gone past the end of the data.
-     */
-    inline void AssertMoreData(const char* pErrorString)
+            case JsonValueType::BOOLEAN:
+                if( a.mBoolean != b.mBoolean )
+                {
+                    return false;
+                }
+                break;
+
+            case JsonValueType::ARRAY:
+                if( a.mArray.size() != b.mArray.size() )
+                {
+                    return false;
+                }
+                for( size_t n = 0 ; n < a.mArray.size() ; n++ )
+                {
+                    pending.emplace_back(&a.mArray[n],&b.mArray[n]);
+                }
+                break;
+
+            case JsonValueType::OBJECT:
+                if( a.mObject.size() != b.mObject.size() || !PairEntries(a.mObject,b.mObject,pending) )
+                {
+                    return false;
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool operator != (const JsonValue& pOther)const
     {
-        if( mPos >= mJsonEnd ){THROW_JSON_EXCEPTION(pErrorString);}
+        return !(*this == pOther);
     }
 
     /**
-     * @brief Used to check that the expected charater is the correct one, if not tells the user!
+     * @brief Counts the values in the tree from here down, by type, and the memory they use. Walks the whole tree, so is not free for big trees.
      */
-    inline void AssertCorrectChar(char c,const char* pErrorString)
+    JsonMemoryUsage MemoryUsage()const
     {
-        if( *mPos != c )
+        JsonMemoryUsage usage;
+        usage.mValueBytes = sizeof(JsonValue);
+        std::vector<const JsonValue*> pending(1,this);
+        while( pending.size() > 0 )
         {
-            THROW_JSON_EXCEPTION(GetErrorPos() + pErrorString);
+            const JsonValue& value = *pending.back();
+            pending.pop_back();
+            switch( value.mType )
+            {
+            case JsonValueType::OBJECT:     usage.mObjects++;   break;
+            case JsonValueType::ARRAY:      usage.mArrays++;    break;
+            case JsonValueType::STRING:     usage.mStrings++;   break;
+            case JsonValueType::NUMBER:     usage.mNumbers++;   break;
+            case JsonValueType::BOOLEAN:    usage.mBooleans++;  break;
+            case JsonValueType::NULL_VALUE: usage.mNulls++;     break;
+            default: break;
+            }
+
+            usage.mStringBytes += GetHeapBytes(value.mValue);
+            usage.mValueBytes += value.mArray.capacity() * sizeof(JsonValue) + value.mObject.size() * GetEntryBytes();
+            for( const auto& element : value.mArray )
+            {
+                pending.push_back(&element);
+            }
+            for( const auto& entry : value.mObject )
+            {
+                usage.mKeyBytes += GetHeapBytes(entry.first);
+                pending.push_back(&entry.second);
+            }
         }
+        return usage;
     }
 
     /**
-     * @brief Returns a string used in errors to show where the error is.
+     * @brief The memory the text of a string has taken from the heap, none if it is short enough to fit inside the std::string.
      */
-    inline std::string GetErrorPos()
+    static size_t GetHeapBytes(const std::string& pString)
     {
-        return std::string("Error at Line ") + std::to_string(mRow) + " column " + std::to_string(mColumn) + " : ";
+        return pString.capacity() > std::string().capacity() ? pString.capacity() + 1 : 0;
     }
 
     /**
-     * @brief Builds a Json object, which is a map of key value paris.
-     * Constructed in this way to reduce copy by value which is what you would get by returning the completed object. That would be horrendous.
-     * @param rObject The json object that is to be built.
+     * @brief Roughly the size of the map node of an object entry, the key and value and the links of the tree.
      */
-    void MakeObject(JsonKeyValue& rObject)
+    static size_t GetEntryBytes()
     {
-        // Search for the start of the object.
-        SkipWhiteSpace();
-        AssertCorrectChar('{',"Start of object not found, invalid Json");
-        do
+        return sizeof(JsonKeyValue::value_type) + 4 * sizeof(void*);
+    }
+
+private:
+    friend class JsonProcessor;
+    friend class JsonDiff;
+    friend class JsonStreamWriter;
+    friend class JsonSchema;
+
+    /**
+     * @brief Hashes the tree from pRoot down without recursion, each array and object is finished once all its children have been.
+     * pLookup gives the hash of a value if it is already known, 0 if not, and those values are not gone into.
+     * pStore is given each array and object that is worked out, with its hash, so it can be kept.
+     */
+    template<typename LOOKUP,typename STORE>
+    static uint64_t HashTree(const JsonValue& pRoot,LOOKUP&& pLookup,STORE&& pStore)
+    {
+        const uint64_t known = pLookup(pRoot);
+        if( known != 0 )
         {
-            const char previousChar = mPos[0];
-            NextChar();// Skip object start char or comma for more key value pairs.
-            SkipWhiteSpace();
-            // Is it an empty object?
-            if( *mPos == '}' )
+            return known;
+        }
+        if( !HasChildren(pRoot) )
+        {
+            return FinishHash(pRoot,StartHash(pRoot));
+        }
+
+        struct Frame
+        {
+            const JsonValue* mValue;
+            const std::string* mKey;    //!< Its key in the object holding it.
+            size_t mIndex;              //!< The next element of an array.
+            JsonKeyValue::const_iterator mEntry; //!< The next entry of an object.
+            uint64_t mHash;
+        };
+        std::vector<Frame> stack;
+        stack.push_back({&pRoot,nullptr,0,pRoot.mObject.begin(),StartHash(pRoot)});
+        for(;;)
+        {
+            Frame& frame = stack.back();
+            const JsonValue* child = nullptr;
+            const std::string* key = nullptr;
+            if( frame.mIndex < frame.mValue->mArray.size() )
             {
-                if( previousChar == ',' )
-                {
-                    THROW_JSON_EXCEPTION(GetErrorPos() + "End of root object found, invalid Json. Comma with no object defined after it");
-                }
-                else
-                {
-                    NextChar();
-                    return;
-                }
+                child = &frame.mValue->mArray[frame.mIndex++];
+            }
+            else if( frame.mEntry != frame.mValue->mObject.end() )
+            {
+                key = &frame.mEntry->first;
+                child = &frame.mEntry->second;
+                ++frame.mEntry;
             }
 
-            std::string objKey;
-            ReadString(objKey);
-
-            // Now parse it's value.
-            SkipWhiteSpace();
-            AssertCorrectChar(':',"Json format error detected, seperator character ':'");
-            NextChar();
-
-            if( mFailOnDuplicateKeys )
+            uint64_t hash = 0;
+            if( child )
             {
-                if( rObject.find(objKey) != rObject.end() )
+                hash = pLookup(*child);
+                if( hash == 0 )
                 {
-                    THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, two objects at the same level have the same key, " + objKey);
+                    if( HasChildren(*child) )
+                    {
+                        stack.push_back({child,key,0,child->mObject.begin(),StartHash(*child)});
+                        continue;
+                    }
+                    hash = FinishHash(*child,StartHash(*child));
                 }
             }
-
-            MakeValue(rObject[objKey]);
-            
-            // Now see if there are more key value pairs to add to the object or if we're done.
-            if( *mPos != '}' && *mPos != ',' )
+            else
             {
-                THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, did you forget a comma between key value pairs? For key " + objKey);
+                hash = FinishHash(*frame.mValue,frame.mHash);
+                pStore(*frame.mValue,hash);
+                key = frame.mKey;
+                stack.pop_back();
+                if( stack.empty() )
+                {
+                    return hash;
+                }
             }
-        }while (*mPos == ',');
+            AddToHash(stack.back().mHash,key,hash);
+        }
+    }
 
-        if( *mPos == '}' )    // Validate end of object.
+    /**
+     * @brief Hashes an array or object whose arrays and objects have their mHash set already, as the parser does when it closes one.
+     */
+    static uint64_t HashChildren(const JsonValue& pValue)
+    {
+        const auto known = [](const JsonValue& pChild){return pChild.mHash;};
+        const auto keep = [](const JsonValue& pChild,uint64_t pHash){const_cast<JsonValue&>(pChild).mHash = pHash;};
+        uint64_t hash = StartHash(pValue);
+        for( const auto& element : pValue.mArray )
         {
-            NextChar();
+            AddToHash(hash,nullptr,element.mHash != 0 ? element.mHash : HashTree(element,known,keep));
         }
-        else
+        for( const auto& entry : pValue.mObject )
+        {
+            AddToHash(hash,&entry.first,entry.second.mHash != 0 ? entry.second.mHash : HashTree(entry.second,known,keep));
+        }
+        return FinishHash(pValue,hash);
+    }
+
+    static uint64_t StartHash(const JsonValue& pValue)
+    {
+        switch( pValue.mType )
         {
-            THROW_JSON_EXCEPTION(GetErrorPos() + "End of root object not found, invalid Json");
+        case JsonValueType::NUMBER:     return HashNumber(pValue.mValue);
+        case JsonValueType::STRING:     return HashText(pValue.mValue,0x5354);
+        case JsonValueType::BOOLEAN:    return pValue.mBoolean ? 0x54525545 : 0x46414c53;
+        case JsonValueType::NULL_VALUE: return 0x4e554c4c;
+        case JsonValueType::ARRAY:      return 0x4152;
+        default:                        return 0;
         }
     }
 
     /**
-     * @brief Builds the core value structure that powers Json.
-     * @param pNewValue As with MakeObject, we don't return the new value but initialise the one passed in.
+     * @brief The elements of an array are hashed in order, the entries of an object are added up so their order does not matter.
      */
-    void MakeValue(JsonValue& pNewValue)
+    static void AddToHash(uint64_t& rHash,const std::string* pKey,uint64_t pChild)
     {
-        SkipWhiteSpace();// skip space and then see if it's an object, string, value or special state (TRUE,FALSE,NULL). We also skip white space before exit.
-        switch( *mPos )
+        if( pKey )
         {
-        case 0:
-            break;
+            rHash += JsonHashBytes(&pChild,sizeof(pChild),HashText(*pKey,0x4b4559));
+        }
+        else
+        {
+            rHash = JsonHashBytes(&pChild,sizeof(pChild),rHash);
+        }
+    }
 
-        case '{':
-            pNewValue.mType = JsonValueType::OBJECT;
-            MakeObject(pNewValue.mObject);
-            break;
+    /**
+     * @brief 0 is kept for not worked out, so no value hashes to it.
+     */
+    static uint64_t FinishHash(const JsonValue& pValue,uint64_t pHash)
+    {
+        if( pValue.mType == JsonValueType::ARRAY || pValue.mType == JsonValueType::OBJECT )
+        {
+            const uint64_t count = pValue.mArray.size() + pValue.mObject.size();
+            pHash = JsonHashBytes(&count,sizeof(count),pHash ^ uint64_t(pValue.mType));
+        }
+        return pHash != 0 ? pHash : 1;
+    }
 
-        case '[':
-            pNewValue.mType = JsonValueType::ARRAY;
-            do
-            {
-                const char previousChar = mPos[0];
-                NextChar();// skip '[' or the ','
+    static bool HasEscapes(const std::string& pText)
+    {
+        return memchr(pText.data(),'\\',pText.size()) != nullptr;
+    }
 
-                SkipWhiteSpace();
-                // Make sure there is an object next and not the end of the array.
-                if( previousChar == ',' && mPos[0] == ']' )
-                {
-                    THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, comma not follwed by a value.");
-                }
+    /**
+     * @brief Hashes the text of a string or key, unescaped when it has escapes so "\u0041" hashes the same as "A".
+     */
+    static uint64_t HashText(const std::string& pText,uint64_t pSeed)
+    {
+        if( HasEscapes(pText) )
+        {
+            std::string text;
+            JsonUnescapeString(text,pText.data(),pText.size());
+            return JsonHashBytes(text.data(),text.size(),pSeed);
+        }
+        return JsonHashBytes(pText.data(),pText.size(),pSeed);
+    }
 
-                // Looks odd, but is the easiest / optimal way to reduce memory reallocations using c++14 features.
-                // The problem is that we have to make the object before adding to the vector.
-                // This means we can't use emplace_back as we don't have all that we need.
-                // I would have to duplicate the code for MakeValue for when adding to an array. And that just makes everything hard to maintain!
-                // In c++17 you can use PMR and reduce memory allocations. I may look at that.
-                // But for now this code compiles for c++11 which is good for some old systems. Remember, minimun requirements!
+    static bool SameText(const std::string& pA,const std::string& pB)
+    {
+        if( pA == pB )
+        {
+            return true;
+        }
+        if( !HasEscapes(pA) && !HasEscapes(pB) )
+        {
+            return false;
+        }
+        std::string a,b;
+        JsonUnescapeString(a,pA.data(),pA.size());
+        JsonUnescapeString(b,pB.data(),pB.size());
+        return a == b;
+    }
 
-                // Only make the value if there is one next.
-                // It is posible that this is an empty array. Rather annoying that the spec allows that.
-                if( *mPos != ']' )
+    /**
+     * @brief Splits the text of a number into its sign, its digits without leading or trailing zeros and the power of ten they are multiplied by,
+     * so numbers that are written differently but have the same value split the same. Zero has no digits and is never negative.
+     * rDigits needs room for as many characters as the text, rCount is set to how many were written.
+     * Returns false if the text is not a number, which json from the parser always is.
+     */
+    static bool SplitNumber(const std::string& pText,bool& rNegative,char* rDigits,size_t& rCount,int64_t& rPower)
+    {
+        const char* c = pText.c_str();
+        rNegative = *c == '-';
+        c += rNegative;
+        rCount = 0;
+        rPower = 0;
+        bool fraction = false;
+        for( ; *c ; c++ )
+        {
+            if( *c >= '0' && *c <= '9' )
+            {
+                if( *c != '0' || rCount > 0 )
                 {
-                    pNewValue.mArray.resize(pNewValue.mArray.size()+1);
-                    MakeValue(pNewValue.mArray.back());
+                    rDigits[rCount++] = *c;
                 }
-            }while(*mPos == ',');
-
-            // Check we did get to the end.
-            if( *mPos != ']' )
-            {
-                THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, array not terminated with ']'");
+                rPower -= fraction;
             }
-            NextChar();//skip ']'
-            break;
-
-        case '\"':
-            pNewValue.mType = JsonValueType::STRING;
-            ReadString(pNewValue.mValue);
-            break;
-
-        case 'T':
-        case 't':
-            if( tolower(mPos[1]) == 'r' && tolower(mPos[2]) == 'u' && tolower(mPos[3]) == 'e' )
+            else if( *c == '.' && !fraction )
             {
-                mPos += 4;
-                pNewValue.mType = JsonValueType::BOOLEAN;
-                pNewValue.mBoolean = true;
+                fraction = true;
             }
             else
             {
-                THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + *mPos + "\" found in json value definition reading true type");
+                break;
             }
-            break;
+        }
 
-        case 'F':
-        case 'f':
-            if( tolower(mPos[1]) == 'a' && tolower(mPos[2]) == 'l' && tolower(mPos[3]) == 's' && tolower(mPos[4]) == 'e' )
-            {
-                mPos += 5;
-                pNewValue.mType = JsonValueType::BOOLEAN;
-                pNewValue.mBoolean = false;
-            }
-            else
+        if( *c == 'e' || *c == 'E' )
+        {
+            c++;
+            const bool negative = *c == '-';
+            c += *c == '-' || *c == '+';
+            int64_t exponent = 0;
+            for( ; *c >= '0' && *c <= '9' ; c++ )
             {
-                THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + *mPos + "\" found in json value definition reading false type");
+                exponent = std::min(exponent * 10 + (*c - '0'),int64_t(1000000000000LL)); // Past this the value makes no difference to anything.
             }
-            break;
+            rPower += negative ? -exponent : exponent;
+        }
 
-        case 'N':
-        case 'n':
-            if( tolower(mPos[1]) == 'u' && tolower(mPos[2]) == 'l' && tolower(mPos[3]) == 'l' )
-            {
-                mPos += 4;
-                pNewValue.mType = JsonValueType::NULL_VALUE;
-            }
-            else
+        while( rCount > 0 && rDigits[rCount - 1] == '0' )
+        {
+            rCount--;
+            rPower++;
+        }
+        if( rCount == 0 )
+        {
+            rNegative = false;
+            rPower = 0;
+        }
+        return *c == 0;
+    }
+
+    /**
+     * @brief Room for the digits of a number, on the stack unless the number is very long.
+     */
+    struct NumberDigits
+    {
+        char mShort[64];
+        std::string mLong;
+        char* Get(size_t pLength)
+        {
+            if( pLength <= sizeof(mShort) )
             {
-                THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + *mPos + "\" found in json value definition reading null type");
+                return mShort;
             }
-            break;
-
-        case '-':
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            pNewValue.mType = JsonValueType::NUMBER;
-            ReadNumber(pNewValue.mValue);
-            break;
+            mLong.resize(pLength);
+            return &mLong[0];
+        }
+    };
 
-        default:
-            THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + *mPos + "\" found at start of json value definition");
-            break;
+    static uint64_t HashNumber(const std::string& pText)
+    {
+        NumberDigits room;
+        char* digits = room.Get(pText.size());
+        size_t count;
+        bool negative;
+        int64_t power;
+        if( !SplitNumber(pText,negative,digits,count,power) )
+        {
+            return JsonHashBytes(pText.data(),pText.size(),0x4e4d);
         }
-        // Skip any human readble characters. We exit leaving pos on the next meaningful character.
-        SkipWhiteSpace();
+        return JsonHashBytes(digits,count,uint64_t(power) * 0x9e3779b97f4a7c15ULL + 0x4e4d + negative);
     }
 
-    /**
-     * @brief Skips to the next char that is not white space.
-     */
-    void SkipWhiteSpace()
+    static bool SameNumber(const std::string& pA,const std::string& pB)
     {
-        while( isspace(*mPos) )
-        {// As per Json spec, look for characters that are not a space, linefeed, carrage return or horizontal tab. isspace does this.
-            AssertMoreData("Abrupt end to json whilst skipping white space");
-            NextChar();
+        if( pA == pB )
+        {
+            return true;
         }
+        NumberDigits roomA,roomB;
+        char* digitsA = roomA.Get(pA.size());
+        char* digitsB = roomB.Get(pB.size());
+        size_t countA,countB;
+        bool negativeA,negativeB;
+        int64_t powerA,powerB;
+        if( !SplitNumber(pA,negativeA,digitsA,countA,powerA) || !SplitNumber(pB,negativeB,digitsB,countB,powerB) )
+        {
+            return false;
+        }
+        return negativeA == negativeB && powerA == powerB && countA == countB && memcmp(digitsA,digitsB,countA) == 0;
     }
 
     /**
-     * @brief Reads a string value.
+     * @brief Adds the values of the entries with the same key to rPending, returns false if the keys are not the same.
+     * The keys are held escaped, so keys with escapes can be in a different order in the two objects, when the keys do not
+     * line up they are unescaped and sorted before being matched.
      */
-    void ReadString(std::string& rString)
+    static bool PairEntries(const JsonKeyValue& pA,const JsonKeyValue& pB,std::vector<std::pair<const JsonValue*,const JsonValue*>>& rPending)
     {
-        // First find the start of the string
-        SkipWhiteSpace();
-        AssertCorrectChar('\"',"Json format error detected, expected start of string, did you forget to put the string in quotes?");
-        NextChar(); // Skip "
-        const char* stringStart = mPos;
-        // Now scan till we hit the next "
-        while( *mPos != '\"' )
+        const size_t pendingSize = rPending.size();
+        auto b = pB.begin();
+        for( const auto& a : pA )
         {
-            // Did we hit the end?
-            AssertMoreData("Abrupt end to json whilst reading string");            
-
-            // Special case, if we find a \ and then a special character code.
-            if( mPos[0] == '\\' )
+            if( a.first != b->first )
             {
-                // Test data says \x should be a failure. For safety I agree. I may have to add an option for the user.
-                if( mPos[1] == '0' || mPos[1] == 'x' )
+                rPending.resize(pendingSize);
+                typedef std::vector<std::pair<std::string,const JsonValue*>> Entries;
+                auto unescape = [](const JsonKeyValue& pObject)
                 {
-                    THROW_JSON_EXCEPTION(std::string("Escape value \\") + mPos[1] + " not allowed " + std::string(mPos-1,20) );
-                }
-
-
-                if( mPos[1] == 'a' || mPos[1] == 'b' || mPos[1] == 't' ||
-                    mPos[1] == 'n' || mPos[1] == 'v' || mPos[1] == 'f' || mPos[1] == 'r' ||
-                    mPos[1] == 'e' || mPos[1] == '\"' || mPos[1] == '\\' )
+                    Entries entries;
+                    for( const auto& entry : pObject )
+                    {
+                        entries.emplace_back(std::string(),&entry.second);
+                        JsonUnescapeString(entries.back().first,entry.first.data(),entry.first.size());
+                    }
+                    std::sort(entries.begin(),entries.end());
+                    return entries;
+                };
+                const Entries entriesA = unescape(pA);
+                const Entries entriesB = unescape(pB);
+                for( size_t n = 0 ; n < entriesA.size() ; n++ )
                 {
-                    NextChar();
+                    if( entriesA[n].first != entriesB[n].first )
+                    {
+                        return false;
+                    }
+                    rPending.emplace_back(entriesA[n].second,entriesB[n].second);
                 }
+                return true;
             }
+            rPending.emplace_back(&a.second,&b->second);
+            ++b;
+        }
+        return true;
+    }
 
-            // Test for illegal characters.
-            if( mPos[0] == '\t' )
+    static bool HasChildren(const JsonValue& pValue)
+    {
+        return pValue.mArray.size() > 0 || pValue.mObject.size() > 0;
+    }
+
+    /**
+     * @brief Moves the children that have children of their own onto rPending, so that when this value goes it only frees values with no children.
+     */
+    void MoveOutBranches(std::vector<JsonValue>& rPending)
+    {
+        for( auto& element : mArray )
+        {
+            if( HasChildren(element) )
             {
-                THROW_JSON_EXCEPTION(std::string("illegal character, tab not allowed ") + std::string(mPos-1,20) );
+                rPending.push_back(std::move(element));
             }
-            if( mPos[0] == '\n' )
+        }
+        for( auto& entry : mObject )
+        {
+            if( HasChildren(entry.second) )
             {
-                THROW_JSON_EXCEPTION(std::string("illegal character, newline not allowed ") + std::string(mPos-1,20) );
+                rPending.push_back(std::move(entry.second));
             }
-
-            NextChar();
         }
-   
-        const size_t len = mPos - stringStart;
-        if( len > 0 ) // Did we read a string?
+    }
+
+    void FreeTree()
+    {
+        try
         {
-            rString.assign(stringStart,len);
+            std::vector<JsonValue> pending;
+            MoveOutBranches(pending);
+            while( pending.size() > 0 )
+            {
+                JsonValue value = std::move(pending.back());
+                pending.pop_back();
+                value.MoveOutBranches(pending);
+            }
         }
-        NextChar(); // Skip "
+        catch(...){} // Out of memory for the list, what is left is freed by the containers as it would have been anyway.
     }
 
     /**
-     * @brief Scans for the end of the number that we just found the start too.
-     * mPos is set to the end of the number.
+     * @brief Copies pOther into this value, which must be empty. The values still to copy are kept on a list, each with the value it is to be copied into.
+     * Values with no children are copied straight into their new array or object and never go on the list.
      */
-    void ReadNumber(std::string& rString)
+    void CopyTree(const JsonValue& pOther)
     {
-        const char* valueStart = mPos;
-        // As per Json spec, keep going to we see end of accepted number components.
-        // There is an order that you do this in, see https://www.json.org/json-en.html
-        if( *mPos == '-' )
+        std::vector<std::pair<const JsonValue*,JsonValue*>> pending;
+        pending.emplace_back(&pOther,this);
+        while( pending.size() > 0 )
         {
-            NextChar();
-        }
+            const JsonValue& from = *pending.back().first;
+            JsonValue& to = *pending.back().second;
+            pending.pop_back();
 
-        // after accounting the - there must be a number next.
-        if( isdigit(*mPos) == false )
+            CopyLeaf(from,to);
+            to.mArray.resize(from.mArray.size());
+            for( size_t n = 0 ; n < from.mArray.size() ; n++ )
+            {
+                if( HasChildren(from.mArray[n]) )
+                {
+                    pending.emplace_back(&from.mArray[n],&to.mArray[n]);
+                }
+                else
+                {
+                    CopyLeaf(from.mArray[n],to.mArray[n]);
+                }
+            }
+
+            for( const auto& entry : from.mObject )
+            {
+                auto copy = to.mObject.emplace_hint(to.mObject.end(),entry.first,JsonValue());
+                if( HasChildren(entry.second) )
+                {
+                    pending.emplace_back(&entry.second,&copy->second);
+                }
+                else
+                {
+                    CopyLeaf(entry.second,copy->second);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Copies all but the children.
+     */
+    static void CopyLeaf(const JsonValue& pFrom,JsonValue& rTo)
+    {
+        rTo.mBoolean = pFrom.mBoolean;
+        rTo.mType = pFrom.mType;
+        rTo.mValue = pFrom.mValue;
+        rTo.mHash = pFrom.mHash;
+    }
+
+    void SetTypeIfUnset(JsonValueType pType)
+    {
+        if( mType == JsonValueType::INVALID )
+        {
+            mType = pType;
+        }
+        else
+        {
+            TINYJSON_ASSERT_TYPE(pType);
+        }
+    }
+
+    template<typename ITERATOR>
+    void AssignRange(ITERATOR pBegin,ITERATOR pEnd,std::true_type /*pCopy*/)
+    {
+        AssignRange(pBegin,pEnd);
+    }
+
+    template<typename ITERATOR>
+    void AssignRange(ITERATOR pBegin,ITERATOR pEnd,std::false_type /*pCopy*/)
+    {
+        AssignRange(std::make_move_iterator(pBegin),std::make_move_iterator(pEnd));
+    }
+
+    template<typename ITERATOR>
+    void AssignRange(ITERATOR pBegin,ITERATOR pEnd)
+    {
+        typedef typename std::decay<decltype(*pBegin)>::type Element;
+        AddElements(pBegin,pEnd,IsJsonKeyValue<Element>(),typename std::iterator_traits<ITERATOR>::iterator_category());
+    }
+
+    /**
+     * @brief Key value pairs make an object, when the pair is an rvalue, from a move iterator, the key and value are moved into the entry.
+     */
+    template<typename ITERATOR,typename CATEGORY>
+    void AddElements(ITERATOR pBegin,ITERATOR pEnd,std::true_type /*pKeyValue*/,CATEGORY)
+    {
+        mType = JsonValueType::OBJECT;
+        for( ; pBegin != pEnd ; ++pBegin )
+        {
+            auto&& entry = *pBegin;
+            mObject.emplace(std::forward<decltype(entry)>(entry).first,std::forward<decltype(entry)>(entry).second);
+        }
+    }
+
+    /**
+     * @brief Anything else makes an array, when the range can be walked more than once the array is sized first.
+     */
+    template<typename ITERATOR>
+    void AddElements(ITERATOR pBegin,ITERATOR pEnd,std::false_type /*pKeyValue*/,std::input_iterator_tag)
+    {
+        mType = JsonValueType::ARRAY;
+        for( ; pBegin != pEnd ; ++pBegin )
+        {
+            mArray.emplace_back(*pBegin);
+        }
+    }
+
+    template<typename ITERATOR>
+    void AddElements(ITERATOR pBegin,ITERATOR pEnd,std::false_type pKeyValue,std::forward_iterator_tag)
+    {
+        mArray.reserve(mArray.size() + size_t(std::distance(pBegin,pEnd)));
+        AddElements(pBegin,pEnd,pKeyValue,std::input_iterator_tag());
+    }
+};
+
+/**
+ * @brief For keeping trees in the std unordered containers, std::unordered_set<JsonValue,JsonValueHash>, see JsonValue::GetHash.
+ */
+struct JsonValueHash
+{
+    size_t operator()(const JsonValue& pValue)const
+    {
+        return size_t(pValue.GetHash());
+    }
+};
+
+/**
+ * @brief FNV-1a hash of a key, constexpr so it can be used for case labels, switch(JsonKeyHash(key,length)){case JsonKeyHash("temp",4):...
+ */
+constexpr uint32_t JsonKeyHash(const char* pKey,size_t pLength,uint32_t pHash = 2166136261u)
+{
+    return pLength == 0 ? pHash : JsonKeyHash(pKey + 1,pLength - 1,(pHash ^ uint32_t((unsigned char)*pKey)) * 16777619u);
+}
+
+/**
+ * @brief A fixed set of keys, finds the slot of a key, its index in the list the set was made from, with one hash and one compare.
+ * Returns -1 for keys that are not in the set, so unknown keys can be skipped or handled some other way.
+ * When the set is made a seed is searched for that gives every key its own place in the table, a perfect hash.
+ * The first try only hashes the length and the first and last two characters, which is enough for most real key sets.
+ * Keys that only differ in the middle fall back to hashing all of the key.
+ * Big sets, a few hundred keys or more, rarely have a perfect hash in a table of sensible size. For those the keys are
+ * put in the next free place after their own, the set is always made and lookups check the few places a key can have moved to.
+ * The search is done once, keep the set in a static or a member, the lookups are then a few instructions.
+ */
+class JsonKeySet
+{
+public:
+    JsonKeySet(std::initializer_list<const char*> pKeys) : JsonKeySet(std::vector<std::string>(pKeys.begin(),pKeys.end())){}
+
+    JsonKeySet(std::vector<std::string> pKeys) : mKeys(std::move(pKeys))
+    {
+        if( std::set<std::string>(mKeys.begin(),mKeys.end()).size() != mKeys.size() )
+        {
+            THROW_JSON_EXCEPTION("JsonKeySet made with the same key in it twice");
+        }
+
+        // Past this many keys a perfect hash is almost never found, so the search is not worth the time or the size of the tables it tries.
+        const size_t perfectKeys = 1024;
+        for( mFullHash = false ; mKeys.size() <= perfectKeys ; mFullHash = true )
+        {
+            // Bigger tables make it easier to find a seed, the larger sizes are only tried if the smaller ones fail.
+            for( size_t size = 4 ; size <= mKeys.size() * 64 + 64 ; size *= 2 )
+            {
+                if( size < mKeys.size() * 2 )
+                {
+                    continue;
+                }
+                for( uint32_t seed = 1 ; seed < 256 ; seed++ )
+                {
+                    if( Build(size,seed,false) )
+                    {
+                        return;
+                    }
+                }
+            }
+            if( mFullHash )
+            {
+                break;
+            }
+        }
+
+        // Half full at most so no key has to move far from its place.
+        mFullHash = true;
+        size_t size = 4;
+        while( size < mKeys.size() * 2 )
+        {
+            size *= 2;
+        }
+        Build(size,1,true);
+    }
+
+    /**
+     * @brief Returns the slot of the key or -1 if the key is not in the set.
+     */
+    int Find(const char* pKey,size_t pLength)const
+    {
+        uint32_t place = Hash(pKey,pLength) & mMask;
+        for( uint32_t moved = 0 ; moved <= mMaxMoved ; moved++ )
+        {
+            const Slot& slot = mTable[place];
+            if( slot.mIndex < 0 )
+            {
+                break;
+            }
+            if( slot.mLength == pLength && memcmp(mKeyText.data() + slot.mOffset,pKey,pLength) == 0 )
+            {
+                return slot.mIndex;
+            }
+            place = (place + 1) & mMask;
+        }
+        return -1;
+    }
+    int Find(const std::string& pKey)const{return Find(pKey.data(),pKey.size());}
+
+    size_t GetSize()const{return mKeys.size();}
+    const std::string& GetKey(size_t pSlot)const{return mKeys.at(pSlot);}
+
+private:
+    struct Slot
+    {
+        size_t mOffset;     //!< Where the key is in mKeyText, an offset and not a pointer so the set can be copied.
+        size_t mLength;
+        int mIndex;
+    };
+
+    std::vector<std::string> mKeys; //!< The keys, in slot order.
+    std::string mKeyText;           //!< All the keys one after the other, so the compare does not have to go through mKeys.
+    std::vector<Slot> mTable;       //!< Power of two sized, empty places have an index of -1.
+    uint32_t mMask = 0;             //!< The size of the table less one.
+    uint32_t mSeed = 0;             //!< The seed that gave every key its own place.
+    uint32_t mMaxMoved = 0;         //!< The furthest any key is from its place, zero for a perfect hash.
+    bool mFullHash = false;         //!< Set if the quick hash could not separate the keys.
+
+    uint32_t Hash(const char* pKey,size_t pLength)const
+    {
+        uint32_t hash;
+        if( mFullHash )
+        {
+            hash = JsonKeyHash(pKey,pLength,2166136261u ^ mSeed);
+        }
+        else
+        {
+            hash = (mSeed ^ uint32_t(pLength)) * 0x9e3779b1u;
+            if( pLength > 0 )
+            {
+                hash = (hash ^ (unsigned char)pKey[0] ^ ((unsigned char)pKey[pLength-1] << 8)) * 0x01000193u;
+                hash = (hash ^ (unsigned char)pKey[pLength > 1 ? 1 : 0] ^ ((unsigned char)pKey[pLength > 1 ? pLength - 2 : 0] << 8)) * 0x01000193u;
+            }
+        }
+        return hash ^ (hash >> 15);
+    }
+
+    /**
+     * @brief Puts the keys in a table of pSize, if pMove is false it fails as soon as two keys want the same place.
+     */
+    bool Build(size_t pSize,uint32_t pSeed,bool pMove)
+    {
+        const Slot empty = {0,0,-1};
+        if( mTable.size() != pSize )
+        {
+            mTable.assign(pSize,empty);
+        }
+        mMask = uint32_t(pSize - 1);
+        mSeed = pSeed;
+        mMaxMoved = 0;
+        mKeyText.clear();
+        for( size_t n = 0 ; n < mKeys.size() ; n++ )
+        {
+            uint32_t place = Hash(mKeys[n].data(),mKeys[n].size()) & mMask;
+            for( uint32_t moved = 0 ; mTable[place].mIndex >= 0 ; moved++ )
+            {
+                if( !pMove )
+                {
+                    // Only the places filled so far are emptied, clearing the whole table for every seed tried was most of the cost.
+                    for( size_t filled = 0 ; filled < n ; filled++ )
+                    {
+                        mTable[Hash(mKeys[filled].data(),mKeys[filled].size()) & mMask] = empty;
+                    }
+                    return false;
+                }
+                place = (place + 1) & mMask;
+                mMaxMoved = std::max(mMaxMoved,moved + 1);
+            }
+            Slot& slot = mTable[place];
+            slot.mOffset = mKeyText.size();
+            slot.mLength = mKeys[n].size();
+            slot.mIndex = int(n);
+            mKeyText += mKeys[n];
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief A json schema compiled for checking json as it is parsed, pass it to JsonProcessor and values that break it are found before the rest of the tree is made.
+ * Supports a subset of json schema:
+ *     type                         A type name, or an array of them. object, array, string, number, integer, boolean or null.
+ *     properties                   The schemas for the keys of an object.
+ *     required                     The keys an object must have.
+ *     additionalProperties         Only false is supported, keys not in properties are then an error.
+ *     items                        The schema every element of an array must match.
+ *     enum                         The values allowed.
+ *     minimum, maximum             Range of a number.
+ *     minLength, maxLength         Length of a string, in utf8 characters.
+ *     minItems, maxItems           Size of an array, too many items fails as the extra item is reached.
+ * The annotations $schema, $id, $comment, title, description, default and examples are allowed and ignored.
+ * Any other keyword throws, so a schema is never quietly checked less strictly than it was written.
+ * The schema is made from a parsed tree, JsonSchema schema(JsonProcessor(schemaText).GetRoot());
+ */
+class JsonSchema
+{
+public:
+    /**
+     * @brief A schema that allows anything.
+     */
+    JsonSchema() = default;
+
+    /**
+     * @brief Compiles the schema, throws std::runtime_error if the schema uses something that is not supported in a way that would change the result.
+     */
+    explicit JsonSchema(const JsonValue& pSchema)
+    {
+        if( pSchema.GetType() != JsonValueType::OBJECT )
+        {
+            THROW_JSON_EXCEPTION("Json schema must be an object");
+        }
+
+        std::vector<std::string> keys;
+        for( const auto& entry : pSchema.mObject )
+        {
+            const std::string& name = entry.first;
+            const JsonValue& value = entry.second;
+            if( name == "type" )
+            {
+                if( value.GetType() == JsonValueType::ARRAY )
+                {
+                    for( const auto& type : value.mArray )
+                    {
+                        mTypes |= TypeFromName(type.GetString());
+                    }
+                }
+                else
+                {
+                    mTypes = TypeFromName(value.GetString());
+                }
+            }
+            else if( name == "properties" )
+            {
+                for( const auto& property : value )
+                {
+                    keys.push_back(property.first);
+                    mProperties.emplace_back(property.second);
+                }
+            }
+            else if( name == "required" )
+            {
+                for( const auto& key : value.mArray )
+                {
+                    mRequired.push_back(key.GetString());
+                }
+            }
+            else if( name == "additionalProperties" )
+            {
+                if( value.GetType() != JsonValueType::BOOLEAN )
+                {
+                    THROW_JSON_EXCEPTION("Json schema additionalProperties can only be true or false");
+                }
+                mOtherKeysAllowed = value.GetBoolean();
+            }
+            else if( name == "items" )
+            {
+                mItems.emplace_back(value);
+            }
+            else if( name == "enum" )
+            {
+                if( value.GetType() != JsonValueType::ARRAY )
+                {
+                    THROW_JSON_EXCEPTION("Json schema enum must be an array");
+                }
+                mEnum = value.mArray;
+            }
+            else if( name == "minimum" )    {mMinimum = value.GetDouble();mHasMinimum = true;}
+            else if( name == "maximum" )    {mMaximum = value.GetDouble();mHasMaximum = true;}
+            else if( name == "minLength" )  {mMinLength = value.GetUInt64();}
+            else if( name == "maxLength" )  {mMaxLength = value.GetUInt64();}
+            else if( name == "minItems" )   {mMinItems = value.GetUInt64();}
+            else if( name == "maxItems" )   {mMaxItems = value.GetUInt64();}
+            else if( !IsAnnotation(name) )
+            {
+                THROW_JSON_EXCEPTION("Json schema keyword " + name + " is not supported");
+            }
+        }
+        mPropertyKeys = JsonKeySet(std::move(keys));
+    }
+
+    /**
+     * @brief Checks the first character of a value, so the wrong type is found before anything is made for it. Returns an empty string if it is fine.
+     */
+    std::string CheckStart(char pFirst)const
+    {
+        if( mTypes == ANY )
+        {
+            return std::string();
+        }
+
+        uint32_t type = 0;
+        switch( pFirst )
+        {
+        case '{': type = OBJECT; break;
+        case '[': type = ARRAY; break;
+        case '\"': type = STRING; break;
+        case 't': case 'T': case 'f': case 'F': type = BOOLEAN; break;
+        case 'n': case 'N': type = NULL_VALUE; break;
+        default: type = NUMBER | INTEGER; break; // Integer is checked once we have the number.
+        }
+
+        if( (mTypes & type) == 0 )
+        {
+            return "Json value does not match the schema, expected " + GetTypeNames();
+        }
+        return std::string();
+    }
+
+    /**
+     * @brief Checks a key of an object, rSchema is set to the schema for its value. Returns an empty string if the key is allowed.
+     */
+    std::string CheckKey(const std::string& pKey,const JsonSchema*& rSchema)const
+    {
+        const int property = mPropertyKeys.Find(pKey);
+        rSchema = property >= 0 ? &mProperties[property] : nullptr;
+        if( property < 0 && !mOtherKeysAllowed )
+        {
+            return "Json key " + pKey + " is not allowed by the schema";
+        }
+        return std::string();
+    }
+
+    /**
+     * @brief The schema for the elements of an array, null if there is none.
+     */
+    const JsonSchema* GetItems()const
+    {
+        return mItems.size() > 0 ? &mItems[0] : nullptr;
+    }
+
+    /**
+     * @brief Checks an array is not already full before another element is added. Returns an empty string if it is fine.
+     */
+    std::string CheckItemCount(size_t pCount)const
+    {
+        if( pCount > mMaxItems )
+        {
+            return "Json array has more than the " + std::to_string(mMaxItems) + " items the schema allows";
+        }
+        return std::string();
+    }
+
+    /**
+     * @brief Checks the rest of the rules once the value has been read. Returns an empty string if the value is fine.
+     */
+    std::string CheckValue(const JsonValue& pValue)const
+    {
+        switch( pValue.GetType() )
+        {
+        case JsonValueType::NUMBER:
+            {
+                if( mTypes != ANY && (mTypes & NUMBER) == 0 && !IsWholeNumber(pValue.mValue) )
+                {
+                    return "Json value does not match the schema, expected " + GetTypeNames();
+                }
+                if( mHasMinimum || mHasMaximum )
+                {
+                    const double number = pValue.GetDouble();
+                    if( (mHasMinimum && number < mMinimum) || (mHasMaximum && number > mMaximum) )
+                    {
+                        return "Json number " + pValue.mValue + " is outside of the range the schema allows";
+                    }
+                }
+            }
+            break;
+
+        case JsonValueType::STRING:
+            if( mMinLength > 0 || mMaxLength != std::numeric_limits<size_t>::max() )
+            {
+                std::string text;
+                JsonUnescapeString(text,pValue.mValue.data(),pValue.mValue.size());
+                // Count the utf8 characters, that is every byte that is not a continuation byte.
+                const size_t length = size_t(std::count_if(text.begin(),text.end(),[](char c){return (c & 0xc0) != 0x80;}));
+                if( length < mMinLength || length > mMaxLength )
+                {
+                    return "Json string is not a length the schema allows";
+                }
+            }
+            break;
+
+        case JsonValueType::ARRAY:
+            if( pValue.mArray.size() < mMinItems )
+            {
+                return "Json array has fewer than the " + std::to_string(mMinItems) + " items the schema needs";
+            }
+            break;
+
+        case JsonValueType::OBJECT:
+            for( const auto& key : mRequired )
+            {
+                if( pValue.mObject.find(key) == pValue.mObject.end() )
+                {
+                    return "Json object is missing the key " + key + " that the schema requires";
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if( mEnum.size() > 0 && std::none_of(mEnum.begin(),mEnum.end(),[&pValue](const JsonValue& pAllowed){return IsSameValue(pAllowed,pValue);}) )
+        {
+            return "Json value is not one of the values the schema allows";
+        }
+        return std::string();
+    }
+
+private:
+    enum : uint32_t
+    {
+        ANY = 0,
+        OBJECT = 1 << 0,
+        ARRAY = 1 << 1,
+        STRING = 1 << 2,
+        NUMBER = 1 << 3,    //!< Any number, whole or not.
+        INTEGER = 1 << 4,   //!< Only whole numbers.
+        BOOLEAN = 1 << 5,
+        NULL_VALUE = 1 << 6
+    };
+
+    uint32_t mTypes = ANY;                      //!< The types allowed, or ANY.
+    JsonKeySet mPropertyKeys = JsonKeySet(std::vector<std::string>()); //!< Finds the schema for a key, the slot is the index into mProperties.
+    std::vector<JsonSchema> mProperties;        //!< The schemas of the keys in mPropertyKeys.
+    std::vector<std::string> mRequired;         //!< The keys an object must have.
+    bool mOtherKeysAllowed = true;              //!< False if keys not in mPropertyKeys are an error.
+    std::vector<JsonSchema> mItems;             //!< Holds the schema for array elements, if there is one.
+    std::vector<JsonValue> mEnum;               //!< The values allowed, if empty any are.
+    bool mHasMinimum = false,mHasMaximum = false;
+    double mMinimum = 0,mMaximum = 0;
+    size_t mMinLength = 0,mMaxLength = std::numeric_limits<size_t>::max();
+    size_t mMinItems = 0,mMaxItems = std::numeric_limits<size_t>::max();
+
+    static uint32_t TypeFromName(const std::string& pName)
+    {
+        if( pName == "object" ) return OBJECT;
+        if( pName == "array" ) return ARRAY;
+        if( pName == "string" ) return STRING;
+        if( pName == "number" ) return NUMBER | INTEGER;
+        if( pName == "integer" ) return INTEGER;
+        if( pName == "boolean" ) return BOOLEAN;
+        if( pName == "null" ) return NULL_VALUE;
+        THROW_JSON_EXCEPTION("Json schema has an unknown type " + pName);
+    }
+
+    /**
+     * @brief Keywords that only describe the schema and do not change what it allows.
+     */
+    static bool IsAnnotation(const std::string& pName)
+    {
+        static const char* const ANNOTATIONS[] = {"$schema","$id","$comment","title","description","default","examples"};
+        return std::find(std::begin(ANNOTATIONS),std::end(ANNOTATIONS),pName) != std::end(ANNOTATIONS);
+    }
+
+    /**
+     * @brief True for numbers with no fraction however they are written, so 1.0 and 1e2 are integers as json schema says they are.
+     */
+    static bool IsWholeNumber(const std::string& pText)
+    {
+        JsonValue::NumberDigits room;
+        char* digits = room.Get(pText.size());
+        size_t count;
+        bool negative;
+        int64_t power;
+        return JsonValue::SplitNumber(pText,negative,digits,count,power) && power >= 0;
+    }
+
+    std::string GetTypeNames()const
+    {
+        static const char* const NAMES[] = {"object","array","string","number","integer","boolean","null"};
+        std::string names;
+        for( uint32_t n = 0 ; n < 7 ; n++ )
+        {
+            // A number schema also sets the integer bit, no need to list both.
+            if( (mTypes & (1u << n)) && !((1u << n) == INTEGER && (mTypes & NUMBER)) )
+            {
+                names += names.size() ? " or " : "";
+                names += NAMES[n];
+            }
+        }
+        return names;
+    }
+
+    /**
+     * @brief Enum values are compared by type and value, numbers by their value so 1 and 1.0 are the same.
+     */
+    static bool IsSameValue(const JsonValue& pA,const JsonValue& pB)
+    {
+        if( pA.GetType() != pB.GetType() )
+        {
+            return false;
+        }
+        switch( pA.GetType() )
+        {
+        case JsonValueType::NUMBER:
+            return pA.GetDouble() == pB.GetDouble();
+
+        case JsonValueType::BOOLEAN:
+            return pA.mBoolean == pB.mBoolean;
+
+        case JsonValueType::STRING:
+            return pA.mValue == pB.mValue;
+
+        case JsonValueType::ARRAY:
+            return pA.mArray.size() == pB.mArray.size() && std::equal(pA.mArray.begin(),pA.mArray.end(),pB.mArray.begin(),IsSameValue);
+
+        case JsonValueType::OBJECT:
+            return pA.mObject.size() == pB.mObject.size() &&
+                std::equal(pA.mObject.begin(),pA.mObject.end(),pB.mObject.begin(),[](const JsonKeyValue::value_type& pX,const JsonKeyValue::value_type& pY){return pX.first == pY.first && IsSameValue(pX.second,pY.second);});
+
+        default:
+            return true;
+        }
+    }
+};
+
+/**
+ * @brief A very small pool of worker threads, used by the parsers that can split their work up.
+ * Tasks are run in the order they are submitted, the destructor waits for the ones already queued to finish.
+ */
+class JsonThreadPool
+{
+public:
+    /**
+     * @brief Starts the worker threads, if pNumThreads is zero one is made for each hardware thread.
+     */
+    JsonThreadPool(size_t pNumThreads = 0)
+    {
+        if( pNumThreads == 0 )
+        {
+            pNumThreads = std::max(1u,std::thread::hardware_concurrency());
+        }
+
+        for( size_t n = 0 ; n < pNumThreads ; n++ )
+        {
+            mWorkers.emplace_back([this](){WorkerLoop();});
+        }
+    }
+
+    ~JsonThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mWorkAdded.notify_all();
+        for( auto& worker : mWorkers )
+        {
+            worker.join();
+        }
+    }
+
+    JsonThreadPool(const JsonThreadPool&) = delete;
+    JsonThreadPool& operator = (const JsonThreadPool&) = delete;
+
+    size_t GetNumThreads()const{return mWorkers.size();}
+
+    /**
+     * @brief Queues a task to be run on one of the worker threads.
+     */
+    void Submit(std::function<void()> pTask)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mTasks.push_back(std::move(pTask));
+        }
+        mWorkAdded.notify_all();
+    }
+
+    /**
+     * @brief Calls pJob(n) for every n from zero to pCount-1, spread over the workers and the calling thread, and returns when they are all done.
+     * Whilst waiting the calling thread runs other queued tasks, so it is safe to call from inside a task.
+     * If any of the jobs throw, the first exception is thrown again here once all the jobs have finished.
+     */
+    void ParallelFor(size_t pCount,const std::function<void(size_t)>& pJob)
+    {
+        std::atomic<size_t> next(0);
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto worker = [&]()
+        {
+            for( size_t n = next++ ; n < pCount ; n = next++ )
+            {
+                try
+                {
+                    pJob(n);
+                }
+                catch(...)
+                {
+                    std::unique_lock<std::mutex> lock(errorMutex);
+                    if( !error ){error = std::current_exception();}
+                }
+            }
+        };
+
+        size_t helpersRunning = std::min(GetNumThreads(),pCount);
+        for( size_t n = helpersRunning ; n > 0 ; n-- )
+        {
+            Submit([&]()
+            {
+                worker();
+                std::unique_lock<std::mutex> lock(mMutex);
+                helpersRunning--;
+                mWorkAdded.notify_all();
+            });
+        }
+        worker();
+
+        // Help out with anything else that is queued until our helpers are done.
+        std::unique_lock<std::mutex> lock(mMutex);
+        while( helpersRunning > 0 )
+        {
+            if( mTasks.size() > 0 )
+            {
+                std::function<void()> task = std::move(mTasks.front());
+                mTasks.pop_front();
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+            else
+            {
+                mWorkAdded.wait(lock);
+            }
+        }
+        lock.unlock();
+
+        if( error )
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mWorkAdded; //!< Signalled when a task is added or a ParallelFor helper finishes.
+    bool mStopping = false;
+
+    void WorkerLoop()
+    {
+        for(;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWorkAdded.wait(lock,[this](){return mStopping || mTasks.size() > 0;});
+                if( mTasks.size() == 0 )
+                {
+                    return;// Stopping and nothing left to do.
+                }
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+/**
+ * @brief Moves the tree onto a thread of pPool to be freed there, so freeing a big document does not hold up the thread that was using it.
+ * rValue is left empty, JsonFreeInBackground(processor.TakeRoot(),pool) or JsonFreeInBackground(std::move(value),pool).
+ * For a JsonProcessor that is parsing again it is better to let it keep the memory of the old tree for the new one.
+ */
+inline void JsonFreeInBackground(JsonValue&& rValue,JsonThreadPool& pPool)
+{
+    // std::function has to be copyable, so the tree is held by a shared_ptr. It is moved into the task so the task has the only reference.
+    std::shared_ptr<JsonValue> tree = std::make_shared<JsonValue>(std::move(rValue));
+    pPool.Submit(std::bind([](std::shared_ptr<JsonValue>& rTree){rTree.reset();},std::move(tree)));
+}
+
+/**
+ * @brief A quick pass over just the structure of a json document, the brackets, commas and strings, that finds the big arrays and where their elements are.
+ * This is what lets JsonProcessor parse a large document in parallel, the elements of the big arrays are parsed at the same time on a JsonThreadPool.
+ * The data is cut into chunks that are scanned on the pool. A chunk can not know if it starts inside a string so it guesses that it does not,
+ * once all the chunks are done the real state at the start of each is known from the ones before it and the chunks that guessed wrong are scanned again.
+ * The scan treats a \ as an escape everywhere, valid json only has them in strings, so the number of quotes in a chunk does not depend on the guess.
+ * It does not validate the json, that is left to the parse, but it will throw if the brackets do not balance.
+ */
+class JsonStructureIndex
+{
+public:
+    static const size_t MIN_CHUNK_SIZE = 64 * 1024;     //!< Chunks smaller than this are not worth the cost of handing to a thread.
+    static const size_t MIN_ARRAY_SIZE = 16 * 1024;     //!< Arrays smaller than this are parsed as a whole, not split up.
+
+    /**
+     * @brief An array big enough that its elements are worth parsing in parallel.
+     */
+    struct Array
+    {
+        const char* mStart;                     //!< The '['.
+        const char* mEnd;                       //!< The ']'.
+        std::vector<const char*> mSeparators;   //!< The commas at this level, element n runs from the character after separator n-1 up to separator n.
+        std::vector<JsonValue> mElements;       //!< Filled in by the parallel parse.
+        std::vector<bool> mElementParsed;       //!< False for the elements with a big array inside of them, those are left for the sequential pass.
+        size_t mDepth = 0;                      //!< How deeply arrays and objects are nested in the elements parsed by the parallel parse.
+
+        size_t GetElementCount()const{return mSeparators.size() + 1;}
+        const char* GetElementStart(size_t pIndex)const{return pIndex == 0 ? mStart + 1 : mSeparators[pIndex-1] + 1;}
+        const char* GetElementEnd(size_t pIndex)const{return pIndex < mSeparators.size() ? mSeparators[pIndex] : mEnd;}
+    };
+
+    /**
+     * @brief Scans the data, pBigArraySize is the size in bytes an array has to be to be recorded.
+     */
+    JsonStructureIndex(const char* pJsonStart,const char* pJsonEnd,size_t pBigArraySize,JsonThreadPool& pPool) :
+        mBigArraySize(pBigArraySize)
+    {
+        MakeChunks(pJsonStart,pJsonEnd,pPool.GetNumThreads() * 4);
+
+        // First guess, all chunks start outside of a string.
+        pPool.ParallelFor(mChunks.size(),[this](size_t n){ScanBrackets(mChunks[n]);});
+
+        // Now we know the real state at the start of each chunk, scan again the ones that were wrong.
+        std::vector<size_t> wrongGuesses;
+        bool inString = false;
+        for( size_t n = 0 ; n < mChunks.size() ; n++ )
+        {
+            if( mChunks[n].mStartsInString != inString )
+            {
+                mChunks[n].mStartsInString = inString;
+                wrongGuesses.push_back(n);
+            }
+            inString = inString != mChunks[n].mOddQuoteCount;
+        }
+        pPool.ParallelFor(wrongGuesses.size(),[this,&wrongGuesses](size_t n){ScanBrackets(mChunks[wrongGuesses[n]]);});
+
+        MatchBrackets();
+
+        if( mArrays.size() > 0 )
+        {
+            pPool.ParallelFor(mChunks.size(),[this](size_t n){ScanSeparators(mChunks[n]);});
+            for( auto& chunk : mChunks )
+            {
+                for( const auto& separator : chunk.mSeparators )
+                {
+                    mArrays[separator.first].mSeparators.push_back(separator.second);
+                }
+            }
+        }
+        mChunks.clear();
+    }
+
+    /**
+     * @brief The big arrays in the order that they start in the data.
+     */
+    std::vector<Array>& GetArrays(){return mArrays;}
+
+    /**
+     * @brief Returns the big array that starts at pStart or null if there is not one.
+     */
+    Array* FindArray(const char* pStart)
+    {
+        const auto found = std::lower_bound(mArrays.begin(),mArrays.end(),pStart,[](const Array& pArray,const char* pPos){return pArray.mStart < pPos;});
+        if( found != mArrays.end() && found->mStart == pStart )
+        {
+            return &(*found);
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Returns true if one of the big arrays starts in the range passed.
+     */
+    bool HasArrayIn(const char* pStart,const char* pEnd)const
+    {
+        const auto found = std::lower_bound(mArrays.begin(),mArrays.end(),pStart,[](const Array& pArray,const char* pPos){return pArray.mStart < pPos;});
+        return found != mArrays.end() && found->mStart < pEnd;
+    }
+
+private:
+    struct Chunk
+    {
+        const char* mStart;
+        const char* mEnd;
+        bool mStartsInString = false;
+        bool mOddQuoteCount = false;
+        std::vector<const char*> mUnmatchedCloses;      //!< Closing brackets for containers opened in an earlier chunk.
+        std::vector<const char*> mUnmatchedOpens;       //!< Containers opened in this chunk that are closed in a later one.
+        std::vector<std::pair<const char*,const char*>> mBigArrays;  //!< Big arrays that start and end in this chunk.
+        std::vector<const char*> mOpenAtStart;          //!< The containers open at the start of this chunk, worked out by MatchBrackets.
+        std::vector<std::pair<size_t,const char*>> mSeparators;     //!< The commas found for the big arrays, the index of the array and the position.
+    };
+
+    const size_t mBigArraySize;
+    std::vector<Chunk> mChunks;
+    std::vector<Array> mArrays;
+
+    /**
+     * @brief Cuts the data into chunks, never straight after a \ so that an escape is never split between two chunks.
+     */
+    void MakeChunks(const char* pJsonStart,const char* pJsonEnd,size_t pWantedChunks)
+    {
+        const size_t chunkSize = std::max(size_t(MIN_CHUNK_SIZE),size_t(pJsonEnd - pJsonStart) / std::max<size_t>(1,pWantedChunks));
+        const char* start = pJsonStart;
+        while( start < pJsonEnd )
+        {
+            const char* end = size_t(pJsonEnd - start) > chunkSize ? start + chunkSize : pJsonEnd;
+            while( end < pJsonEnd && end[-1] == '\\' )
+            {
+                end++;
+            }
+
+            mChunks.resize(mChunks.size() + 1);
+            mChunks.back().mStart = start;
+            mChunks.back().mEnd = end;
+            start = end;
+        }
+    }
+
+    /**
+     * @brief Finds the brackets that are not in strings, pairs up the ones it can and keeps the rest for MatchBrackets.
+     */
+    void ScanBrackets(Chunk& rChunk)
+    {
+        rChunk.mUnmatchedCloses.clear();
+        rChunk.mUnmatchedOpens.clear();
+        rChunk.mBigArrays.clear();
+        bool inString = rChunk.mStartsInString;
+        bool oddQuoteCount = false;
+
+        std::vector<const char*>& open = rChunk.mUnmatchedOpens;// Used as the stack, what is left at the end is unmatched.
+        for( const char* pos = SkipToStructural(rChunk.mStart,rChunk.mEnd) ; pos < rChunk.mEnd ; pos = SkipToStructural(pos + 1,rChunk.mEnd) )
+        {
+            switch( *pos )
+            {
+            case '\\':
+                pos++;
+                break;
+
+            case '\"':
+                inString = !inString;
+                oddQuoteCount = !oddQuoteCount;
+                break;
+
+            case '[':
+            case '{':
+                if( !inString )
+                {
+                    open.push_back(pos);
+                }
+                break;
+
+            case ']':
+            case '}':
+                if( !inString )
+                {
+                    if( open.size() == 0 )
+                    {
+                        rChunk.mUnmatchedCloses.push_back(pos);
+                    }
+                    else
+                    {
+                        AddPair(open.back(),pos,rChunk.mBigArrays);
+                        open.pop_back();
+                    }
+                }
+                break;
+            }
+        }
+        rChunk.mOddQuoteCount = oddQuoteCount;
+    }
+
+    /**
+     * @brief Keeps the pair if it is a big array, throws if the brackets are not the same type.
+     */
+    void AddPair(const char* pOpen,const char* pClose,std::vector<std::pair<const char*,const char*>>& rBigArrays)const
+    {
+        if( (*pOpen == '[') != (*pClose == ']') )
+        {
+            THROW_JSON_EXCEPTION("Json structure error, brackets do not match");
+        }
+
+        if( *pOpen == '[' && size_t(pClose - pOpen) >= mBigArraySize )
+        {
+            rBigArrays.emplace_back(pOpen,pClose);
+        }
+    }
+
+    /**
+     * @brief Pairs up the brackets that span chunks, done in order on one thread but only has to look at a handful of brackets per chunk.
+     */
+    void MatchBrackets()
+    {
+        std::vector<const char*> open;
+        std::vector<std::pair<const char*,const char*>> bigArrays;
+        for( auto& chunk : mChunks )
+        {
+            chunk.mOpenAtStart = open;
+            for( const char* close : chunk.mUnmatchedCloses )
+            {
+                if( open.size() == 0 )
+                {
+                    THROW_JSON_EXCEPTION("Json structure error, closing bracket without an opening one");
+                }
+                AddPair(open.back(),close,bigArrays);
+                open.pop_back();
+            }
+            open.insert(open.end(),chunk.mUnmatchedOpens.begin(),chunk.mUnmatchedOpens.end());
+            bigArrays.insert(bigArrays.end(),chunk.mBigArrays.begin(),chunk.mBigArrays.end());
+        }
+
+        if( open.size() > 0 )
+        {
+            THROW_JSON_EXCEPTION("Json structure error, not all brackets are closed");
+        }
+
+        std::sort(bigArrays.begin(),bigArrays.end());
+        mArrays.resize(bigArrays.size());
+        for( size_t n = 0 ; n < bigArrays.size() ; n++ )
+        {
+            mArrays[n].mStart = bigArrays[n].first;
+            mArrays[n].mEnd = bigArrays[n].second;
+        }
+    }
+
+    /**
+     * @brief Finds the commas that separate the elements of the big arrays, needs the state at the start of the chunk that MatchBrackets worked out.
+     * The stack holds the index of the big array for each open container, or -1 if it is not one.
+     */
+    void ScanSeparators(Chunk& rChunk)
+    {
+        std::vector<int64_t> stack;
+        for( const char* open : rChunk.mOpenAtStart )
+        {
+            const Array* found = FindArray(open);
+            stack.push_back(found ? found - mArrays.data() : -1);
+        }
+
+        // The chunk is scanned in order so we only have to look out for the next big array to start, saves a search for every '['.
+        size_t nextArray = std::lower_bound(mArrays.begin(),mArrays.end(),rChunk.mStart,[](const Array& pArray,const char* pPos){return pArray.mStart < pPos;}) - mArrays.begin();
+
+        bool inString = rChunk.mStartsInString;
+        for( const char* pos = SkipToStructural(rChunk.mStart,rChunk.mEnd) ; pos < rChunk.mEnd ; pos = SkipToStructural(pos + 1,rChunk.mEnd) )
+        {
+            switch( *pos )
+            {
+            case '\\':
+                pos++;
+                break;
+
+            case '\"':
+                inString = !inString;
+                break;
+
+            case '[':
+                if( !inString )
+                {
+                    if( nextArray < mArrays.size() && mArrays[nextArray].mStart == pos )
+                    {
+                        stack.push_back(nextArray++);
+                    }
+                    else
+                    {
+                        stack.push_back(-1);
+                    }
+                }
+                break;
+
+            case '{':
+                if( !inString ){stack.push_back(-1);}
+                break;
+
+            case ']':
+            case '}':
+                if( !inString && stack.size() > 0 ){stack.pop_back();}
+                break;
+
+            case ',':
+                if( !inString && stack.size() > 0 && stack.back() >= 0 )
+                {
+                    rChunk.mSeparators.emplace_back(size_t(stack.back()),pos);
+                }
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Skips over the characters that do not matter to the structure, most of the data, using a bit mask of the ones that do.
+     */
+    static inline const char* SkipToStructural(const char* pPos,const char* pEnd)
+    {
+        // Bits for " and , in the first 64 characters and [ \ ] { } in the next 64.
+        const uint64_t lowMask = (uint64_t(1) << '\"') | (uint64_t(1) << ',');
+        const uint64_t highMask = (uint64_t(1) << ('[' - 64)) | (uint64_t(1) << ('\\' - 64)) | (uint64_t(1) << (']' - 64)) | (uint64_t(1) << ('{' - 64)) | (uint64_t(1) << ('}' - 64));
+        for( ; pPos < pEnd ; pPos++ )
+        {
+            const uint8_t c = uint8_t(*pPos);
+            const uint64_t mask = c < 64 ? lowMask : highMask;
+            if( c < 128 && ((mask >> (c & 63)) & 1) )
+            {
+                break;
+            }
+        }
+        return pPos;
+    }
+};
+
+#ifdef TINYJSON_PROFILE
+/**
+ * @brief Where the time of parsing goes, built in when TINYJSON_PROFILE is defined and read with JsonProcessor::GetProfile.
+ * Each phase counts the times it was entered, the bytes of json it read over and the ticks it took.
+ * Ticks are cpu cycles from the time stamp counter on x86, elsewhere they are nanoseconds.
+ * Reading the clock costs more than some of the phases, white space is often no characters at all, so compare runs and not the numbers to zero.
+ */
+struct JsonParseProfile
+{
+    enum Phase
+    {
+        WHITE_SPACE,    //!< SkipWhiteSpace, between every token.
+        KEYS,           //!< Reading the keys of objects.
+        STRINGS,        //!< Reading string values.
+        NUMBERS,        //!< Reading numbers.
+        LITERALS,       //!< Reading true, false and null.
+        OBJECT_ENTRIES, //!< Adding the entry for a key to its object.
+        ARRAY_ELEMENTS, //!< Adding an element to an array.
+        PHASE_COUNT
+    };
+
+    struct Counter
+    {
+        uint64_t mCalls = 0;
+        uint64_t mBytes = 0;
+        uint64_t mTicks = 0;
+    };
+
+    Counter mPhases[PHASE_COUNT];   //!< Indexed by Phase.
+    Counter mParses;                //!< The whole of each parse, the ticks not in any phase are the structure, the brackets, commas and the schema.
+
+    static const char* GetPhaseName(Phase pPhase)
+    {
+        static const char* names[PHASE_COUNT] = {"white space","keys","strings","numbers","literals","object entries","array elements"};
+        return pPhase < PHASE_COUNT ? names[pPhase] : "unknown";
+    }
+
+    static bool TicksAreCycles()
+    {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static uint64_t GetTicks()
+    {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        return __rdtsc();
+#else
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    JsonParseProfile& operator += (const JsonParseProfile& pOther)
+    {
+        for( int n = 0 ; n < PHASE_COUNT ; n++ )
+        {
+            Add(mPhases[n],pOther.mPhases[n]);
+        }
+        Add(mParses,pOther.mParses);
+        return *this;
+    }
+
+    /**
+     * @brief A table of the phases, one line each, for printing.
+     */
+    std::string GetReport()const
+    {
+        char line[160];
+        snprintf(line,sizeof(line),"%-16s %12s %14s %16s %7s\n","phase","calls","bytes",TicksAreCycles() ? "cycles" : "nanoseconds","share");
+        std::string report = line;
+        for( int n = 0 ; n <= PHASE_COUNT ; n++ )
+        {
+            const Counter& counter = n < PHASE_COUNT ? mPhases[n] : mParses;
+            const double share = mParses.mTicks > 0 ? 100.0 * double(counter.mTicks) / double(mParses.mTicks) : 0.0;
+            snprintf(line,sizeof(line),"%-16s %12llu %14llu %16llu %6.1f%%\n",n < PHASE_COUNT ? GetPhaseName(Phase(n)) : "whole parse",
+                (unsigned long long)counter.mCalls,(unsigned long long)counter.mBytes,(unsigned long long)counter.mTicks,share);
+            report += line;
+        }
+        return report;
+    }
+
+private:
+    static void Add(Counter& rTo,const Counter& pFrom)
+    {
+        rTo.mCalls += pFrom.mCalls;
+        rTo.mBytes += pFrom.mBytes;
+        rTo.mTicks += pFrom.mTicks;
+    }
+};
+
+/**
+ * @brief Adds the ticks and bytes read from when it is made to when it goes out of scope to a JsonParseProfile counter.
+ */
+class JsonProfileScope
+{
+public:
+    JsonProfileScope(JsonParseProfile::Counter& rCounter,const char* const& pPos) :
+        mCounter(rCounter),
+        mPos(pPos),
+        mStartPos(pPos),
+        mStartTicks(JsonParseProfile::GetTicks())
+    {
+    }
+
+    ~JsonProfileScope()
+    {
+        mCounter.mTicks += JsonParseProfile::GetTicks() - mStartTicks;
+        mCounter.mBytes += uint64_t(mPos - mStartPos);
+        mCounter.mCalls++;
+    }
+
+private:
+    JsonParseProfile::Counter& mCounter;
+    const char* const& mPos;    //!< The scanner position, read again when the scope ends.
+    const char* const mStartPos;
+    const uint64_t mStartTicks;
+};
+
+/**
+ * @brief Times the rest of the enclosing block as the phase PHASE__ of the scanner's profile. Compiles to nothing unless TINYJSON_PROFILE is defined.
+ */
+#define TINYJSON_PROFILE_PHASE(PHASE__) JsonProfileScope profilePhase__(mProfile.mPhases[JsonParseProfile::PHASE__],mPos)
+#else
+#define TINYJSON_PROFILE_PHASE(PHASE__)
+#endif
+
+/**
+ * @brief The character level reading of json, shared by JsonProcessor and the readers that do not build a tree.
+ * Keeps the position in the data, and the line and column for errors, and reads over the tokens checking them as it goes.
+ * What is done with the tokens is left to the class using it.
+ */
+class JsonScanner
+{
+protected:
+    bool mNullTerminated = false;       //!< If true there is a readable zero at mJsonEnd, the scanning loops use it to stop instead of testing for the end.
+    const char* mJsonStart = nullptr;   //!< The start of the data, used to keep error reporting inside the memory we were given.
+    const char* mJsonEnd = nullptr;     //!< Used to detect when we're at the end of the data.
+    const char* mPos = nullptr;         //!< The current position in the data that we are at.  
+    const char* mLinesFrom = nullptr;   //!< Where GetErrorPos counts the lines from, the start of the data unless it is part of a bigger document.
+    uint32_t mLinesFromRow = 1,mLinesFromColumn = 1; //!< The line and column of mLinesFrom in the whole document.
+#ifdef TRACK_LINE_AND_COLUMN
+    uint32_t mRow = 1,mColumn = 1;      //!< Keeps track of where we are in the file for error reporting to the user.
+#endif
+
+#ifdef TINYJSON_PROFILE
+    JsonParseProfile mProfile;          //!< Filled in by the TINYJSON_PROFILE_PHASE scopes.
+#endif
+
+    static const size_t DEFAULT_MAX_DEPTH = 1024;   //!< How deeply arrays and objects can be nested unless SetMaxDepth is called.
+    size_t mMaxDepth = DEFAULT_MAX_DEPTH;           //!< Json nested deeper than this is turned down, see AssertDepth.
+
+    /**
+     * @brief Starts scanning new data from the beginning.
+     */
+    void Reset(const char* pJsonString,size_t pLength,bool pNullTerminated)
+    {
+        mNullTerminated = pNullTerminated;
+        mJsonStart = pJsonString;
+        mJsonEnd = pJsonString + pLength;
+        mPos = pJsonString;
+        mLinesFrom = pJsonString;
+        mLinesFromRow = mLinesFromColumn = 1;
+#ifdef TRACK_LINE_AND_COLUMN
+        mRow = mColumn = 1;
+#endif
+    }
+
+    /**
+     * @brief For data that is part of pDocument and starts at its current position, so errors give the line and column in the document.
+     * With TRACK_LINE_AND_COLUMN the document knows where its position is, without it the lines are counted from where the document counts them.
+     */
+    void SetLinesFrom(const JsonScanner& pDocument)
+    {
+#ifdef TRACK_LINE_AND_COLUMN
+        mLinesFrom = pDocument.mPos;
+        mRow = mLinesFromRow = pDocument.mRow;
+        mColumn = mLinesFromColumn = pDocument.mColumn;
+#else
+        mLinesFrom = pDocument.mLinesFrom;
+        mLinesFromRow = pDocument.mLinesFromRow;
+        mLinesFromColumn = pDocument.mLinesFromColumn;
+#endif
+    }
+
+    /**
+     * @brief Moves where GetErrorPos counts the lines from on to the current position, for when the data before it is about to be dropped.
+     */
+    void MoveLinesFromToPos()
+    {
+#ifdef TRACK_LINE_AND_COLUMN
+        mLinesFromRow = mRow;
+        mLinesFromColumn = mColumn;
+#else
+        GetLineAndColumn(mPos,mLinesFromRow,mLinesFromColumn);
+#endif
+        mLinesFrom = mPos;
+    }
+
+    /**
+     * @brief This will advance to next char.
+     * The line and column are only tracked as we go if TRACK_LINE_AND_COLUMN is defined, otherwise GetErrorPos works them out when an error is found.
+     * The tracking is a branch and two stores on every character read, including every character of every string, for something only an error needs.
+     */
+#ifdef TRACK_LINE_AND_COLUMN
+    inline void NextChar(){if(*mPos == '\n'){mRow++;mColumn=1;}else{mColumn++;}mPos++;}
+#else
+    inline void NextChar(){mPos++;}
+#endif
+
+    /**
+     * @brief Moves the position on to pPos, which must not be before the current position. Used when we already know where the next token is.
+     */
+    inline void SkipTo(const char* pPos)
+    {
+#ifdef TRACK_LINE_AND_COLUMN
+        while( mPos < pPos ){NextChar();}
+#else
+        mPos = pPos;
+#endif
+    }
+
+    /**
+     * @brief Returns the character pAhead places on from the current position, or zero if that is past the end of the data.
+     * All token level reading of the data goes through this so we never read past mJsonEnd.
+     * When the data is null terminated the end check is skipped, the callers only look ahead after seeing characters that are not zero,
+     * so the furthest they can read is the terminator.
+     */
+    inline char Peek(size_t pAhead = 0)const{return (mNullTerminated || pAhead < size_t(mJsonEnd - mPos)) ? mPos[pAhead] : 0;}
+
+    /**
+     * @brief Character tests used by the scanning loops. Json only allows these four white space characters, isspace would also let through \v and \f.
+     */
+    static inline bool IsWhiteSpace(char c){return c == ' ' || c == '\n' || c == '\r' || c == '\t';}
+    static inline bool IsDigit(char c){return c >= '0' && c <= '9';}
+    static inline bool IsPlainStringChar(char c){return c != '\"' && c != '\\' && c != '\t' && c != '\n' && c != 0;}
+
+    /**
+     * @brief Moves on over the characters that pass CHAR_TEST, this is the loop that nearly all of the data is read in.
+     * In the NULL_TERMINATED version the zero after the data fails every test so the loop does not need to check for the end on each character.
+     */
+    template<bool NULL_TERMINATED,bool (*CHAR_TEST)(char)> inline void ScanWhile()
+    {
+        while( (NULL_TERMINATED || mPos < mJsonEnd) && CHAR_TEST(*mPos) )
+        {
+            NextChar();
+        }
+    }
+
+    /**
+     * @brief Picks the version of the scanning loop to use once per token, not once per character.
+     */
+    template<bool (*CHAR_TEST)(char)> inline void Scan()
+    {
+        if( mNullTerminated )
+            ScanWhile<true,CHAR_TEST>();
+        else
+            ScanWhile<false,CHAR_TEST>();
+    }
+
+    /**
+     * @brief This is used in several place whilst parsing the data to detect json data that is not complete.
+     * For safety does not test for NULL but checks that the mPos pointer has not gone past the end of the data.
+     */
+    inline void AssertMoreData(const char* pErrorString)
+    {
+        if( mPos >= mJsonEnd ){THROW_JSON_EXCEPTION(pErrorString);}
+    }
+
+    /**
+     * @brief Used to check that the expected charater is the correct one, if not tells the user!
+     */
+    inline void AssertCorrectChar(char c,const char* pErrorString)
+    {
+        if( Peek() != c )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + pErrorString);
+        }
+    }
+
+    /**
+     * @brief Called as an array or object is entered, pDepth counts the one being entered. Throws if it is nested deeper than mMaxDepth.
+     * None of the readers recurse for each level of the json, so the limit is not there to protect the stack while reading.
+     * It turns down hostile json, a few kilobytes of '[' can otherwise ask for a tree a million levels deep.
+     */
+    inline void AssertDepth(size_t pDepth)const
+    {
+        if( pDepth > mMaxDepth )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, arrays and objects are nested deeper than the " + std::to_string(mMaxDepth) + " levels allowed");
+        }
+    }
+
+    /**
+     * @brief Returns a string used in errors to show where the error is.
+     */
+    inline std::string GetErrorPos()const
+    {
+#ifdef TRACK_LINE_AND_COLUMN
+        return GetErrorPos(mRow,mColumn);
+#else
+        return GetErrorPos(mPos);
+#endif
+    }
+
+    /**
+     * @brief As above but for a position we have already read past, such as the start of a value that turned out to be wrong.
+     * The line and column are worked out by counting the lines from the start of the data, errors are rare so the cost is only paid here.
+     */
+    inline std::string GetErrorPos(const char* pAt)const
+    {
+        uint32_t row,column;
+        GetLineAndColumn(pAt,row,column);
+        return GetErrorPos(row,column);
+    }
+
+    /**
+     * @brief Counts the lines from mLinesFrom to pAt, which must not be before it.
+     */
+    inline void GetLineAndColumn(const char* pAt,uint32_t& rRow,uint32_t& rColumn)const
+    {
+        pAt = std::min(pAt,mJsonEnd);
+        rRow = mLinesFromRow;
+        const char* lineStart = mLinesFrom;
+        for( const char* newLine ; lineStart < pAt && (newLine = static_cast<const char*>(memchr(lineStart,'\n',pAt - lineStart))) != nullptr ; )
+        {
+            rRow++;
+            lineStart = newLine + 1;
+        }
+        rColumn = uint32_t(pAt - lineStart) + (lineStart == mLinesFrom ? mLinesFromColumn : 1);
+    }
+
+    static inline std::string GetErrorPos(uint32_t pRow,uint32_t pColumn)
+    {
+        return std::string("Error at Line ") + std::to_string(pRow) + " column " + std::to_string(pColumn) + " : ";
+    }
+
+    /**
+     * @brief Returns a short piece of the json from just before the current position, used in errors to show the offending text.
+     * Clamped to the data we were given so that building the error can not read outside of it.
+     */
+    inline std::string GetErrorSnippet()const
+    {
+        const char* start = mPos > mJsonStart ? mPos - 1 : mPos;
+        return std::string(start,std::min<size_t>(20,mJsonEnd - start));
+    }
+
+    /**
+     * @brief Skips to the next char that is not white space.
+     */
+    void SkipWhiteSpace()
+    {
+        TINYJSON_PROFILE_PHASE(WHITE_SPACE);
+        // As per Json spec, look for characters that are not a space, linefeed, carrage return or horizontal tab.
+        Scan<IsWhiteSpace>();
+    }
+
+    /**
+     * @brief If the literal, true, false or null, is next it is read over and true returned. Like the rest of the parser the case is not checked.
+     */
+    bool MatchLiteral(const char* pLiteral)
+    {
+        size_t n = 0;
+        for( ; pLiteral[n] ; n++ )
+        {
+            if( tolower(Peek(n)) != pLiteral[n] )
+            {
+                return false;
+            }
+        }
+        SkipTo(mPos + n);
+        return true;
+    }
+
+    /**
+     * @brief Reads over a whole value, checking it, without keeping any of it. Used to skip the values nobody asked for.
+     * Stops on the character after the value, white space after it is not skipped.
+     * Does not recurse, the arrays and objects we are in are kept as a string of their closing brackets.
+     * @param pDepth How many arrays and objects the caller is already inside of, for the depth limit.
+     */
+    void SkipValue(size_t pDepth = 0)
+    {
+        std::string closers; // Short enough to not allocate for most json.
+        for(;;)
+        {
+            // Read a value, or go into the array or object that starts here.
+            SkipWhiteSpace();
+            const char c = Peek();
+            if( c == '{' || c == '[' )
+            {
+                const char close = c == '{' ? '}' : ']';
+                AssertDepth(pDepth + closers.size() + 1);
+                NextChar();
+                SkipWhiteSpace();
+                if( Peek() != close )
+                {
+                    closers.push_back(close);
+                    if( close == '}' )
+                    {
+                        SkipKey();
+                    }
+                    continue;
+                }
+                NextChar();
+            }
+            else
+            {
+                SkipScalar();
+            }
+
+            // The value is done, now close the arrays and objects that it was the last element of, until one has another element.
+            for(;;)
+            {
+                if( closers.size() == 0 )
+                {
+                    return;
+                }
+                SkipWhiteSpace();
+                if( Peek() == ',' )
+                {
+                    NextChar();
+                    if( closers.back() == '}' )
+                    {
+                        SkipKey();
+                    }
+                    break;
+                }
+                AssertCorrectChar(closers.back(),closers.back() == '}' ? "End of object not found, invalid Json" : "Json format error detected, array not terminated with ']'");
+                NextChar();
+                closers.pop_back();
+            }
+        }
+    }
+
+    /**
+     * @brief For SkipValue, reads over a key and the ':' after it.
+     */
+    void SkipKey()
+    {
+        const char* start;
+        size_t length;
+        ScanString(start,length);
+        SkipWhiteSpace();
+        AssertCorrectChar(':',"Json format error detected, seperator character ':'");
+        NextChar();
+    }
+
+    /**
+     * @brief For SkipValue, reads over a string, number, true, false or null.
+     */
+    void SkipScalar()
+    {
+        const char* start;
+        size_t length;
+        switch( Peek() )
+        {
+        case '\"':
+            ScanString(start,length);
+            break;
+
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            ScanNumber(start,length);
+            break;
+
+        default:
+            if( !MatchLiteral("true") && !MatchLiteral("false") && !MatchLiteral("null") )
+            {
+                AssertMoreData("Abrupt end to json whilst looking for a value");
+                THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + Peek() + "\" found at start of json value definition");
+            }
+            break;
+        }
+    }
+
+    /**
+     * @brief Reads over a string, checking it as it goes, rStart and rLength are set to the text between the quotes, escapes and all.
+     */
+    void ScanString(const char*& rStart,size_t& rLength)
+    {
+        // First find the start of the string
+        SkipWhiteSpace();
+        AssertCorrectChar('\"',"Json format error detected, expected start of string, did you forget to put the string in quotes?");
+        NextChar(); // Skip "
+        const char* stringStart = mPos;
+        // Now scan till we hit the next "
+        for(;;)
+        {
+            // Skip quickly over the normal characters, this stops on the closing quote, an escape, something that is not allowed or the end.
+            Scan<IsPlainStringChar>();
+            if( Peek() == '\"' )
+            {
+                break;
+            }
+
+            // Did we hit the end?
+            AssertMoreData("Abrupt end to json whilst reading string");            
+
+            // Special case, if we find a \ and then a special character code.
+            if( Peek() == '\\' )
+            {
+                const char escape = Peek(1);
+                // Test data says \x should be a failure. For safety I agree. I may have to add an option for the user.
+                if( escape == '0' || escape == 'x' )
+                {
+                    THROW_JSON_EXCEPTION(std::string("Escape value \\") + escape + " not allowed " + GetErrorSnippet() );
+                }
+
+
+                if( escape == 'a' || escape == 'b' || escape == 't' ||
+                    escape == 'n' || escape == 'v' || escape == 'f' || escape == 'r' ||
+                    escape == 'e' || escape == '\"' || escape == '\\' )
+                {
+                    NextChar();
+                }
+            }
+
+            // Test for illegal characters.
+            if( Peek() == '\t' )
+            {
+                THROW_JSON_EXCEPTION(std::string("illegal character, tab not allowed ") + GetErrorSnippet() );
+            }
+            if( Peek() == '\n' )
+            {
+                THROW_JSON_EXCEPTION(std::string("illegal character, newline not allowed ") + GetErrorSnippet() );
+            }
+
+            NextChar();
+        }
+   
+        rStart = stringStart;
+        rLength = mPos - stringStart;
+        NextChar(); // Skip "
+    }
+
+    /**
+     * @brief Scans for the end of the number that we just found the start too.
+     * mPos is set to the end of the number, rStart and rLength to the text of the number.
+     */
+    void ScanNumber(const char*& rStart,size_t& rLength)
+    {
+        const char* valueStart = mPos;
+        // As per Json spec, keep going to we see end of accepted number components.
+        // There is an order that you do this in, see https://www.json.org/json-en.html
+        if( Peek() == '-' )
+        {
+            NextChar();
+        }
+
+        // after accounting the - there must be a number next.
+        if( IsDigit(Peek()) == false )
+        {
+            THROW_JSON_EXCEPTION(std::string("Malformed number ") + GetErrorSnippet() );
+        }
+
+        // Not allowed to start with a zero.
+        if( Peek() == '0' && IsDigit(Peek(1)) )
+        {
+            THROW_JSON_EXCEPTION(std::string("Malformed number, not allowed to start with zero.") + GetErrorSnippet() );
+        }
+
+        // Scan for end of digits.
+        Scan<IsDigit>();
+
+        // The next character should not be alpha.
+        if( isalpha(static_cast<unsigned char>(Peek())) && Peek() != 'e' && Peek() != 'E' )
+        {
+            THROW_JSON_EXCEPTION(std::string("Malformed number, embedded characters ") + GetErrorSnippet() );
+        }
+
+        // Do we have a decimal?
+        if( Peek() == '.' )
+        {
+            NextChar();
+            // Now scan more more digits.
+            Scan<IsDigit>();
+        }
+        // now see if there is an exponent. 
+        if( Peek() == 'E' || Peek() == 'e' )
+        {
+            NextChar();
+            // Now must be a sign or a number
+            if( Peek() == '-' || Peek() == '+' || IsDigit(Peek()) )
+            {
+                if( Peek() == '-' || Peek() == '+' )
+                {// Must be followed by a number.
+                    NextChar();
+                    if( IsDigit(Peek()) == false )// after accounting the - or + there must be a number next.
+                    {
+                        THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Malformed exponent in number ") + GetErrorSnippet() );
+                    }
+                }
+
+                // Now scan more more digits.
+                Scan<IsDigit>();
+            }
+            else
+            {
+                THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Malformed exponent in number ") + GetErrorSnippet() );
+            }
+        }
+
+        rStart = valueStart;
+        rLength = mPos - valueStart;
+    }
+};
+
+/**
+ * @brief What parsing has cost, from JsonProcessor::GetStatistics.
+ */
+struct JsonParseStatistics
+{
+    size_t mParses = 0;             //!< Parses that have completed since the statistics were reset.
+    size_t mAllocations = 0;        //!< Allocations made building the tree of the last parse, string text, keys, array storage and object entries.
+    size_t mReused = 0;             //!< Times the last parse used memory kept from an earlier tree and did not have to allocate.
+    size_t mTotalAllocations = 0;   //!< mAllocations of all the parses.
+    size_t mDuplicateKeys = 0;      //!< Keys in the last parse that were already in their object, their values were parsed into the first entry.
+
+    // These are only filled in if JsonProcessor::EnableStatistics has been called, they need a walk of the tree after each parse.
+    JsonMemoryUsage mTree;          //!< The tree of the last parse.
+    size_t mSpareBytes = 0;         //!< Memory kept from earlier trees waiting to be used again.
+    size_t mPeakBytes = 0;          //!< The most the tree and the spare memory have used together at the end of a parse.
+};
+
+/**
+ * @brief This is the work horse that builds our data structure that mirrors the json data.
+ */
+class JsonProcessor : private JsonScanner
+{
+    friend class JsonArrayReader;
+public:
+    /**
+     * @brief Construct a new Json Processor object and parse the json data.
+     * throws std::runtime_error if the json is not constructed correctly.
+     * If pFailOnDuplicateKeys is true and two keys at the same level are found to have the same name then we'll throw an exception.
+     */
+	JsonProcessor(const std::string& pJsonString,bool pFailOnDuplicateKeys = false) :
+        JsonProcessor(pJsonString.data(),pJsonString.size(),pFailOnDuplicateKeys,true){}
+
+    /**
+     * @brief Parses a null terminated c string, saves you having to make a std::string copy of it first.
+     */
+	JsonProcessor(const char* pJsonString,bool pFailOnDuplicateKeys = false) :
+        JsonProcessor(pJsonString,pJsonString?strlen(pJsonString):0,pFailOnDuplicateKeys,true){}
+
+#if __cplusplus >= 201703L
+	JsonProcessor(std::string_view pJsonString,bool pFailOnDuplicateKeys = false) :
+        JsonProcessor(pJsonString.data(),pJsonString.size(),pFailOnDuplicateKeys){}
+#endif
+
+    /**
+     * @brief Parses pLength bytes of json directly from the memory passed in, no copy of the data is made.
+     * The data does not have to be null terminated, it can be a slice of a larger buffer, the parser will never read past pJsonString + pLength.
+     * The memory only has to be valid for the life of the constructor, everything is copied out into the JsonValue tree.
+     * Set pNullTerminated if the byte at pJsonString[pLength] is readable and is zero, for example a std::string's buffer, an mmapped
+     * file that does not fill its last page or a ring buffer where you have written a zero after the record.
+     * With that padding byte the scanning loops stop on it and do not have to test for the end of the data on every character.
+     * Is a template so that any integer type can be used for the length without it being mistaken for the bool of the constructor above.
+     */
+    template <typename LENGTH_TYPE,typename = typename std::enable_if<std::is_integral<LENGTH_TYPE>::value && !std::is_same<LENGTH_TYPE,bool>::value>::type>
+	JsonProcessor(const char* pJsonString,LENGTH_TYPE pLength,bool pFailOnDuplicateKeys = false,bool pNullTerminated = false) :
+        JsonProcessor(pJsonString,size_t(pLength),pFailOnDuplicateKeys,pNullTerminated,nullptr){}
+
+    /**
+     * @brief Parses the json using the threads of pPool, for large documents, 256KB or more, where most of the data is in arrays.
+     * A quick pass over the structure finds the big arrays, their elements are parsed at the same time on the pool and then put into the tree.
+     * The result and the errors thrown are the same as the constructors above, small documents are just parsed on the calling thread,
+     * as is everything on a machine with one core, where the threads of the pool would only take turns.
+     */
+	JsonProcessor(const std::string& pJsonString,JsonThreadPool& pPool,bool pFailOnDuplicateKeys = false) :
+        JsonProcessor(pJsonString.data(),pJsonString.size(),pFailOnDuplicateKeys,true,&pPool){}
+
+    template <typename LENGTH_TYPE,typename = typename std::enable_if<std::is_integral<LENGTH_TYPE>::value && !std::is_same<LENGTH_TYPE,bool>::value>::type>
+	JsonProcessor(const char* pJsonString,LENGTH_TYPE pLength,JsonThreadPool& pPool,bool pFailOnDuplicateKeys = false,bool pNullTerminated = false) :
+        JsonProcessor(pJsonString,size_t(pLength),pFailOnDuplicateKeys,pNullTerminated,&pPool){}
+
+    /**
+     * @brief Parses the json checking it against pSchema as the values are made, so bad json is turned down before the rest of the tree is built.
+     * throws std::runtime_error with the line and column of the first value that does not match the schema.
+     */
+	JsonProcessor(const std::string& pJsonString,const JsonSchema& pSchema,bool pFailOnDuplicateKeys = false) :
+        JsonProcessor(pJsonString.data(),pJsonString.size(),pFailOnDuplicateKeys,true,nullptr,&pSchema){}
+
+    template <typename LENGTH_TYPE,typename = typename std::enable_if<std::is_integral<LENGTH_TYPE>::value && !std::is_same<LENGTH_TYPE,bool>::value>::type>
+	JsonProcessor(const char* pJsonString,LENGTH_TYPE pLength,const JsonSchema& pSchema,bool pFailOnDuplicateKeys = false,bool pNullTerminated = false) :
+        JsonProcessor(pJsonString,size_t(pLength),pFailOnDuplicateKeys,pNullTerminated,nullptr,&pSchema){}
+
+    /**
+     * @brief Makes a processor that has not parsed anything yet, give it json with one of the Parse functions.
+     * Keeping one processor and calling Parse for each message means the memory of the last tree is used again for the next one,
+     * once a few messages of a similar shape have been through parsing does very few allocations.
+     */
+    JsonProcessor(){}
+
+    /**
+     * @brief Parses the json, replacing the tree of the last parse, references from GetRoot before the call are no longer valid.
+     * The strings, arrays and object entries of the old tree are kept and handed out again as the new tree is built.
+     * Takes the same arguments and throws the same errors as the matching constructor, returns the new root.
+     */
+    const JsonValue& Parse(const std::string& pJsonString,bool pFailOnDuplicateKeys = false)
+    {
+        return Start(pJsonString.data(),pJsonString.size(),pFailOnDuplicateKeys,true,nullptr);
+    }
+
+    const JsonValue& Parse(const char* pJsonString,bool pFailOnDuplicateKeys = false)
+    {
+        return Start(pJsonString,pJsonString?strlen(pJsonString):0,pFailOnDuplicateKeys,true,nullptr);
+    }
+
+#if __cplusplus >= 201703L
+    const JsonValue& Parse(std::string_view pJsonString,bool pFailOnDuplicateKeys = false)
+    {
+        return Start(pJsonString.data(),pJsonString.size(),pFailOnDuplicateKeys,false,nullptr);
+    }
+#endif
+
+    template <typename LENGTH_TYPE,typename = typename std::enable_if<std::is_integral<LENGTH_TYPE>::value && !std::is_same<LENGTH_TYPE,bool>::value>::type>
+    const JsonValue& Parse(const char* pJsonString,LENGTH_TYPE pLength,bool pFailOnDuplicateKeys = false,bool pNullTerminated = false)
+    {
+        return Start(pJsonString,size_t(pLength),pFailOnDuplicateKeys,pNullTerminated,nullptr);
+    }
+
+    const JsonValue& Parse(const std::string& pJsonString,JsonThreadPool& pPool,bool pFailOnDuplicateKeys = false)
+    {
+        return Start(pJsonString.data(),pJsonString.size(),pFailOnDuplicateKeys,true,&pPool);
+    }
+
+    template <typename LENGTH_TYPE,typename = typename std::enable_if<std::is_integral<LENGTH_TYPE>::value && !std::is_same<LENGTH_TYPE,bool>::value>::type>
+    const JsonValue& Parse(const char* pJsonString,LENGTH_TYPE pLength,JsonThreadPool& pPool,bool pFailOnDuplicateKeys = false,bool pNullTerminated = false)
+    {
+        return Start(pJsonString,size_t(pLength),pFailOnDuplicateKeys,pNullTerminated,&pPool);
+    }
+
+    const JsonValue& Parse(const std::string& pJsonString,const JsonSchema& pSchema,bool pFailOnDuplicateKeys = false)
+    {
+        return Start(pJsonString.data(),pJsonString.size(),pFailOnDuplicateKeys,true,nullptr,&pSchema);
+    }
+
+    template <typename LENGTH_TYPE,typename = typename std::enable_if<std::is_integral<LENGTH_TYPE>::value && !std::is_same<LENGTH_TYPE,bool>::value>::type>
+    const JsonValue& Parse(const char* pJsonString,LENGTH_TYPE pLength,const JsonSchema& pSchema,bool pFailOnDuplicateKeys = false,bool pNullTerminated = false)
+    {
+        return Start(pJsonString,size_t(pLength),pFailOnDuplicateKeys,pNullTerminated,nullptr,&pSchema);
+    }
+
+    /**
+     * @brief Frees the memory kept back from earlier parses, the current tree is not touched.
+     * Use after parsing something unusually big so the processor does not hold on to it.
+     */
+    void ReleaseMemory()
+    {
+        ReleaseSpares();
+        std::vector<JsonValue*>().swap(mRecycleList);
+        std::vector<Frame>().swap(mStack);
+    }
+
+    /**
+     * @brief Sets how deeply arrays and objects can be nested, json nested deeper is turned down with an error. DEFAULT_MAX_DEPTH to start with.
+     * Parsing does not recurse, so this is not to protect the stack of the thread parsing, any depth could be read.
+     * It is for json from clients that can not be trusted, a few kilobytes of '[' is turned down as soon as it gets too deep.
+     */
+    void SetMaxDepth(size_t pMaxDepth)
+    {
+        mMaxDepth = pMaxDepth;
+    }
+
+    using JsonScanner::DEFAULT_MAX_DEPTH;
+
+    /**
+     * @brief Get the Root object
+     */
+    const JsonValue& GetRoot()const
+    {
+        return mRoot;
+    }
+
+    /**
+     * @brief Moves the parsed tree out of the processor, saves a deep copy when the tree has to outlive the processor.
+     */
+    JsonValue TakeRoot()
+    {
+        return std::move(mRoot);
+    }
+
+    /**
+     * Convenient way to access values in the root object.
+    */
+    const JsonValue& operator [](const std::string& pKey)const
+    {
+        return GetRoot()[pKey];
+    }
+
+    /**
+     * @brief The allocations of the parses, and if EnableStatistics has been called the memory of the tree and what is kept for the next one.
+     * JsonValue uses the std containers with the default allocator, so the allocations are counted where the parser makes them and not by hooking the allocator.
+     */
+    const JsonParseStatistics& GetStatistics()const
+    {
+        return mStatistics;
+    }
+
+    /**
+     * @brief Turns on working out the memory used after each parse, costs a walk of the tree each time. The allocations are counted either way.
+     */
+    void EnableStatistics(bool pEnable = true)
+    {
+        mStatisticsEnabled = pEnable;
+    }
+
+    void ResetStatistics()
+    {
+        mStatistics = JsonParseStatistics();
+    }
+
+    /**
+     * @brief Turns on working out JsonValue::mHash for the arrays and objects of each tree parsed, so comparing trees and putting them in
+     * unordered containers does not walk them again. In a parallel parse the elements of the big arrays are hashed on the pool.
+     */
+    void EnableHashing(bool pEnable = true)
+    {
+        mHashingEnabled = pEnable;
+    }
+
+#ifdef TINYJSON_PROFILE
+    /**
+     * @brief Where the time of the parses since the last ResetProfile went. For a parallel parse the phases add up the time of all the threads.
+     */
+    const JsonParseProfile& GetProfile()const
+    {
+        return mProfile;
+    }
+
+    void ResetProfile()
+    {
+        mProfile = JsonParseProfile();
+    }
+#endif
+
+private:
+    static const size_t PARALLEL_MIN_SIZE = 256 * 1024; //!< Below this it is quicker to just parse the json than to split it up.
+
+    JsonParseStatistics mStatistics;
+    bool mStatisticsEnabled = false;
+    bool mHashingEnabled = false;
+
+    bool mFailOnDuplicateKeys = false;  //!< If true and two keys at the same level are found to have the same name then we'll throw an exception.
+    JsonValue mRoot = JsonValue(JsonValueType::INVALID); //!< When all is done, this contains the json as usable c++ objects.
+    JsonStructureIndex* mStructureIndex = nullptr; //!< Set during a parallel parse, the big arrays that have had their elements parsed on the thread pool.
+    const JsonSchema* mSchema = nullptr;    //!< If set the values are checked against it as they are made.
+
+    /**
+     * @brief An array or object that MakeValue is part way through.
+     */
+    struct Frame
+    {
+        JsonValue* mValue;          //!< The array or object being filled in.
+        const JsonSchema* mSchema;  //!< Its schema, null if there is none.
+        const char* mStart;         //!< Where it starts in the json, for schema errors.
+        const std::string* mKey;    //!< For an object, the key of the entry being read, for errors.
+    };
+    std::vector<Frame> mStack;      //!< The arrays and objects being filled in, the root at the front. Kept between parses.
+    size_t mDeepest = 0;            //!< The deepest mStack has been this parse, for the parallel parse to check the depth of its elements.
+
+    std::vector<std::string> mSpareStrings;             //!< String buffers from the last tree, ReadString takes one when a string will not fit.
+    std::vector<std::vector<JsonValue>> mSpareArrays;   //!< Emptied arrays from the last tree that still have their capacity.
+#if __cplusplus >= 201703L
+    std::vector<JsonKeyValue::node_type> mSpareEntries; //!< Object entries from the last tree, key and value, put into new objects without allocating.
+#endif
+    std::vector<JsonValue*> mRecycleList;               //!< Kept between parses so RecycleTree does not allocate either.
+
+    /**
+     * @brief All the public constructors end up here, if pPool is not null the json is parsed in parallel.
+     */
+	JsonProcessor(const char* pJsonString,size_t pLength,bool pFailOnDuplicateKeys,bool pNullTerminated,JsonThreadPool* pPool,const JsonSchema* pSchema = nullptr)
+    {
+        Start(pJsonString,pLength,pFailOnDuplicateKeys,pNullTerminated,pPool,pSchema);
+    }
+
+    /**
+     * @brief Resets the processor for new data and parses it, used by the constructors and the Parse functions.
+     * pDocument is set when the json is part of a bigger document, so errors give the line and column in it, see JsonScanner::SetLinesFrom.
+     */
+    const JsonValue& Start(const char* pJsonString,size_t pLength,bool pFailOnDuplicateKeys,bool pNullTerminated,JsonThreadPool* pPool,const JsonSchema* pSchema = nullptr,const JsonScanner* pDocument = nullptr)
+    {
+        RecycleTree();
+        mFailOnDuplicateKeys = pFailOnDuplicateKeys;
+        mSchema = pSchema;
+        mStack.clear(); // Will have frames left on it if the last parse failed.
+        mDeepest = 0;
+        mStatistics.mAllocations = mStatistics.mReused = mStatistics.mDuplicateKeys = 0;
+        Reset(pJsonString,pLength,pNullTerminated);
+        if( pDocument )
+        {
+            SetLinesFrom(*pDocument);
+        }
+
+        if( pJsonString == nullptr || pLength == 0 )
+        {
+            THROW_JSON_EXCEPTION("Empty string passed into ParseJson");
+        }
+
+        {
+#ifdef TINYJSON_PROFILE
+            JsonProfileScope profileParse(mProfile.mParses,mPos);
+#endif
+            if( pPool && pPool->GetNumThreads() > 1 && std::thread::hardware_concurrency() > 1 && pLength >= PARALLEL_MIN_SIZE )
+            {
+                ParseInParallel(*pPool);
+            }
+            else
+            {
+                ParseRoot();
+            }
+        }
+
+        if( mHashingEnabled )
+        {
+            // Arrays and objects were hashed as they were closed, this picks up the root when it is not one.
+            JsonValue::HashTree(mRoot,[](const JsonValue& pValue){return pValue.mHash;},[](const JsonValue& pValue,uint64_t pHash){const_cast<JsonValue&>(pValue).mHash = pHash;});
+        }
+
+        mStatistics.mParses++;
+        mStatistics.mTotalAllocations += mStatistics.mAllocations;
+        if( mStatisticsEnabled )
+        {
+            UpdateMemoryStatistics();
+        }
+        return mRoot;
+    }
+
+    /**
+     * @brief Works out the memory of the new tree and of the spare lists for the statistics.
+     */
+    void UpdateMemoryStatistics()
+    {
+        mStatistics.mTree = mRoot.MemoryUsage();
+        mStatistics.mSpareBytes = mSpareArrays.capacity() * sizeof(std::vector<JsonValue>) + mSpareStrings.capacity() * sizeof(std::string);
+        for( const auto& spare : mSpareStrings )
+        {
+            mStatistics.mSpareBytes += JsonValue::GetHeapBytes(spare);
+        }
+        for( const auto& spare : mSpareArrays )
+        {
+            mStatistics.mSpareBytes += spare.capacity() * sizeof(JsonValue);
+        }
+#if __cplusplus >= 201703L
+        mStatistics.mSpareBytes += mSpareEntries.capacity() * sizeof(JsonKeyValue::node_type);
+        for( const auto& spare : mSpareEntries )
+        {
+            mStatistics.mSpareBytes += JsonValue::GetEntryBytes() + JsonValue::GetHeapBytes(spare.key());
+        }
+#endif
+        mStatistics.mPeakBytes = std::max(mStatistics.mPeakBytes,mStatistics.mTree.GetTotalBytes() + mStatistics.mSpareBytes);
+    }
+
+    /**
+     * @brief Empties mRoot, keeping the memory it used in the spare lists for the next parse.
+     * All the values are listed parents first and then emptied from the back, so the children are done before the array or object holding them is cleared.
+     * Done with a list and not recursion so that a very deep tree can not run out of stack.
+     */
+    void RecycleTree()
+    {
+        const size_t smallString = std::string().capacity(); // Strings this short live inside the std::string, nothing to keep.
+
+        mRecycleList.clear();
+        mRecycleList.push_back(&mRoot);
+        for( size_t n = 0 ; n < mRecycleList.size() ; n++ )
+        {
+            JsonValue* value = mRecycleList[n];
+            for( auto& element : value->mArray )
+            {
+                mRecycleList.push_back(&element);
+            }
+            for( auto& entry : value->mObject )
+            {
+                mRecycleList.push_back(&entry.second);
+            }
+        }
+
+        for( size_t n = mRecycleList.size() ; n > 0 ; n-- )
+        {
+            JsonValue& value = *mRecycleList[n-1];
+            if( value.mValue.capacity() > smallString )
+            {
+                mSpareStrings.push_back(std::move(value.mValue));
+                mSpareStrings.back().clear();
+            }
+            value.mValue.clear();
+
+            if( value.mArray.capacity() > 0 )
+            {
+                value.mArray.clear();
+                mSpareArrays.push_back(std::move(value.mArray));
+                value.mArray.clear();
+            }
+
+#if __cplusplus >= 201703L
+            while( value.mObject.size() > 0 )
+            {
+                mSpareEntries.push_back(value.mObject.extract(value.mObject.begin()));
+            }
+#else
+            value.mObject.clear();
+#endif
+            value.mType = JsonValueType::INVALID;
+            value.mBoolean = false;
+            value.mHash = 0;
+        }
+        mRecycleList.clear();
+    }
+
+    /**
+     * @brief Frees everything in the spare lists.
+     */
+    void ReleaseSpares()
+    {
+        std::vector<std::string>().swap(mSpareStrings);
+        std::vector<std::vector<JsonValue>>().swap(mSpareArrays);
+#if __cplusplus >= 201703L
+        std::vector<JsonKeyValue::node_type>().swap(mSpareEntries);
+#endif
+    }
+
+    /**
+     * @brief Moves pCount spares, or all of them if there are fewer, from the back of rFrom to rTo.
+     */
+    template <typename SPARE_TYPE>
+    static void MoveSpares(std::vector<SPARE_TYPE>& rFrom,std::vector<SPARE_TYPE>& rTo,size_t pCount)
+    {
+        pCount = std::min(pCount,rFrom.size());
+        for( size_t n = 0 ; n < pCount ; n++ )
+        {
+            rTo.push_back(std::move(rFrom.back()));
+            rFrom.pop_back();
+        }
+    }
+
+    /**
+     * @brief Copies the characters into rString, if they will not fit it first swaps in a spare string from the last parse.
+     */
+    void AssignString(std::string& rString,const char* pStart,size_t pLength)
+    {
+        if( pLength > rString.capacity() )
+        {
+            if( mSpareStrings.size() > 0 )
+            {
+                rString.swap(mSpareStrings.back());
+                mSpareStrings.pop_back();
+                mStatistics.mReused++;
+            }
+            if( pLength > rString.capacity() )
+            {
+                mStatistics.mAllocations++;
+            }
+        }
+        rString.assign(pStart,pLength);
+    }
+
+    void ParseRoot()
+    {
+        MakeValue(mRoot,mSchema); // Now lets get going. :D
+        SkipWhiteSpace();
+        if( mPos < mJsonEnd )// Now should be at the end
+        {
+            THROW_JSON_EXCEPTION("Data found after root object, invalid Json");
+        }
+    }
+
+    /**
+     * @brief Finds the big arrays, parses their elements on the pool and then does a normal parse that picks them up as it reaches each big array.
+     * If anything goes wrong the json is parsed again in the normal way, so the error the user sees is exactly the one they would have had without the pool.
+     * The spares are shared out between the jobs and this pass, what is not used is freed at the end so the spare lists never hold more than one tree.
+     */
+    void ParseInParallel(JsonThreadPool& pPool)
+    {
+        try
+        {
+            const size_t bigArraySize = std::max(size_t(JsonStructureIndex::MIN_ARRAY_SIZE),size_t(mJsonEnd - mJsonStart) / (pPool.GetNumThreads() * 8));
+            JsonStructureIndex index(mJsonStart,mJsonEnd,bigArraySize,pPool);
+            ParseArrayElements(index,bigArraySize,pPool);
+
+            mStructureIndex = &index;
+            ParseRoot();
+            mStructureIndex = nullptr;
+            ReleaseSpares();
+            return;
+        }
+        catch(const std::exception&){}
+
+        mStructureIndex = nullptr;
+        RecycleTree();
+        mStack.clear();
+        Reset(mJsonStart,size_t(mJsonEnd - mJsonStart),mNullTerminated);
+        ParseRoot();
+        ReleaseSpares();
+    }
+
+    /**
+     * @brief Parses the elements of the big arrays on the pool, consecutive elements are grouped into jobs of about pJobSize bytes.
+     * Elements that have another big array inside are skipped, they are done by the sequential pass so that the array inside them can be split too.
+     * Each job is given a share of the spare lists in proportion to its bytes, the rest is left for the sequential pass.
+     */
+    void ParseArrayElements(JsonStructureIndex& rIndex,size_t pJobSize,JsonThreadPool& pPool)
+    {
+        struct Job
+        {
+            JsonStructureIndex::Array* mArray;
+            size_t mFirst,mLast;
+            size_t mBytes;          //!< Of json in its elements.
+            size_t mDepth;          //!< The deepest of its elements.
+            size_t mAllocations;    //!< Made parsing its elements.
+            size_t mReused;         //!< Spares used parsing its elements.
+            size_t mDuplicateKeys;  //!< Found parsing its elements.
+        };
+        std::vector<Job> jobs;
+
+        for( auto& array : rIndex.GetArrays() )
+        {
+            const size_t count = array.GetElementCount();
+            array.mElements.resize(count);
+            array.mElementParsed.assign(count,false);
+
+            Job job = {&array,0,0,0,0,0,0,0};
+            for( size_t n = 0 ; n < count ; n++ )
+            {
+                const char* start = array.GetElementStart(n);
+                const char* end = array.GetElementEnd(n);
+                const bool sequential = rIndex.HasArrayIn(start,end);
+                if( sequential || job.mBytes >= pJobSize )
+                {
+                    if( job.mLast > job.mFirst ){jobs.push_back(job);}
+                    job.mFirst = job.mLast = sequential ? n + 1 : n;
+                    job.mBytes = 0;
+                }
+
+                if( !sequential )
+                {
+                    array.mElementParsed[n] = true;
+                    job.mLast = n + 1;
+                    job.mBytes += end - start;
+                }
+            }
+            if( job.mLast > job.mFirst ){jobs.push_back(job);}
+        }
+
+        // Shares are worked out from the counts before any are taken, so every job gets its part of each list.
+        struct Spares
+        {
+            std::vector<std::string> mStrings;
+            std::vector<std::vector<JsonValue>> mArrays;
+#if __cplusplus >= 201703L
+            std::vector<JsonKeyValue::node_type> mEntries;
+#endif
+        };
+        std::vector<Spares> spares(jobs.size());
+        const size_t totalBytes = std::max(size_t(mJsonEnd - mJsonStart),size_t(1));
+        const size_t spareStrings = mSpareStrings.size();
+        const size_t spareArrays = mSpareArrays.size();
+#if __cplusplus >= 201703L
+        const size_t spareEntries = mSpareEntries.size();
+#endif
+        for( size_t n = 0 ; n < jobs.size() ; n++ )
+        {
+            const double share = double(jobs[n].mBytes) / double(totalBytes);
+            MoveSpares(mSpareStrings,spares[n].mStrings,size_t(spareStrings * share));
+            MoveSpares(mSpareArrays,spares[n].mArrays,size_t(spareArrays * share));
+#if __cplusplus >= 201703L
+            MoveSpares(mSpareEntries,spares[n].mEntries,size_t(spareEntries * share));
+#endif
+        }
+
+        const bool failOnDuplicateKeys = mFailOnDuplicateKeys;
+        const size_t maxDepth = mMaxDepth;
+        const bool hashing = mHashingEnabled;
+#ifdef TINYJSON_PROFILE
+        std::vector<JsonParseProfile> profiles(jobs.size());
+        pPool.ParallelFor(jobs.size(),[&jobs,&spares,&profiles,failOnDuplicateKeys,maxDepth,hashing](size_t pJob)
+#else
+        pPool.ParallelFor(jobs.size(),[&jobs,&spares,failOnDuplicateKeys,maxDepth,hashing](size_t pJob)
+#endif
+        {
+            Job& job = jobs[pJob];
+            JsonStructureIndex::Array& array = *job.mArray;
+            JsonProcessor element;
+            element.SetMaxDepth(maxDepth);
+            element.EnableHashing(hashing);
+            element.mSpareStrings.swap(spares[pJob].mStrings);
+            element.mSpareArrays.swap(spares[pJob].mArrays);
+#if __cplusplus >= 201703L
+            element.mSpareEntries.swap(spares[pJob].mEntries);
+#endif
+            for( size_t n = job.mFirst ; n < job.mLast ; n++ )
+            {
+                const char* start = array.GetElementStart(n);
+                element.Parse(start,array.GetElementEnd(n) - start,failOnDuplicateKeys);
+                job.mDepth = std::max(job.mDepth,element.mDeepest);
+                job.mReused += element.mStatistics.mReused;
+                job.mDuplicateKeys += element.mStatistics.mDuplicateKeys;
+                array.mElements[n] = element.TakeRoot();
+            }
+            job.mAllocations = element.mStatistics.mTotalAllocations;
+#ifdef TINYJSON_PROFILE
+            profiles[pJob] = element.mProfile;
+            profiles[pJob].mParses = JsonParseProfile::Counter(); // The element parses are not whole parses of this json.
+#endif
+        });
+
+        for( const Job& job : jobs )
+        {
+            job.mArray->mDepth = std::max(job.mArray->mDepth,job.mDepth);
+            mStatistics.mAllocations += job.mAllocations;
+            mStatistics.mReused += job.mReused;
+            mStatistics.mDuplicateKeys += job.mDuplicateKeys;
+        }
+#ifdef TINYJSON_PROFILE
+        for( const JsonParseProfile& profile : profiles )
+        {
+            mProfile += profile;
+        }
+#endif
+    }
+
+    /**
+     * @brief Called by MakeValue in a parallel parse when it gets to a big array. Moves in the elements parsed on the pool and parses the rest here.
+     */
+    void StitchArray(JsonStructureIndex::Array& rArray,JsonValue& rNewValue)
+    {
+        // The elements were parsed without knowing how deep the array is, if together they are too deep we throw and the sequential parse gives the error.
+        AssertDepth(mStack.size() + 1 + rArray.mDepth);
+
+        rNewValue.mArray = std::move(rArray.mElements);
+        const Frame frame = {&rNewValue,nullptr,rArray.mStart,nullptr};
+        mStack.push_back(frame); // So the elements parsed here count the array in their depth.
+        for( size_t n = 0 ; n < rNewValue.mArray.size() ; n++ )
+        {
+            if( rArray.mElementParsed[n] == false )
+            {
+                SkipTo(rArray.GetElementStart(n));
+                MakeValue(rNewValue.mArray[n]);
+                if( mPos != rArray.GetElementEnd(n) )
+                {
+                    THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected in array element");
+                }
+            }
+        }
+        mStack.pop_back();
+        SkipTo(rArray.mEnd + 1);// Skip the ']'
+    }
+
+    /**
+     * @brief Builds the core value structure that powers Json.
+     * Does not recurse, the arrays and objects being filled in are kept on mStack so hostile json nested a million deep can not run out of stack.
+     * Each time round the loop one value is started, if it is an array or object that is not empty it is pushed and its first element started.
+     * Once a value is complete the arrays and objects it completes are finished and popped until one has another element to start.
+     * @param pNewValue As with the other functions, we don't return the new value but initialise the one passed in.
+     * @param pSchema If not null the value is checked against it, the type before anything is read and the rest once the value has been made.
+     */
+    void MakeValue(JsonValue& pNewValue,const JsonSchema* pSchema = nullptr)
+    {
+        const size_t stackBase = mStack.size(); // StitchArray calls back in here for some array elements.
+        JsonValue* value = &pNewValue;
+        const JsonSchema* schema = pSchema;
+        for(;;)
+        {
+            SkipWhiteSpace();// skip space and then see if it's an object, string, value or special state (TRUE,FALSE,NULL). We also skip white space before exit.
+            const char* valueStart = mPos; // For schema errors found once the value has been read.
+            value->mHash = 0; // A duplicate key is read into the value it had before.
+            if( schema )
+            {
+                const std::string error = schema->CheckStart(Peek());
+                if( error.size() > 0 )
+                {
+                    THROW_JSON_EXCEPTION(GetErrorPos() + error);
+                }
+            }
+
+            switch( Peek() )
+            {
+            case 0:
+                AssertMoreData("Abrupt end to json whilst looking for a value");
+                THROW_JSON_EXCEPTION(GetErrorPos() + "Invalid null character found at start of json value definition");
+                break;
+
+            case '{':
+            case '[':
+                {
+                    const bool object = Peek() == '{';
+                    value->mType = object ? JsonValueType::OBJECT : JsonValueType::ARRAY;
+                    AssertDepth(mStack.size() + 1);
+                    mDeepest = std::max(mDeepest,mStack.size() + 1);
+                    if( !object && mStructureIndex )
+                    {
+                        JsonStructureIndex::Array* bigArray = mStructureIndex->FindArray(mPos);
+                        if( bigArray )
+                        {
+                            StitchArray(*bigArray,*value);
+                            if( mHashingEnabled )
+                            {
+                                value->mHash = JsonValue::HashChildren(*value);
+                            }
+                            break;
+                        }
+                    }
+
+                    NextChar();// skip '[' or '{'
+                    SkipWhiteSpace();
+                    // It is posible that this is an empty array or object. Rather annoying that the spec allows that.
+                    if( Peek() == (object ? '}' : ']') )
+                    {
+                        NextChar();
+                        break;
+                    }
+
+                    const Frame frame = {value,schema,valueStart,nullptr};
+                    mStack.push_back(frame);
+                    value = object ? StartEntry(mStack.back(),schema) : StartElement(mStack.back(),schema);
+                }
+                continue; // Start its first element.
+
+            case '\"':
+                {
+                    TINYJSON_PROFILE_PHASE(STRINGS);
+                    value->mType = JsonValueType::STRING;
+                    ReadString(value->mValue);
+                }
+                break;
+
+            case 'T':
+            case 't':
+                if( tolower(Peek(1)) == 'r' && tolower(Peek(2)) == 'u' && tolower(Peek(3)) == 'e' )
+                {
+                    TINYJSON_PROFILE_PHASE(LITERALS);
+                    SkipTo(mPos + 4);
+                    value->mType = JsonValueType::BOOLEAN;
+                    value->mBoolean = true;
+                }
+                else
+                {
+                    THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + Peek() + "\" found in json value definition reading true type");
+                }
+                break;
+
+            case 'F':
+            case 'f':
+                if( tolower(Peek(1)) == 'a' && tolower(Peek(2)) == 'l' && tolower(Peek(3)) == 's' && tolower(Peek(4)) == 'e' )
+                {
+                    TINYJSON_PROFILE_PHASE(LITERALS);
+                    SkipTo(mPos + 5);
+                    value->mType = JsonValueType::BOOLEAN;
+                    value->mBoolean = false;
+                }
+                else
+                {
+                    THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + Peek() + "\" found in json value definition reading false type");
+                }
+                break;
+
+            case 'N':
+            case 'n':
+                if( tolower(Peek(1)) == 'u' && tolower(Peek(2)) == 'l' && tolower(Peek(3)) == 'l' )
+                {
+                    TINYJSON_PROFILE_PHASE(LITERALS);
+                    SkipTo(mPos + 4);
+                    value->mType = JsonValueType::NULL_VALUE;
+                }
+                else
+                {
+                    THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + Peek() + "\" found in json value definition reading null type");
+                }
+                break;
+
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                {
+                    TINYJSON_PROFILE_PHASE(NUMBERS);
+                    value->mType = JsonValueType::NUMBER;
+                    ReadNumber(value->mValue);
+                }
+                break;
+
+            default:
+                THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + Peek() + "\" found at start of json value definition");
+                break;
+            }
+
+            // The value is complete, finish it and then the arrays and objects that it was the last element of.
+            for(;;)
+            {
+                if( schema )
+                {
+                    const std::string error = schema->CheckValue(*value);
+                    if( error.size() > 0 )
+                    {
+                        THROW_JSON_EXCEPTION(GetErrorPos(valueStart) + error);
+                    }
+                }
+
+                // Skip any human readble characters. We exit leaving pos on the next meaningful character.
+                SkipWhiteSpace();
+                if( mStack.size() == stackBase )
+                {
+                    return;
+                }
+
+                Frame& parent = mStack.back();
+                const bool object = parent.mValue->mType == JsonValueType::OBJECT;
+                if( Peek() == ',' )
+                {
+                    NextChar();
+                    SkipWhiteSpace();
+                    if( Peek() == (object ? '}' : ']') )
+                    {
+                        THROW_JSON_EXCEPTION(GetErrorPos() + (object ? "End of root object found, invalid Json. Comma with no object defined after it" : "Json format error detected, comma not follwed by a value."));
+                    }
+                    value = object ? StartEntry(parent,schema) : StartElement(parent,schema);
+                    break; // Start the next element.
+                }
+
+                if( Peek() != (object ? '}' : ']') )
+                {
+                    if( object )
+                    {
+                        THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, did you forget a comma between key value pairs? For key " + *parent.mKey);
+                    }
+                    THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, array not terminated with ']'");
+                }
+                NextChar();
+
+                value = parent.mValue;
+                schema = parent.mSchema;
+                valueStart = parent.mStart;
+                mStack.pop_back();
+                if( mHashingEnabled )
+                {
+                    // Hashed whilst its children are still in the cache.
+                    value->mHash = JsonValue::HashChildren(*value);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief For MakeValue, reads the key of the next entry of the object in rFrame and adds the entry. Returns the value to be read into.
+     * @param rSchema Set to the schema of the value.
+     */
+    JsonValue* StartEntry(Frame& rFrame,const JsonSchema*& rSchema)
+    {
+        JsonKeyValue& object = rFrame.mValue->mObject;
+
+        // When there is an entry left over from the last parse the key is read straight into it, saving the allocation of the key and the map node.
+        std::string objKey;
+#if __cplusplus >= 201703L
+        JsonKeyValue::node_type spareEntry;
+        if( mSpareEntries.size() > 0 )
+        {
+            spareEntry = std::move(mSpareEntries.back());
+            mSpareEntries.pop_back();
+            mStatistics.mReused++;
+        }
+        {
+            TINYJSON_PROFILE_PHASE(KEYS);
+            ReadString(spareEntry ? spareEntry.key() : objKey);
+        }
+#else
+        {
+            TINYJSON_PROFILE_PHASE(KEYS);
+            ReadString(objKey);
+        }
+#endif
+
+        // Now parse it's value.
+        SkipWhiteSpace();
+        AssertCorrectChar(':',"Json format error detected, seperator character ':'");
+        NextChar();
+
+        TINYJSON_PROFILE_PHASE(OBJECT_ENTRIES);
+        std::pair<JsonKeyValue::iterator,bool> entry;
+#if __cplusplus >= 201703L
+        if( spareEntry )
+        {
+            auto inserted = object.insert(std::move(spareEntry));
+            if( inserted.inserted == false )
+            {
+                mSpareEntries.push_back(std::move(inserted.node));
+            }
+            entry = std::make_pair(inserted.position,inserted.inserted);
+        }
+        else
+#endif
+        {
+            entry = object.emplace(std::move(objKey),JsonValue());
+            mStatistics.mAllocations++;
+        }
+
+        if( entry.second == false )
+        {
+            mStatistics.mDuplicateKeys++;
+        }
+
+        if( mFailOnDuplicateKeys && entry.second == false )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, two objects at the same level have the same key, " + entry.first->first);
+        }
+
+        rSchema = nullptr;
+        if( rFrame.mSchema )
+        {
+            const std::string error = rFrame.mSchema->CheckKey(entry.first->first,rSchema);
+            if( error.size() > 0 )
+            {
+                THROW_JSON_EXCEPTION(GetErrorPos() + error);
+            }
+        }
+
+        rFrame.mKey = &entry.first->first;
+        return &entry.first->second;
+    }
+
+    /**
+     * @brief For MakeValue, adds the next element to the array in rFrame and returns it to be read into.
+     * @param rSchema Set to the schema of the element.
+     */
+    JsonValue* StartElement(Frame& rFrame,const JsonSchema*& rSchema)
+    {
+        TINYJSON_PROFILE_PHASE(ARRAY_ELEMENTS);
+        std::vector<JsonValue>& array = rFrame.mValue->mArray;
+        if( array.capacity() == 0 && mSpareArrays.size() > 0 )
+        {
+            array.swap(mSpareArrays.back());
+            mSpareArrays.pop_back();
+            mStatistics.mReused++;
+        }
+        if( array.size() == array.capacity() )
+        {
+            mStatistics.mAllocations++; // The array grows.
+        }
+
+        rSchema = nullptr;
+        if( rFrame.mSchema )
+        {
+            const std::string error = rFrame.mSchema->CheckItemCount(array.size()+1);
+            if( error.size() > 0 )
+            {
+                THROW_JSON_EXCEPTION(GetErrorPos() + error);
+            }
+            rSchema = rFrame.mSchema->GetItems();
+        }
+
+        // Looks odd, but is the easiest / optimal way to reduce memory reallocations using c++11 features.
+        // The problem is that we have to make the value before adding to the vector, so we add an empty one and read into that.
+        array.resize(array.size()+1);
+        return &array.back();
+    }
+
+    /**
+     * @brief Reads a string value, the text is kept as it is in the json, escapes and all.
+     */
+    void ReadString(std::string& rString)
+    {
+        const char* stringStart;
+        size_t length;
+        ScanString(stringStart,length);
+        // Always assign, even when empty, the string may be one being used again.
+        AssignString(rString,stringStart,length);
+    }
+
+    /**
+     * @brief Reads the number that we just found the start too.
+     */
+    void ReadNumber(std::string& rString)
+    {
+        const char* valueStart;
+        size_t length;
+        ScanNumber(valueStart,length);
+        // This is a big win in the reading. I don't convert the type now, it is done when the user needs it.
+        // I've tested string_view. It reduces memory allocations by 40% but complicates the code as I have to insert NULLs into the data.
+        // Reading is so fast, even on low end arm chips, it's a pointless optimisation! Remember, I'm going for clean code.
+        AssignString(rString,valueStart,length);
+    }
+};//end of struct JsonProcessor
+
+/**
+ * @brief A parsed json document that can not be changed, so it can be shared by any number of threads and read at the same time without locks.
+ * Only const access to the tree is given, so the JsonValue operator [] that adds missing keys can not be used by mistake.
+ * Copying a JsonDocument only copies a reference to the tree, the tree is freed when the last copy goes.
+ */
+class JsonDocument
+{
+public:
+    /**
+     * @brief Makes an empty document, IsValid will return false.
+     */
+    JsonDocument() = default;
+
+    /**
+     * @brief Takes ownership of the tree, it can not be changed after this.
+     */
+    explicit JsonDocument(JsonValue&& pRoot) : mRoot(std::make_shared<const JsonValue>(std::move(pRoot))){}
+
+    /**
+     * @brief Parses the json into a new document, throws std::runtime_error if the json is not valid.
+     */
+    static JsonDocument Parse(const std::string& pJsonString,bool pFailOnDuplicateKeys = false)
+    {
+        JsonProcessor json(pJsonString,pFailOnDuplicateKeys);
+        return JsonDocument(json.TakeRoot());
+    }
+
+    static JsonDocument Parse(const char* pJsonString,size_t pLength,bool pFailOnDuplicateKeys = false)
+    {
+        JsonProcessor json(pJsonString,pLength,pFailOnDuplicateKeys);
+        return JsonDocument(json.TakeRoot());
+    }
+
+    bool IsValid()const{return mRoot != nullptr;}
+
+    const JsonValue& GetRoot()const
+    {
+        if( !mRoot )
+        {
+            THROW_JSON_EXCEPTION("JsonDocument is empty");
+        }
+        return *mRoot;
+    }
+
+    const JsonValue& operator [](const std::string& pKey)const
+    {
+        return GetRoot()[pKey];
+    }
+
+private:
+    friend class JsonDocumentHolder;
+    friend class JsonDocumentCache;
+    std::shared_ptr<const JsonValue> mRoot;
+
+    explicit JsonDocument(std::shared_ptr<const JsonValue> pRoot) : mRoot(std::move(pRoot)){}
+};
+
+/**
+ * @brief Holds the current version of a document, for things like a config that is reloaded whilst other threads are reading it.
+ * Publishing a new version does not touch the old one, threads that have it keep a valid tree until they let go of it.
+ * Readers that call Get all the time should use a JsonDocumentHolder::Reader, one per thread, which only looks at an atomic version number
+ * unless the document has changed. Get on its own is also safe from any thread but has to take a reference on the shared tree each time.
+ */
+class JsonDocumentHolder
+{
+public:
+    JsonDocumentHolder(JsonDocument pDocument = JsonDocument())
+    {
+        StoreRoot(std::move(pDocument.mRoot));
+    }
+
+    JsonDocumentHolder(const JsonDocumentHolder&) = delete;
+    JsonDocumentHolder& operator = (const JsonDocumentHolder&) = delete;
+
+    /**
+     * @brief Returns the current version of the document.
+     */
+    JsonDocument Get()const
+    {
+        return JsonDocument(LoadRoot());
+    }
+
+    /**
+     * @brief Publishes a new version of the document, readers pick it up the next time they ask.
+     */
+    void Set(JsonDocument pDocument)
+    {
+        std::unique_lock<std::mutex> lock(mWriterMutex);
+        Publish(std::move(pDocument.mRoot));
+    }
+
+    /**
+     * @brief Parses the json and publishes it. If the json is not valid an exception is thrown and the current version is left in place.
+     */
+    void Parse(const std::string& pJsonString,bool pFailOnDuplicateKeys = false)
+    {
+        Set(JsonDocument::Parse(pJsonString,pFailOnDuplicateKeys));
+    }
+
+    /**
+     * @brief Copy on write change, pChange is given a copy of the current tree to edit which is then published as the next version.
+     * Writers are done one at a time so no change is lost, readers are never blocked.
+     */
+    void Update(const std::function<void(JsonValue& rRoot)>& pChange)
+    {
+        std::unique_lock<std::mutex> lock(mWriterMutex);
+        const std::shared_ptr<const JsonValue> current = LoadRoot();
+        std::shared_ptr<JsonValue> next = current ? std::make_shared<JsonValue>(*current) : std::make_shared<JsonValue>(JsonValueType::INVALID);
+        pChange(*next);
+        Publish(std::move(next));
+    }
+
+    /**
+     * @brief Goes up by one each time a new version is published.
+     */
+    uint64_t GetVersion()const
+    {
+        return mVersion.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief A reader for one thread, keeps its own reference to the document and only swaps it when the version changes.
+     */
+    class Reader
+    {
+    public:
+        Reader(const JsonDocumentHolder& pHolder) : mHolder(pHolder){}
+
+        const JsonDocument& Get()
+        {
+            const uint64_t version = mHolder.GetVersion();
+            if( version != mVersion || !mDocument.IsValid() )
+            {
+                mDocument = mHolder.Get();
+                mVersion = version;
+            }
+            return mDocument;
+        }
+
+    private:
+        const JsonDocumentHolder& mHolder;
+        JsonDocument mDocument;
+        uint64_t mVersion = 0;
+    };
+
+private:
+    std::mutex mWriterMutex;
+    std::atomic<uint64_t> mVersion{0};
+#if __cplusplus >= 202002L
+    std::atomic<std::shared_ptr<const JsonValue>> mRoot;
+    std::shared_ptr<const JsonValue> LoadRoot()const{return mRoot.load();}
+    void StoreRoot(std::shared_ptr<const JsonValue> pRoot){mRoot.store(std::move(pRoot));}
+#else
+    std::shared_ptr<const JsonValue> mRoot;
+    std::shared_ptr<const JsonValue> LoadRoot()const{return std::atomic_load(&mRoot);}
+    void StoreRoot(std::shared_ptr<const JsonValue> pRoot){std::atomic_store(&mRoot,std::move(pRoot));}
+#endif
+
+    /**
+     * @brief The new tree is stored before the version is bumped, so a reader that sees the new version will get the new tree.
+     */
+    void Publish(std::shared_ptr<const JsonValue> pRoot)
+    {
+        StoreRoot(std::move(pRoot));
+        mVersion.fetch_add(1,std::memory_order_acq_rel);
+    }
+};
+
+/**
+ * @brief What a JsonDocumentCache has done, from JsonDocumentCache::GetStatistics.
+ */
+struct JsonCacheStatistics
+{
+    size_t mUnchanged = 0;      //!< Loads where the json was the same as last time and the document was returned as it was.
+    size_t mPartialParses = 0;  //!< Loads where only the part of the tree that changed was parsed again.
+    size_t mFullParses = 0;     //!< Loads where the whole json was parsed.
+    size_t mBytesParsed = 0;    //!< The json parsed by the partial and full parses.
+};
+
+/**
+ * @brief Keeps the last document loaded under each name, for config files and the like that are loaded again each time they are touched.
+ * Loading json that is the same as last time is a hash and a compare and returns the document already made.
+ * When it has changed the change is found by comparing with the last json, the text before and after it being the same.
+ * Only the smallest value that holds the whole change is parsed again and put into the tree in place of the old one.
+ * Values are found by reading over the old json, which is much quicker than parsing it. If the change is not inside one value,
+ * a key was changed or values were added or removed, it is the array or object holding them that is parsed again.
+ * Any problem with a partial parse, including the json no longer being valid, falls back to a full parse, so errors are exactly the ones JsonProcessor gives.
+ * The tree is changed in place when the cache has the only reference to it, otherwise the tree is copied first and documents already handed out do not change.
+ * Let go of the old document before loading again if you want to save the copy. Safe to use from any number of threads.
+ */
+class JsonDocumentCache
+{
+public:
+    JsonDocumentCache(bool pFailOnDuplicateKeys = false) : mFailOnDuplicateKeys(pFailOnDuplicateKeys){}
+
+    JsonDocumentCache(const JsonDocumentCache&) = delete;
+    JsonDocumentCache& operator = (const JsonDocumentCache&) = delete;
+
+    /**
+     * @brief Returns the document for the json, which was last loaded under pName. Throws std::runtime_error if the json is not valid,
+     * the document from the last load stays in the cache.
+     */
+    JsonDocument Load(const std::string& pName,const char* pJson,size_t pLength)
+    {
+        const uint64_t hash = JsonHashBytes(pJson,pLength);
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto found = mEntries.find(pName);
+        if( found != mEntries.end() )
+        {
+            Entry& entry = found->second;
+            if( entry.mHash == hash && entry.mJson.size() == pLength && memcmp(entry.mJson.data(),pJson,pLength) == 0 )
+            {
+                mStatistics.mUnchanged++;
+                return JsonDocument(entry.mRoot);
+            }
+
+            if( ParseChange(entry,pJson,pLength) == false )
+            {
+                Parse(entry,pJson,pLength);
+            }
+            entry.mJson.assign(pJson,pLength);
+            entry.mHash = hash;
+            return JsonDocument(entry.mRoot);
+        }
+
+        Entry entry;
+        Parse(entry,pJson,pLength);
+        entry.mJson.assign(pJson,pLength);
+        entry.mHash = hash;
+        return JsonDocument(mEntries.emplace(pName,std::move(entry)).first->second.mRoot);
+    }
+
+    JsonDocument Load(const std::string& pName,const std::string& pJson)
+    {
+        return Load(pName,pJson.data(),pJson.size());
+    }
+
+    /**
+     * @brief Forgets the document loaded under pName, documents that have been handed out are not touched.
+     */
+    void Remove(const std::string& pName)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mEntries.erase(pName);
+    }
+
+    void Clear()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mEntries.clear();
+    }
+
+    JsonCacheStatistics GetStatistics()const
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mStatistics;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t mHash = 0;
+        std::string mJson;                  //!< The json the tree was made from, to find what has changed.
+        std::shared_ptr<JsonValue> mRoot;   //!< Not const so the cache can change it when nobody else has it.
+        bool mDuplicateKeys = false;        //!< The values of a key seen twice are parsed into one entry, so the tree does not match the text well enough to put part of it in place.
+    };
+
+    /**
+     * @brief A step from a value to one of its children, by key for an object and by index for an array.
+     */
+    struct Step
+    {
+        std::string mKey;   //!< As the key is held in the tree, escapes and all.
+        size_t mIndex;
+    };
+
+    /**
+     * @brief Reads over the old json to find the smallest value that holds all of a change, without building anything.
+     * One pass up to the change keeps the arrays and objects that are open, the change itself says which of them it closes,
+     * then only the rest of the one that holds it is read to find its end. Reading each value on the way down to its end would read the
+     * biggest ones many times over.
+     */
+    class ChangeFinder
+    {
+    public:
+        /**
+         * @brief Sets rPath to the steps from the root to the value that has all of the bytes from pChangeStart to pChangeEnd strictly inside it,
+         * and rStart and rEnd to where that value is. Returns false if only the root holds the change.
+         */
+        bool Find(const std::string& pJson,size_t pChangeStart,size_t pChangeEnd,std::vector<Step>& rPath,size_t& rStart,size_t& rEnd)
+        {
+            mPos = pJson.data();
+            mJsonEnd = pJson.data() + pJson.size();
+            mLevels.clear();
+            rPath.clear();
+            const char* const changeStart = pJson.data() + pChangeStart;
+            const char* const changeEnd = pJson.data() + pChangeEnd;
+
+            // Up to the change, noting a string, number or literal that it starts inside of.
+            const char* valueStart = nullptr;
+            const char* valueEnd = nullptr;
+            while( mPos < changeStart && mPos < mJsonEnd )
+            {
+                const char* const tokenStart = mPos;
+                if( Next() && mPos > changeStart )
+                {
+                    valueStart = tokenStart;
+                    valueEnd = mPos;
+                }
+            }
+
+            if( valueStart && valueStart < changeStart && changeEnd < valueEnd )
+            {
+                if( mLevels.empty() )
+                {
+                    return false;
+                }
+                AddPath(mLevels.size(),rPath);
+                rStart = size_t(valueStart - pJson.data());
+                rEnd = size_t(valueEnd - pJson.data());
+                return true;
+            }
+
+            // Arrays and objects that close before the end of the change do not hold it.
+            size_t holding = mLevels.size();
+            while( mPos < changeEnd && mPos < mJsonEnd )
+            {
+                Next();
+                holding = std::min(holding,mLevels.size());
+            }
+            if( holding < 2 )
+            {
+                return false;
+            }
+
+            AddPath(holding - 1,rPath);
+            rStart = size_t(mLevels[holding - 1].mStart - pJson.data());
+            while( mLevels.size() >= holding && mPos < mJsonEnd )
+            {
+                Next();
+            }
+            rEnd = size_t(mPos - pJson.data());
+            return true;
+        }
+
+    private:
+        /**
+         * @brief An array or object that is open, with the child being read.
+         */
+        struct Level
+        {
+            const char* mStart; //!< The bracket that opened it.
+            bool mObject;
+            bool mWantKey;      //!< The next string is a key.
+            size_t mIndex;
+            const char* mKey;
+            size_t mKeyLength;
+        };
+
+        const char* mPos = nullptr;
+        const char* mJsonEnd = nullptr;
+        std::vector<Level> mLevels;
+
+        void AddPath(size_t pLevels,std::vector<Step>& rPath)const
+        {
+            for( size_t n = 0 ; n < pLevels ; n++ )
+            {
+                const Level& level = mLevels[n];
+                Step step;
+                if( level.mObject )
+                {
+                    step.mKey.assign(level.mKey,level.mKeyLength);
+                }
+                step.mIndex = level.mIndex;
+                rPath.push_back(std::move(step));
+            }
+        }
+
+        /**
+         * @brief Reads over the next character or token of json that is known to be valid, it parsed last time, only looking at quotes and brackets.
+         * Returns true if it was a value that is a string, number or literal.
+         */
+        bool Next()
+        {
+            const char c = *mPos;
+            switch( c )
+            {
+            case '{':
+            case '[':
+                mLevels.push_back({mPos,c == '{',c == '{',0,nullptr,0});
+                mPos++;
+                return false;
+
+            case '}':
+            case ']':
+                mLevels.pop_back();
+                mPos++;
+                return false;
+
+            case ',':
+                mLevels.back().mIndex++;
+                mLevels.back().mWantKey = mLevels.back().mObject;
+                mPos++;
+                return false;
+
+            case ':':
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                mPos++;
+                return false;
+
+            case '\"':
+                {
+                    const char* const start = mPos;
+                    // Find the closing quote, one with an even number of back slashes before it.
+                    for(;;)
+                    {
+                        mPos = (const char*)memchr(mPos + 1,'\"',mJsonEnd - mPos - 1);
+                        if( mPos == nullptr )
+                        {
+                            THROW_JSON_EXCEPTION("Abrupt end to json whilst reading string");
+                        }
+                        size_t slashes = 0;
+                        while( mPos[-1 - slashes] == '\\' )
+                        {
+                            slashes++;
+                        }
+                        if( slashes % 2 == 0 )
+                        {
+                            break;
+                        }
+                    }
+                    mPos++;
+                    if( mLevels.size() && mLevels.back().mWantKey )
+                    {
+                        mLevels.back().mKey = start + 1;
+                        mLevels.back().mKeyLength = size_t(mPos - start - 2);
+                        mLevels.back().mWantKey = false;
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // A number or literal.
+            while( mPos < mJsonEnd && *mPos != ',' && *mPos != '}' && *mPos != ']' && *mPos != ' ' && *mPos != '\t' && *mPos != '\n' && *mPos != '\r' )
+            {
+                mPos++;
+            }
+            return true;
+        }
+    };
+
+    const bool mFailOnDuplicateKeys;
+    mutable std::mutex mMutex;
+    std::map<std::string,Entry> mEntries;
+    JsonCacheStatistics mStatistics;
+
+    void Parse(Entry& rEntry,const char* pJson,size_t pLength)
+    {
+        JsonProcessor json(pJson,pLength,mFailOnDuplicateKeys);
+        mStatistics.mFullParses++;
+        mStatistics.mBytesParsed += pLength;
+        rEntry.mRoot = std::make_shared<JsonValue>(json.TakeRoot());
+        rEntry.mDuplicateKeys = json.GetStatistics().mDuplicateKeys > 0;
+    }
+
+    /**
+     * @brief Parses only the value that holds the change and puts it into the tree. Returns false if the whole json has to be parsed.
+     */
+    bool ParseChange(Entry& rEntry,const char* pJson,size_t pLength)
+    {
+        if( rEntry.mDuplicateKeys )
+        {
+            return false;
+        }
+
+        const std::string& old = rEntry.mJson;
+        const size_t shortest = std::min(old.size(),pLength);
+        size_t prefix = 0;
+        while( prefix < shortest && old[prefix] == pJson[prefix] )
+        {
+            prefix++;
+        }
+        size_t suffix = 0;
+        while( suffix < shortest - prefix && old[old.size() - 1 - suffix] == pJson[pLength - 1 - suffix] )
+        {
+            suffix++;
+        }
+
+        std::vector<Step> path;
+        size_t start = 0,end = 0;
+        JsonValue value;
+        bool duplicateKeys = false;
+        try
+        {
+            ChangeFinder finder;
+            if( finder.Find(old,prefix,old.size() - suffix,path,start,end) == false )
+            {
+                return false;
+            }
+
+            // The text after the value has not changed, so where it ends in the new json is moved by the change in length.
+            const size_t newEnd = end + pLength - old.size();
+            JsonProcessor json;
+            json.SetMaxDepth(JsonProcessor::DEFAULT_MAX_DEPTH - path.size());
+            json.Parse(pJson + start,newEnd - start,mFailOnDuplicateKeys);
+            value = json.TakeRoot();
+            duplicateKeys = json.GetStatistics().mDuplicateKeys > 0;
+            mStatistics.mBytesParsed += newEnd - start;
+        }
+        catch( const std::exception& )
+        {
+            return false; // The full parse will give the error, with the right line and column.
+        }
+
+        if( rEntry.mRoot.use_count() > 1 )
+        {
+            rEntry.mRoot = std::make_shared<JsonValue>(*rEntry.mRoot);
+        }
+        else
+        {
+            // use_count is a relaxed load, this makes the reads of a document another thread has just let go of happen before the writes below.
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        JsonValue* target = rEntry.mRoot.get();
+        for( const Step& step : path )
+        {
+            target->mHash = 0;
+            target = target->mType == JsonValueType::OBJECT ? &target->mObject.find(step.mKey)->second : &target->mArray[step.mIndex];
+        }
+        *target = std::move(value);
+        rEntry.mDuplicateKeys = duplicateKeys;
+        mStatistics.mPartialParses++;
+        return true;
+    }
+};
+
+/**
+ * @brief Writes json as it goes, without building a JsonValue tree first, for when the data is large or already in your own structures.
+ * Call BeginObject, Key, Value, EndObject, BeginArray, EndArray in the order the json is to be written, the calls can be chained.
+ *     writer.BeginObject().Key("name").Value("fred").Key("scores").BeginArray().Value(1).Value(2).EndArray().EndObject();
+ * The text is appended to a std::string, either yours or one inside the writer that is written out to a stream each time it gets to FLUSH_SIZE bytes.
+ * Strings passed in are escaped, a JsonValue is written as it is held, already escaped, as that is how the parser keeps it.
+ * The order of the calls is checked with assert, so a key outside an object or an EndArray that closes an object is caught in debug builds.
+ */
+class JsonStreamWriter
+{
+    friend class JsonReformatter;
+public:
+    static const size_t FLUSH_SIZE = 64 * 1024; //!< When writing to a stream, the most text that is held before it is written out.
+
+    /**
+     * @brief Appends the json to the end of rOutput, reserve space in it first if you know roughly how big the json will be.
+     * pIndent is the number of tabs the output is already indented by when pPretty is set.
+     */
+    JsonStreamWriter(std::string& rOutput,bool pPretty = false,int pIndent = 0) :
+        mOutput(rOutput),
+        mStream(nullptr),
+        mPretty(pPretty),
+        mIndent(pIndent)
+    {
+    }
+
+    /**
+     * @brief Writes the json to the stream, in blocks of FLUSH_SIZE, the last block is written by Flush or when the writer is destroyed.
+     */
+    JsonStreamWriter(std::ostream& rStream,bool pPretty = false,int pIndent = 0) :
+        mOutput(mBuffer),
+        mStream(&rStream),
+        mPretty(pPretty),
+        mIndent(pIndent)
+    {
+        mBuffer.reserve(FLUSH_SIZE + 1024);
+    }
+
+    ~JsonStreamWriter()
+    {
+        Flush();
+    }
+
+    JsonStreamWriter(const JsonStreamWriter&) = delete;
+    JsonStreamWriter& operator = (const JsonStreamWriter&) = delete;
+
+    JsonStreamWriter& BeginObject()
+    {
+        return Begin(true,'{');
+    }
+
+    JsonStreamWriter& EndObject()
+    {
+        return End(true,'}');
+    }
+
+    JsonStreamWriter& BeginArray()
+    {
+        return Begin(false,'[');
+    }
+
+    JsonStreamWriter& EndArray()
+    {
+        return End(false,']');
+    }
+
+    /**
+     * @brief Writes the key of the next value in the current object, must be followed by a value or a Begin.
+     */
+    JsonStreamWriter& Key(const char* pKey,size_t pLength)
+    {
+        WriteKey(pKey,pLength,true);
+        return *this;
+    }
+    JsonStreamWriter& Key(const std::string& pKey){return Key(pKey.data(),pKey.size());}
+    JsonStreamWriter& Key(const char* pKey){assert(pKey);return Key(pKey,strlen(pKey));}
+
+    JsonStreamWriter& Value(const char* pString,size_t pLength)
+    {
+        WriteString(pString,pLength,true);
+        return *this;
+    }
+    JsonStreamWriter& Value(const std::string& pString){return Value(pString.data(),pString.size());}
+    JsonStreamWriter& Value(const char* pString){assert(pString);return Value(pString,strlen(pString));}
+#if __cplusplus >= 201703L
+    JsonStreamWriter& Value(std::string_view pString){return Value(pString.data(),pString.size());}
+#endif
+
+    JsonStreamWriter& Value(bool pValue)
+    {
+        return Literal(pValue?"true":"false");
+    }
+
+    template<typename T,typename = typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T,bool>::value>::type>
+    JsonStreamWriter& Value(T pValue)
+    {
+        BeforeValue();
+        JsonAppendNumber(mOutput,pValue);
+        return AfterValue();
+    }
+
+    JsonStreamWriter& Null()
+    {
+        return Literal("null");
+    }
+
+    /**
+     * @brief Writes a value from a tree, the strings and numbers are written as the tree holds them.
+     */
+    JsonStreamWriter& Value(const JsonValue& pValue)
+    {
+        WriteTree(pValue,false);
+        return *this;
+    }
+
+    /**
+     * @brief Writes a value from a tree in the canonical form of RFC 8785, so values that are equal are written as the same bytes, for signing and content addressing.
+     * Keys are sorted by their utf16 code units, strings have only the escapes json needs and numbers are the fewest digits that read back as the same double,
+     * written the way javascript writes them. Make the writer without pPretty to get exactly the bytes of the RFC.
+     * Numbers too big for a double throw, there is no canonical form for them.
+     */
+    JsonStreamWriter& CanonicalValue(const JsonValue& pValue)
+    {
+        WriteTree(pValue,true);
+        return *this;
+    }
+
+    /**
+     * @brief Short hand for Key(pKey).Value(pValue)
+     */
+    template<typename T>
+    JsonStreamWriter& Member(const std::string& pKey,const T& pValue)
+    {
+        return Key(pKey).Value(pValue);
+    }
+
+    /**
+     * @brief Lays out pretty output the way JsonWriter always has, each array and object starts on a new line and an empty one is closed
+     * on the line after it is opened. Call before anything is written.
+     */
+    JsonStreamWriter& UseJsonWriterLayout()
+    {
+        mJsonWriterLayout = true;
+        return *this;
+    }
+
+    /**
+     * @brief True once a whole root value has been written.
+     */
+    bool IsComplete()const
+    {
+        return mRootWritten && mLevels.empty();
+    }
+
+    /**
+     * @brief When writing to a stream, writes out the text held so far.
+     */
+    void Flush()
+    {
+        if( mStream && mBuffer.size() > 0 )
+        {
+            mStream->write(mBuffer.data(),mBuffer.size());
+            mBuffer.clear();
+        }
+    }
+
+private:
+    /**
+     * @brief An object or array that has been started and not yet ended.
+     */
+    struct Level
+    {
+        bool mObject;       //!< True for an object, false for an array.
+        bool mEmpty;        //!< True until the first value or key is written, so we know when a comma is needed.
+    };
+
+    std::string mBuffer;                //!< Holds the text when writing to a stream.
+    std::string& mOutput;               //!< Where the text goes, the user's string or mBuffer.
+    std::ostream* const mStream;        //!< The stream mBuffer is written to, null when writing to the user's string.
+    const bool mPretty;                 //!< Puts values on their own lines with indentation.
+    const int mIndent;                  //!< The tabs the whole output is indented by.
+    bool mJsonWriterLayout = false;     //!< See UseJsonWriterLayout.
+    std::vector<Level> mLevels;         //!< The objects and arrays we are inside of.
+    bool mAfterKey = false;             //!< A key has been written and its value has not.
+    bool mRootWritten = false;          //!< There can only be one root value.
+    std::string mUnescaped;             //!< For CanonicalValue, the string being written with its escapes taken out.
+
+    /**
+     * @brief Writes a value from a tree with a list of the arrays and objects it is in and not recursion, so a very deep tree can not run out of stack.
+     * pCanonical writes it as CanonicalValue does.
+     */
+    void WriteTree(const JsonValue& pRoot,bool pCanonical)
+    {
+        struct Frame
+        {
+            const JsonValue* mValue;
+            size_t mElement;                        //!< The next element to write of an array, or of mSorted.
+            JsonKeyValue::const_iterator mEntry;    //!< The next entry to write of an object.
+            std::vector<const JsonKeyValue::value_type*> mSorted; //!< For CanonicalValue, the entries of an object whose keys are not in code unit order.
+        };
+        std::vector<Frame> stack;
+
+        const JsonValue* value = &pRoot;
+        while( value )
+        {
+            switch( value->mType )
+            {
+            case JsonValueType::STRING:
+                if( pCanonical )
+                {
+                    CanonicalText(value->mValue,false);
+                }
+                else
+                {
+                    WriteString(value->mValue.data(),value->mValue.size(),false);
+                }
+                break;
+
+            case JsonValueType::NUMBER:
+                BeforeValue();
+                if( pCanonical )
+                {
+                    CanonicalNumber(value->mValue);
+                }
+                else
+                {
+                    mOutput += value->mValue;
+                }
+                AfterValue();
+                break;
+
+            case JsonValueType::OBJECT:
+                BeginObject();
+                stack.push_back(Frame{value,0,value->mObject.begin(),{}});
+                if( pCanonical && KeysInCodeUnitOrder(value->mObject) == false )
+                {
+                    SortEntries(value->mObject,stack.back().mSorted);
+                }
+                break;
+
+            case JsonValueType::ARRAY:
+                BeginArray();
+                stack.push_back(Frame{value,0,JsonKeyValue::const_iterator(),{}});
+                break;
+
+            case JsonValueType::BOOLEAN:
+                Value(value->mBoolean);
+                break;
+
+            case JsonValueType::NULL_VALUE:
+            case JsonValueType::INVALID:
+                Null();
+                break;
+            }
+
+            // Find the next value to write, the arrays and objects that have been written in full are ended and taken off the list.
+            value = nullptr;
+            while( value == nullptr && stack.size() > 0 )
+            {
+                Frame& top = stack.back();
+                if( top.mValue->mType == JsonValueType::OBJECT )
+                {
+                    const JsonKeyValue::value_type* entry = nullptr;
+                    if( top.mSorted.size() > 0 )
+                    {
+                        entry = top.mElement < top.mSorted.size() ? top.mSorted[top.mElement++] : nullptr;
+                    }
+                    else if( top.mEntry != top.mValue->mObject.end() )
+                    {
+                        entry = &*top.mEntry;
+                        ++top.mEntry;
+                    }
+
+                    if( entry && pCanonical )
+                    {
+                        CanonicalText(entry->first,true);
+                        value = &entry->second;
+                    }
+                    else if( entry )
+                    {
+                        WriteKey(entry->first.data(),entry->first.size(),false);
+                        value = &entry->second;
+                    }
+                    else
+                    {
+                        stack.pop_back();
+                        EndObject();
+                    }
+                }
+                else if( top.mElement < top.mValue->mArray.size() )
+                {
+                    value = &top.mValue->mArray[top.mElement++];
+                }
+                else
+                {
+                    stack.pop_back();
+                    EndArray();
+                }
+            }
+        }
+    }
+
+    void NewLine()
+    {
+        if( mPretty )
+        {
+            mOutput += '\n';
+            mOutput.append(4 * (mIndent + mLevels.size()),' ');
+        }
+    }
+
+    /**
+     * @brief Writes the comma and new line that go before a value in an array, in an object the key has already done it.
+     */
+    void BeforeValue()
+    {
+        if( mLevels.empty() )
+        {
+            assert(mRootWritten == false && "JsonStreamWriter can only write one root value");
+            mRootWritten = true;
+        }
+        else if( mLevels.back().mObject )
+        {
+            assert(mAfterKey && "JsonStreamWriter value written in an object without a key");
+            mAfterKey = false;
+        }
+        else
+        {
+            if( mLevels.back().mEmpty == false )
+            {
+                mOutput += ',';
+            }
+            mLevels.back().mEmpty = false;
+            NewLine();
+        }
+    }
+
+    JsonStreamWriter& AfterValue()
+    {
+        if( mStream && mBuffer.size() >= FLUSH_SIZE )
+        {
+            Flush();
+        }
+        return *this;
+    }
+
+    JsonStreamWriter& Literal(const char* pText)
+    {
+        BeforeValue();
+        mOutput += pText;
+        return AfterValue();
+    }
+
+    JsonStreamWriter& Begin(bool pObject,char pBracket)
+    {
+        BeforeValue();
+        if( mJsonWriterLayout )
+        {
+            NewLine();
+        }
+        mOutput += pBracket;
+        Level level = {pObject,true};
+        mLevels.push_back(level);
+        return *this;
+    }
+
+    JsonStreamWriter& End(bool pObject,char pBracket)
+    {
+        assert(mLevels.size() > 0 && mLevels.back().mObject == pObject && "JsonStreamWriter end does not match the begin");
+        assert(mAfterKey == false && "JsonStreamWriter object ended after a key with no value");
+        const bool empty = mLevels.back().mEmpty;
+        mLevels.pop_back();
+        if( !empty || mJsonWriterLayout )
+        {
+            NewLine();
+        }
+        mOutput += pBracket;
+        return AfterValue();
+    }
+
+    void WriteKey(const char* pKey,size_t pLength,bool pEscape)
+    {
+        assert(mLevels.size() > 0 && mLevels.back().mObject && "JsonStreamWriter key written outside of an object");
+        assert(mAfterKey == false && "JsonStreamWriter key written when a value was expected");
+        if( mLevels.back().mEmpty == false )
+        {
+            mOutput += ',';
+        }
+        mLevels.back().mEmpty = false;
+        NewLine();
+        AppendString(pKey,pLength,pEscape);
+        mOutput += ':';
+        mAfterKey = true;
+    }
+
+    void WriteString(const char* pString,size_t pLength,bool pEscape)
+    {
+        BeforeValue();
+        AppendString(pString,pLength,pEscape);
+        AfterValue();
+    }
+
+    void AppendString(const char* pString,size_t pLength,bool pEscape)
+    {
+        mOutput += '\"';
+        if( pEscape )
+        {
+            JsonEscapeString(mOutput,pString,pLength);
+        }
+        else
+        {
+            mOutput.append(pString,pLength);
+        }
+        mOutput += '\"';
+    }
+
+    /**
+     * @brief Writes a string or key held escaped as the tree holds them, it is unescaped and escaped again so only the escapes json needs are left.
+     */
+    void CanonicalText(const std::string& pText,bool pKey)
+    {
+        const char* text = pText.data();
+        size_t length = pText.size();
+        if( memchr(text,'\\',length) != nullptr )
+        {
+            mUnescaped.clear();
+            JsonUnescapeString(mUnescaped,text,length);
+            text = mUnescaped.data();
+            length = mUnescaped.size();
+        }
+
+        if( pKey )
+        {
+            WriteKey(text,length,true);
+        }
+        else
+        {
+            WriteString(text,length,true);
+        }
+    }
+
+    /**
+     * @brief The std::map order of the keys is the utf16 order unless a key has an escape, or a character from U+E000 up where utf8 and utf16 sort differently.
+     */
+    static bool KeysInCodeUnitOrder(const JsonKeyValue& pObject)
+    {
+        for( const auto& entry : pObject )
+        {
+            for( const char c : entry.first )
+            {
+                if( c == '\\' || (unsigned char)c >= 0xee )
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Lists the entries of the object in rSorted in the utf16 order of their keys, for when KeysInCodeUnitOrder says the map is not in it.
+     */
+    static void SortEntries(const JsonKeyValue& pObject,std::vector<const JsonKeyValue::value_type*>& rSorted)
+    {
+        typedef std::pair<std::u16string,const JsonKeyValue::value_type*> SortedEntry;
+        std::vector<SortedEntry> sorted;
+        sorted.reserve(pObject.size());
+        for( const auto& entry : pObject )
+        {
+            sorted.emplace_back(CodeUnits(entry.first),&entry);
+        }
+        // Stable so keys that are the same once unescaped, which the RFC does not allow, still come out in the same order each time.
+        std::stable_sort(sorted.begin(),sorted.end(),[](const SortedEntry& pA,const SortedEntry& pB){return pA.first < pB.first;});
+        rSorted.reserve(sorted.size());
+        for( const auto& entry : sorted )
+        {
+            rSorted.push_back(entry.second);
+        }
+    }
+
+    /**
+     * @brief The utf16 code units of a key, what RFC 8785 sorts keys by.
+     */
+    static std::u16string CodeUnits(const std::string& pKey)
+    {
+        static const unsigned char LEAD_BITS[] = {0xff,0x1f,0x0f,0x07};
+        std::string text;
+        JsonUnescapeString(text,pKey.data(),pKey.size());
+        std::u16string units;
+        units.reserve(text.size());
+        for( size_t n = 0 ; n < text.size() ; )
+        {
+            const unsigned char lead = (unsigned char)text[n];
+            size_t extra = lead >= 0xf0 ? 3 : lead >= 0xe0 ? 2 : lead >= 0xc0 ? 1 : 0;
+            if( n + extra >= text.size() )
+            {
+                extra = 0; // Cut short, the bytes sort as they are.
+            }
+            uint32_t code = lead & LEAD_BITS[extra];
+            for( size_t i = 1 ; i <= extra ; i++ )
+            {
+                code = (code << 6) | ((unsigned char)text[n + i] & 0x3f);
+            }
+            n += extra + 1;
+
+            if( code >= 0x10000 )
+            {
+                code -= 0x10000;
+                units += char16_t(0xd800 + (code >> 10));
+                units += char16_t(0xdc00 + (code & 0x3ff));
+            }
+            else
+            {
+                units += char16_t(code);
+            }
+        }
+        return units;
+    }
+
+    /**
+     * @brief Writes the number the way javascript writes a double, the fewest digits that read back the same, and an exponent only below 1e-6 or from 1e21.
+     * Numbers of up to 15 digits, away from the ends of the range of a double, already are the fewest digits so no double is made for them.
+     */
+    void CanonicalNumber(const std::string& pText)
+    {
+        JsonValue::NumberDigits room;
+        char* digits = room.Get(std::max(pText.size(),size_t(32)));
+        bool negative;
+        size_t count;
+        int64_t power;
+        if( !JsonValue::SplitNumber(pText,negative,digits,count,power) )
+        {
+            THROW_JSON_EXCEPTION("Json number " + pText + " is not a valid number");
+        }
+
+        int64_t point = int64_t(count) + power; // The value is 0.digits times ten to the power of point.
+        if( count > 15 || point < -290 || point > 290 )
+        {
+#ifdef __cpp_lib_to_chars
+            double value = 0;
+            std::from_chars(pText.data() + negative,pText.data() + pText.size(),value);
+            if( value == 0 && count > 0 )
+            {
+                value = fabs(strtod(pText.c_str(),nullptr)); // from_chars gives up on numbers out of range, strtod says if it is too big or too small.
+            }
+#else
+            const double value = fabs(strtod(pText.c_str(),nullptr));
+#endif
+            if( !isfinite(value) )
+            {
+                THROW_JSON_EXCEPTION("Json number " + pText + " is too big for a double and has no canonical form");
+            }
+            count = JsonShortestDigits(value,digits,point);
+        }
+
+        if( count == 0 )
+        {
+            mOutput += '0';
+            return;
+        }
+        if( negative )
+        {
+            mOutput += '-';
+        }
+
+        if( point >= int64_t(count) && point <= 21 )
+        {
+            mOutput.append(digits,count);
+            mOutput.append(size_t(point) - count,'0');
+        }
+        else if( point > 0 && point <= 21 )
+        {
+            mOutput.append(digits,size_t(point));
+            mOutput += '.';
+            mOutput.append(digits + point,count - size_t(point));
+        }
+        else if( point > -6 && point <= 0 )
+        {
+            mOutput += "0.";
+            mOutput.append(size_t(-point),'0');
+            mOutput.append(digits,count);
+        }
+        else
+        {
+            mOutput += digits[0];
+            if( count > 1 )
+            {
+                mOutput += '.';
+                mOutput.append(digits + 1,count - 1);
+            }
+            mOutput += point > 0 ? "e+" : "e-";
+            JsonAppendNumber(mOutput,point > 0 ? point - 1 : 1 - point);
+        }
+    }
+};
+
+/**
+ * @brief Writes the Json object tree passed in to the file passed. Use pPretty to set if you want tabs and newlines.
+ * pTabCount is the indent the output starts at when pPretty is set.
+ */
+inline void JsonWriter(std::ostream& pFile,const JsonValue& pRoot,bool pPretty,int pTabCount = 0)
+{
+    JsonStreamWriter writer(pFile,pPretty,pTabCount);
+    writer.UseJsonWriterLayout().Value(pRoot);
+}
+
+/**
+ * @brief Returns the tree in the canonical form of RFC 8785, the same bytes for any two trees that are equal, see JsonStreamWriter::CanonicalValue.
+ */
+inline std::string JsonToCanonical(const JsonValue& pRoot)
+{
+    std::string canonical;
+    JsonStreamWriter writer(canonical);
+    writer.CanonicalValue(pRoot);
+    return canonical;
+}
+
+/**
+ * @brief A JsonScanner that can take its json from a stream a block at a time, for the readers that do not need all of it at once.
+ * What is left of the block from the current position is kept when more is read, so the block only grows when a single token,
+ * or for JsonArrayReader a single element, is longer than it.
+ */
+class JsonBlockScanner : protected JsonScanner
+{
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024; //!< How much of a stream is read at once.
+
+protected:
+    std::istream* mInput = nullptr;     //!< Where more of the json comes from, null when it is all in memory.
+    std::vector<char> mBlock;           //!< Holds the part of the stream being read, with a zero after it.
+    size_t mConsumed = 0;               //!< How much of the stream was read and dropped before the start of mBlock.
+
+    /**
+     * @brief Starts scanning json that is all in memory, there is no more to read.
+     */
+    void StartMemory(const char* pJson,size_t pLength,bool pNullTerminated)
+    {
+        Reset(pJson,pLength,pNullTerminated);
+        mInput = nullptr;
+        mConsumed = 0;
+    }
+
+    /**
+     * @brief Starts scanning json from rInput, the first block is read when it is first needed.
+     */
+    void StartStream(std::istream& rInput)
+    {
+        mBlock.assign(1,0);
+        Reset(mBlock.data(),0,true);
+        mInput = &rInput;
+        mConsumed = 0;
+    }
+
+    /**
+     * @brief How far into the json the current position is, for errors.
+     */
+    size_t GetOffset()const
+    {
+        return mConsumed + size_t(mPos - mJsonStart);
+    }
+
+    /**
+     * @brief Skips white space, reading more of the stream when it gets to the end of the block.
+     */
+    void NextToken()
+    {
+        for(;;)
+        {
+            SkipWhiteSpace();
+            if( mPos < mJsonEnd || !ReadMore() )
+            {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Makes sure all of the token at the current position is in the block, and the character after it so a number's end is known.
+     * The scanner then reads it and checks it as it would any other json.
+     */
+    void NeedToken()
+    {
+        while( mInput && TokenEnd() == nullptr && ReadMore() )
+        {
+        }
+    }
+
+    /**
+     * @brief Where the token at the current position ends, or null if it may go on past the end of the block.
+     */
+    const char* TokenEnd()const
+    {
+        if( mPos >= mJsonEnd )
+        {
+            return nullptr;
+        }
+        if( *mPos == '\"' )
+        {
+            for( const char* quote = mPos + 1 ; (quote = static_cast<const char*>(memchr(quote,'\"',mJsonEnd - quote))) != nullptr ; quote++ )
+            {
+                // The quote ends the string unless it is escaped, by an odd number of back slashes.
+                size_t slashes = 0;
+                while( quote[-1 - int(slashes)] == '\\' )
+                {
+                    slashes++;
+                }
+                if( slashes % 2 == 0 )
+                {
+                    return quote + 1;
+                }
+            }
+            return nullptr;
+        }
+        for( const char* c = mPos ; c < mJsonEnd ; c++ )
+        {
+            if( IsWhiteSpace(*c) || *c == ',' || *c == ']' || *c == '}' || *c == ':' )
+            {
+                return c;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Moves what is left of the block from the current position to its start and reads more of the stream after it.
+     * Returns false when there is no more to read.
+     */
+    bool ReadMore()
+    {
+        if( mInput == nullptr || !*mInput )
+        {
+            return false;
+        }
+
+        const size_t left = size_t(mJsonEnd - mPos);
+        mConsumed += size_t(mPos - mJsonStart);
+        MoveLinesFromToPos(); // Before the lines it has to count are dropped.
+        memmove(mBlock.data(),mPos,left);
+        if( mBlock.size() < left + BLOCK_SIZE + 1 )
+        {
+            mBlock.resize(left + BLOCK_SIZE + 1); // After the first read, only for something longer than a block.
+        }
+        mInput->read(mBlock.data() + left,BLOCK_SIZE);
+        const size_t read = size_t(mInput->gcount());
+
+        // Not Reset, that would start the line and column again. The zero after the data lets the scanning loops run without checking for the end.
+        mJsonStart = mPos = mLinesFrom = mBlock.data();
+        mJsonEnd = mJsonStart + left + read;
+        mBlock[left + read] = 0;
+        return read > 0;
+    }
+};
+
+/**
+ * @brief Minifies or pretty prints json text to text in one pass, without building a tree, checking the json as it goes.
+ * Uses the scanning of the parser and writes with JsonStreamWriter, so the output looks the same as JsonStreamWriter's but keeps the keys
+ * in the order they are in and each string and number exactly as written. Literals are written in lower case.
+ * From a stream the input is read in blocks of BLOCK_SIZE and the output written in blocks, so the memory used does not grow with
+ * the size of the json, only the block is held and it only grows when a single string is longer than it.
+ */
+class JsonReformatter : private JsonBlockScanner
+{
+public:
+    using JsonBlockScanner::BLOCK_SIZE;
+
+    /**
+     * @brief pPretty puts values on their own lines with indentation, without it all the white space is taken out.
+     * pIndent is the number of tabs the output is indented by when pPretty is set, as for JsonStreamWriter.
+     */
+    JsonReformatter(bool pPretty = false,int pIndent = 0) :
+        mPretty(pPretty),
+        mIndent(pIndent)
+    {
+    }
+
+    /**
+     * @brief Appends the json reformatted to rOutput. Throws std::runtime_error if it is not valid json, rOutput will have the part before the error.
+     */
+    void Reformat(const char* pJson,size_t pLength,std::string& rOutput,bool pNullTerminated = false)
+    {
+        StartMemory(pJson,pLength,pNullTerminated);
+        JsonStreamWriter writer(rOutput,mPretty,mIndent);
+        Reformat(writer);
+    }
+
+    void Reformat(const std::string& pJson,std::string& rOutput)
+    {
+        Reformat(pJson.c_str(),pJson.size(),rOutput,true);
+    }
+
+    /**
+     * @brief Reads json from rInput to its end and writes it reformatted to rOutput. Errors say how far into the input they are.
+     */
+    void Reformat(std::istream& rInput,std::ostream& rOutput)
+    {
+        StartStream(rInput);
+        try
+        {
+            JsonStreamWriter writer(rOutput,mPretty,mIndent);
+            Reformat(writer);
+        }
+        catch(const std::exception& e)
+        {
+            THROW_JSON_EXCEPTION("Json reformat failed " + std::to_string(GetOffset()) + " bytes into the input, " + e.what());
+        }
+    }
+
+    /**
+     * @brief Sets how deeply arrays and objects can be nested, see JsonProcessor::SetMaxDepth.
+     */
+    void SetMaxDepth(size_t pMaxDepth)
+    {
+        mMaxDepth = pMaxDepth;
+    }
+
+private:
+    const bool mPretty;
+    const int mIndent;
+
+    /**
+     * @brief Reads over the root value writing it out, like SkipValue the arrays and objects we are in are kept as a string of their closing brackets.
+     */
+    void Reformat(JsonStreamWriter& rWriter)
+    {
+        std::string closers;
+        NextToken();
+        for(;;)
+        {
+            const char c = Peek();
+            if( c == '{' || c == '[' )
+            {
+                const char close = c == '{' ? '}' : ']';
+                AssertDepth(closers.size() + 1);
+                NextChar();
+                close == '}' ? rWriter.BeginObject() : rWriter.BeginArray();
+                NextToken();
+                if( Peek() != close )
+                {
+                    closers.push_back(close);
+                    if( close == '}' )
+                    {
+                        WriteKey(rWriter);
+                    }
+                    continue;
+                }
+                NextChar();
+                close == '}' ? rWriter.EndObject() : rWriter.EndArray();
+            }
+            else
+            {
+                WriteScalar(rWriter);
+            }
+
+            // The value is done, now close the arrays and objects that it was the last element of, until one has another element.
+            for(;;)
+            {
+                NextToken();
+                if( closers.size() == 0 )
+                {
+                    if( mPos < mJsonEnd )
+                    {
+                        THROW_JSON_EXCEPTION(GetErrorPos() + "Data found after root object, invalid Json");
+                    }
+                    return;
+                }
+                if( Peek() == ',' )
+                {
+                    NextChar();
+                    NextToken();
+                    if( closers.back() == '}' )
+                    {
+                        WriteKey(rWriter);
+                    }
+                    break;
+                }
+                AssertCorrectChar(closers.back(),closers.back() == '}' ? "End of object not found, invalid Json" : "Json format error detected, array not terminated with ']'");
+                NextChar();
+                closers.back() == '}' ? rWriter.EndObject() : rWriter.EndArray();
+                closers.pop_back();
+            }
+        }
+    }
+
+    /**
+     * @brief Writes the key at the current position and reads over the ':' after it.
+     */
+    void WriteKey(JsonStreamWriter& rWriter)
+    {
+        NeedToken();
+        const char* start;
+        size_t length;
+        ScanString(start,length);
+        rWriter.WriteKey(start,length,false);
+        NextToken();
+        AssertCorrectChar(':',"Json format error detected, seperator character ':'");
+        NextChar();
+        NextToken();
+    }
+
+    /**
+     * @brief Writes the string, number, true, false or null at the current position.
+     */
+    void WriteScalar(JsonStreamWriter& rWriter)
+    {
+        NeedToken();
+        const char* start;
+        size_t length;
+        const char c = Peek();
+        if( c == '\"' )
+        {
+            ScanString(start,length);
+            rWriter.WriteString(start,length,false);
+        }
+        else if( c == '-' || IsDigit(c) )
+        {
+            ScanNumber(start,length);
+            rWriter.BeforeValue();
+            rWriter.mOutput.append(start,length);
+            rWriter.AfterValue();
+        }
+        else if( MatchLiteral("true") || MatchLiteral("false") )
+        {
+            rWriter.Value(tolower(c) == 't');
+        }
+        else if( MatchLiteral("null") )
+        {
+            rWriter.Null();
+        }
+        else
+        {
+            AssertMoreData("Abrupt end to json whilst looking for a value");
+            THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Invalid character \"") + c + "\" found at start of json value definition");
+        }
+    }
+};
+
+/**
+ * @brief Returns the json with all of the white space taken out, see JsonReformatter.
+ */
+inline std::string JsonMinify(const std::string& pJson)
+{
+    std::string minified;
+    minified.reserve(pJson.size());
+    JsonReformatter().Reformat(pJson,minified);
+    return minified;
+}
+
+/**
+ * @brief Returns the json laid out with a value on each line, see JsonReformatter.
+ */
+inline std::string JsonPrettyPrint(const std::string& pJson)
+{
+    std::string pretty;
+    JsonReformatter(true).Reformat(pJson,pretty);
+    return pretty;
+}
+
+/**
+ * @brief Writes JsonValue trees as CBOR (RFC 8949), a binary form of json that is smaller and much quicker to read back, read it with JsonCborReader.
+ * Numbers keep their exact decimal value, though not always the text they are held as. Whole numbers are written as integers and the rest as decimal fractions, tag 4,
+ * the digits as an integer and the power of ten they are scaled by. So 1.50 goes out as 150 and -2 and JsonCborReader turns it back into 1.50.
+ * The only numbers that are not exact are those with more digits than fit in 64 bits, and minus zero, they are written as doubles.
+ * Strings and keys are written as utf8 text with the json escapes taken out.
+ * The tree is walked with a list of the arrays and objects being written and not recursion, so any depth of tree can be written.
+ */
+class JsonCborWriter
+{
+public:
+    /**
+     * @brief The CBOR is appended to rOutput.
+     */
+    JsonCborWriter(std::string& rOutput) : mOutput(rOutput){}
+
+    void Write(const JsonValue& pRoot)
+    {
+        struct Frame
+        {
+            const JsonValue* mValue;
+            size_t mElement;                        //!< The next element to write of an array.
+            JsonKeyValue::const_iterator mEntry;    //!< The next entry to write of an object.
+        };
+        std::vector<Frame> stack;
+
+        const JsonValue* value = &pRoot;
+        while( value )
+        {
+            switch( value->mType )
+            {
+            case JsonValueType::OBJECT:
+                WriteHead(MAP,value->mObject.size());
+                if( value->mObject.size() > 0 )
+                {
+                    const Frame frame = {value,0,value->mObject.begin()};
+                    stack.push_back(frame);
+                }
+                break;
+
+            case JsonValueType::ARRAY:
+                WriteHead(ARRAY,value->mArray.size());
+                if( value->mArray.size() > 0 )
+                {
+                    const Frame frame = {value,0,JsonKeyValue::const_iterator()};
+                    stack.push_back(frame);
+                }
+                break;
+
+            case JsonValueType::STRING:
+                WriteText(value->mValue);
+                break;
+
+            case JsonValueType::NUMBER:
+                WriteNumber(value->mValue);
+                break;
+
+            case JsonValueType::BOOLEAN:
+                mOutput += char(value->mBoolean ? 0xf5 : 0xf4);
+                break;
+
+            case JsonValueType::NULL_VALUE:
+            case JsonValueType::INVALID:
+                mOutput += char(0xf6);
+                break;
+            }
+
+            // Find the next value to write, the arrays and objects that have been written in full are taken off the list.
+            value = nullptr;
+            while( value == nullptr && stack.size() > 0 )
+            {
+                Frame& top = stack.back();
+                if( top.mValue->mType == JsonValueType::OBJECT && top.mEntry != top.mValue->mObject.end() )
+                {
+                    WriteText(top.mEntry->first);
+                    value = &top.mEntry->second;
+                    ++top.mEntry;
+                }
+                else if( top.mValue->mType == JsonValueType::ARRAY && top.mElement < top.mValue->mArray.size() )
+                {
+                    value = &top.mValue->mArray[top.mElement++];
+                }
+                else
+                {
+                    stack.pop_back();
+                }
+            }
+        }
+    }
+
+private:
+    enum MajorType {UNSIGNED = 0,NEGATIVE = 1,TEXT = 3,ARRAY = 4,MAP = 5,TAG = 6};
+
+    std::string& mOutput;
+    std::string mText;  //!< Where strings are unescaped, kept so it is only allocated once.
+
+    void WriteHead(MajorType pMajor,uint64_t pArgument)
+    {
+        const char major = char(pMajor << 5);
+        if( pArgument < 24 )
+        {
+            mOutput += char(major | pArgument);
+            return;
+        }
+
+        int bytes = 8;
+        char info = 27;
+        if( pArgument <= 0xff ){bytes = 1;info = 24;}
+        else if( pArgument <= 0xffff ){bytes = 2;info = 25;}
+        else if( pArgument <= 0xffffffff ){bytes = 4;info = 26;}
+        mOutput += char(major | info);
+        for( int n = bytes - 1 ; n >= 0 ; n-- )
+        {
+            mOutput += char(pArgument >> (n * 8));
+        }
+    }
+
+    void WriteInteger(bool pNegative,uint64_t pMagnitude)
+    {
+        // CBOR negative integers are stored as minus one minus the argument, so the magnitude can be one more than fits in the argument.
+        if( pNegative )
+        {
+            WriteHead(NEGATIVE,pMagnitude - 1);
+        }
+        else
+        {
+            WriteHead(UNSIGNED,pMagnitude);
+        }
+    }
+
+    void WriteText(const std::string& pEscaped)
+    {
+        const std::string* text = &pEscaped;
+        if( pEscaped.find('\\') != std::string::npos )
+        {
+            mText.clear();
+            JsonUnescapeString(mText,pEscaped.data(),pEscaped.size());
+            text = &mText;
+        }
+        WriteHead(TEXT,text->size());
+        mOutput += *text;
+    }
+
+    void WriteNumber(const std::string& pText)
+    {
+        const char* c = pText.c_str();
+        const char* const end = c + pText.size();
+        const bool negative = *c == '-';
+        if( negative )
+        {
+            c++;
+        }
+
+        uint64_t mantissa = 0;
+        int64_t exponent = 0;
+        size_t digits = 0;
+        bool exact = true;
+        bool fraction = false;
+        bool pastMax = false; // The digits are 2^64, one more than the mantissa holds, which CBOR can still write as a negative integer.
+        auto addDigit = [&](char pDigit)
+        {
+            const uint64_t max = std::numeric_limits<uint64_t>::max();
+            const uint64_t digit = uint64_t(pDigit - '0');
+            if( pastMax || mantissa > (max - digit) / 10 )
+            {
+                pastMax = exact && !pastMax && mantissa == max / 10 && digit == max % 10 + 1;
+                exact = pastMax;
+            }
+            mantissa = mantissa * 10 + digit;
+            digits++;
+        };
+
+        for( ; c < end && isdigit(*c) ; c++ )
+        {
+            addDigit(*c);
+        }
+        if( c < end && *c == '.' )
+        {
+            fraction = true;
+            for( c++ ; c < end && isdigit(*c) ; c++ )
+            {
+                addDigit(*c);
+                exponent--;
+            }
+        }
+        if( c < end && (*c == 'e' || *c == 'E') )
+        {
+            fraction = true;
+            c++;
+            const bool negativeExponent = c < end && *c == '-';
+            if( c < end && (*c == '-' || *c == '+') )
+            {
+                c++;
+            }
+            int64_t power = 0;
+            for( ; c < end && isdigit(*c) ; c++ )
+            {
+                power = std::min(power * 10 + (*c - '0'),int64_t(1000000000));
+            }
+            exponent += negativeExponent ? -power : power;
+        }
+
+        if( digits == 0 || c != end )
+        {
+            THROW_JSON_EXCEPTION("Json number " + pText + " is not a number, it can not be written as cbor");
+        }
+
+        if( pastMax && negative && !fraction )
+        {
+            WriteHead(NEGATIVE,std::numeric_limits<uint64_t>::max());
+            return;
+        }
+        if( !exact || pastMax || (negative && mantissa == 0) )
+        {
+            const double value = strtod(pText.c_str(),nullptr);
+            if( !isfinite(value) )
+            {
+                THROW_JSON_EXCEPTION("Json number " + pText + " is too big to be written as cbor");
+            }
+            uint64_t bits;
+            memcpy(&bits,&value,sizeof(bits));
+            mOutput += char(0xfb);
+            for( int n = 7 ; n >= 0 ; n-- )
+            {
+                mOutput += char(bits >> (n * 8));
+            }
+            return;
+        }
+
+        if( fraction )
+        {
+            WriteHead(TAG,4);
+            WriteHead(ARRAY,2);
+            WriteInteger(exponent < 0,exponent < 0 ? uint64_t(-exponent) : uint64_t(exponent));
+        }
+        WriteInteger(negative,mantissa);
+    }
+};
+
+/**
+ * @brief Reads CBOR (RFC 8949) into a JsonValue tree, the CBOR written by JsonCborWriter or by anything else.
+ * There is no text to scan so reading is a lot quicker than parsing the json, most of the time goes on making the tree.
+ * The CBOR that has a json meaning is read, integers, floats, decimal fractions, text, arrays, maps with text or integer keys, true, false, null and undefined, which becomes null.
+ * Tags other than decimal fractions are skipped and the value they tag is read. Floats that are infinite or nan become null, as RFC 8949 says.
+ * Byte strings, bignums and other simple values have no json meaning and throw std::runtime_error, as does a map with the same key twice.
+ * Like JsonProcessor it does not recurse, so hostile data nested a million deep can not run out of stack.
+ */
+class JsonCborReader
+{
+public:
+    JsonCborReader(const void* pData,size_t pLength) :
+        mStart((const uint8_t*)pData),
+        mEnd((const uint8_t*)pData + pLength),
+        mPos((const uint8_t*)pData)
+    {
+        if( pData == nullptr || pLength == 0 )
+        {
+            THROW_JSON_EXCEPTION("Empty data passed into JsonCborReader");
+        }
+        ReadRoot();
+    }
+
+    JsonCborReader(const std::string& pData) : JsonCborReader(pData.data(),pData.size()){}
+
+    const JsonValue& GetRoot()const
+    {
+        return mRoot;
+    }
+
+    /**
+     * @brief Moves the tree out of the reader.
+     */
+    JsonValue TakeRoot()
+    {
+        return std::move(mRoot);
+    }
+
+private:
+    const uint8_t* const mStart;
+    const uint8_t* const mEnd;
+    const uint8_t* mPos;
+    JsonValue mRoot;
+
+    std::string GetErrorPos()const
+    {
+        return "Cbor error at byte " + std::to_string(mPos - mStart) + " : ";
+    }
+
+    void Need(uint64_t pBytes)const
+    {
+        if( uint64_t(mEnd - mPos) < pBytes )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor data ends part way through a value");
+        }
+    }
+
+    /**
+     * @brief Reads the first byte of an item and the argument after it. rIndefinite is set for the indefinite length form, and for a break.
+     */
+    uint64_t ReadHead(uint8_t& rMajor,bool& rIndefinite)
+    {
+        Need(1);
+        const uint8_t initial = *mPos++;
+        rMajor = initial >> 5;
+        rIndefinite = false;
+        const uint8_t info = initial & 31;
+        if( info < 24 )
+        {
+            return info;
+        }
+        if( info <= 27 )
+        {
+            const size_t bytes = size_t(1) << (info - 24);
+            Need(bytes);
+            uint64_t argument = 0;
+            for( size_t n = 0 ; n < bytes ; n++ )
+            {
+                argument = (argument << 8) | *mPos++;
+            }
+            return argument;
+        }
+        if( info == 31 && rMajor != 0 && rMajor != 1 && rMajor != 6 )
+        {
+            rIndefinite = true;
+            return 0;
+        }
+        mPos--;
+        THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor item has a reserved length");
+    }
+
+    /**
+     * @brief Reads a text string into rString with json escapes put in, in one go or in chunks for the indefinite length form.
+     */
+    void ReadText(uint64_t pLength,bool pIndefinite,std::string& rString)
+    {
+        rString.clear();
+        if( pIndefinite )
+        {
+            for(;;)
+            {
+                uint8_t major;
+                bool indefinite;
+                const uint8_t* chunk = mPos;
+                const uint64_t length = ReadHead(major,indefinite);
+                if( major == 7 && indefinite )
+                {
+                    return;
+                }
+                if( major != 3 || indefinite )
+                {
+                    mPos = chunk;
+                    THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor text string has a chunk that is not text");
+                }
+                AppendText(length,rString);
+            }
+        }
+        AppendText(pLength,rString);
+    }
+
+    void AppendText(uint64_t pLength,std::string& rString)
+    {
+        Need(pLength);
+        JsonEscapeString(rString,(const char*)mPos,size_t(pLength));
+        mPos += pLength;
+    }
+
+    /**
+     * @brief Appends the integer of a CBOR negative integer, which is minus one minus the argument.
+     */
+    static void AppendNegative(uint64_t pArgument,std::string& rText)
+    {
+        if( pArgument == std::numeric_limits<uint64_t>::max() )
+        {
+            rText += "-18446744073709551616";
+            return;
+        }
+        rText += '-';
+        JsonAppendNumber(rText,pArgument + 1);
+    }
+
+    /**
+     * @brief Reads the integer of a decimal fraction as its size and sign.
+     */
+    uint64_t ReadInteger(bool& rNegative)
+    {
+        uint8_t major;
+        bool indefinite;
+        const uint64_t argument = ReadHead(major,indefinite);
+        if( major > 1 || (major == 1 && argument == std::numeric_limits<uint64_t>::max()) )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor decimal fraction does not hold a 64 bit integer, bignums are not supported");
+        }
+        rNegative = major == 1;
+        return rNegative ? argument + 1 : argument;
+    }
+
+    /**
+     * @brief Reads the exponent and digits of a decimal fraction, tag 4, and makes the json number text.
+     * The digits get a decimal point when that is short, 1.50 for 150 and -2, otherwise an exponent is added, 15e20.
+     */
+    void ReadDecimalFraction(std::string& rText)
+    {
+        uint8_t major;
+        bool indefinite;
+        if( ReadHead(major,indefinite) != 2 || major != 4 || indefinite )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor decimal fraction is not an array of two integers");
+        }
+
+        bool negativeExponent,negative;
+        const uint64_t exponent = ReadInteger(negativeExponent);
+        const uint64_t mantissa = ReadInteger(negative);
+
+        // Made in a buffer and assigned in one go, the numbers are often too long to fit inside a std::string and adding to it would allocate again.
+        char digits[20];
+        char* const digitsEnd = digits + sizeof(digits);
+        char* first = WriteDigits(digitsEnd,mantissa);
+        const uint64_t count = uint64_t(digitsEnd - first);
+
+        char text[64];
+        char* pos = text;
+        if( negative )
+        {
+            *pos++ = '-';
+        }
+        if( exponent == 0 )
+        {
+            pos = std::copy(first,digitsEnd,pos);
+        }
+        else if( negativeExponent && exponent < count )
+        {
+            pos = std::copy(first,digitsEnd - size_t(exponent),pos);
+            *pos++ = '.';
+            pos = std::copy(digitsEnd - size_t(exponent),digitsEnd,pos);
+        }
+        else if( negativeExponent && exponent - count < 6 )
+        {
+            *pos++ = '0';
+            *pos++ = '.';
+            for( uint64_t n = count ; n < exponent ; n++ )
+            {
+                *pos++ = '0';
+            }
+            pos = std::copy(first,digitsEnd,pos);
+        }
+        else
+        {
+            pos = std::copy(first,digitsEnd,pos);
+            *pos++ = 'e';
+            if( negativeExponent )
+            {
+                *pos++ = '-';
+            }
+            char* exponentFirst = WriteDigits(digitsEnd,exponent);
+            pos = std::copy(exponentFirst,digitsEnd,pos);
+        }
+        rText.assign(text,pos - text);
+    }
+
+    /**
+     * @brief Writes the digits of pValue so they end at pEnd, returns where they start.
+     */
+    static char* WriteDigits(char* pEnd,uint64_t pValue)
+    {
+        do
+        {
+            *--pEnd = char('0' + pValue % 10);
+            pValue /= 10;
+        }while( pValue > 0 );
+        return pEnd;
+    }
+
+    void ReadFloat(double pValue,JsonValue& rValue)
+    {
+        if( isfinite(pValue) )
+        {
+            rValue.mType = JsonValueType::NUMBER;
+            JsonAppendNumber(rValue.mValue,pValue);
+        }
+        else
+        {
+            rValue.mType = JsonValueType::NULL_VALUE;
+        }
+    }
+
+    static double HalfToDouble(uint16_t pHalf)
+    {
+        const int exponent = (pHalf >> 10) & 0x1f;
+        const int mantissa = pHalf & 0x3ff;
+        double value;
+        if( exponent == 0 )
+        {
+            value = ldexp(mantissa,-24);
+        }
+        else if( exponent != 31 )
+        {
+            value = ldexp(mantissa + 1024,exponent - 25);
+        }
+        else
+        {
+            value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+        }
+        return (pHalf & 0x8000) ? -value : value;
+    }
+
+    /**
+     * @brief An array or map that is being read.
+     */
+    struct Frame
+    {
+        JsonValue* mValue;
+        uint64_t mRemaining;    //!< Elements or entries still to read when the length was given.
+        bool mIndefinite;       //!< The length was not given, the end is marked by a break.
+    };
+
+    void ReadRoot()
+    {
+        std::vector<Frame> stack;
+        std::string key;
+        JsonValue* value = &mRoot;
+        while( value )
+        {
+            const uint8_t* itemStart = mPos;
+            uint8_t major;
+            bool indefinite;
+            const uint64_t argument = ReadHead(major,indefinite);
+            switch( major )
+            {
+            case 0:
+                value->mType = JsonValueType::NUMBER;
+                JsonAppendNumber(value->mValue,argument);
+                break;
+
+            case 1:
+                value->mType = JsonValueType::NUMBER;
+                AppendNegative(argument,value->mValue);
+                break;
+
+            case 2:
+                mPos = itemStart;
+                THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor byte strings have no json type");
+
+            case 3:
+                value->mType = JsonValueType::STRING;
+                ReadText(argument,indefinite,value->mValue);
+                break;
+
+            case 4:
+            case 5:
+                {
+                    const bool array = major == 4;
+                    value->mType = array ? JsonValueType::ARRAY : JsonValueType::OBJECT;
+                    if( array && !indefinite )
+                    {
+                        // Every element is at least a byte, so a hostile length can not make us reserve more than the data could fill.
+                        value->mArray.reserve(size_t(std::min(argument,uint64_t(mEnd - mPos))));
+                    }
+                    const Frame frame = {value,argument,indefinite};
+                    stack.push_back(frame);
+                }
+                break;
+
+            case 6:
+                if( argument == 2 || argument == 3 || argument == 5 )
+                {
+                    mPos = itemStart;
+                    THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor bignums and bigfloats are not supported");
+                }
+                if( argument == 4 )
+                {
+                    value->mType = JsonValueType::NUMBER;
+                    ReadDecimalFraction(value->mValue);
+                    break;
+                }
+                continue; // Some other tag, read the value it tags.
+
+            case 7:
+                switch( itemStart[0] & 31 )
+                {
+                case 20:
+                case 21:
+                    value->mType = JsonValueType::BOOLEAN;
+                    value->mBoolean = argument == 21;
+                    break;
+
+                case 22:
+                case 23:
+                    value->mType = JsonValueType::NULL_VALUE;
+                    break;
+
+                case 25:
+                    ReadFloat(HalfToDouble(uint16_t(argument)),*value);
+                    break;
+
+                case 26:
+                    {
+                        const uint32_t bits = uint32_t(argument);
+                        float single;
+                        memcpy(&single,&bits,sizeof(single));
+                        ReadFloat(single,*value);
+                    }
+                    break;
+
+                case 27:
+                    {
+                        double full;
+                        memcpy(&full,&argument,sizeof(full));
+                        ReadFloat(full,*value);
+                    }
+                    break;
+
+                case 31:
+                    mPos = itemStart;
+                    THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor break found where a value was expected");
+
+                default:
+                    mPos = itemStart;
+                    THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor simple value " + std::to_string(argument) + " has no json type");
+                }
+                break;
+            }
+
+            // Find the next value to read, the arrays and maps that are complete are taken off the list.
+            value = nullptr;
+            while( value == nullptr && stack.size() > 0 )
+            {
+                Frame& top = stack.back();
+                if( top.mIndefinite )
+                {
+                    Need(1);
+                    if( *mPos == 0xff )
+                    {
+                        mPos++;
+                        stack.pop_back();
+                        continue;
+                    }
+                }
+                else if( top.mRemaining == 0 )
+                {
+                    stack.pop_back();
+                    continue;
+                }
+                else
+                {
+                    top.mRemaining--;
+                }
+
+                if( top.mValue->mType == JsonValueType::ARRAY )
+                {
+                    top.mValue->mArray.emplace_back();
+                    value = &top.mValue->mArray.back();
+                }
+                else
+                {
+                    ReadKey(key);
+                    auto entry = top.mValue->mObject.emplace(std::move(key),JsonValue());
+                    if( entry.second == false )
+                    {
+                        THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor map has the key " + entry.first->first + " twice");
+                    }
+                    value = &entry.first->second;
+                }
+            }
+        }
+
+        if( mPos != mEnd )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Data found after root value, invalid Cbor");
+        }
+    }
+
+    /**
+     * @brief Json keys are strings, integer keys are turned into their text as RFC 8949 suggests.
+     */
+    void ReadKey(std::string& rKey)
+    {
+        const uint8_t* keyStart = mPos;
+        uint8_t major;
+        bool indefinite;
+        const uint64_t argument = ReadHead(major,indefinite);
+        rKey.clear();
+        if( major == 3 )
+        {
+            ReadText(argument,indefinite,rKey);
+        }
+        else if( major == 0 )
+        {
+            JsonAppendNumber(rKey,argument);
+        }
+        else if( major == 1 )
+        {
+            AppendNegative(argument,rKey);
+        }
+        else
+        {
+            mPos = keyStart;
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Cbor map key is not text or an integer");
+        }
+    }
+};
+
+/**
+ * @brief Short hand for JsonCborWriter, returns the CBOR of the tree.
+ */
+inline std::string JsonToCbor(const JsonValue& pRoot)
+{
+    std::string cbor;
+    JsonCborWriter writer(cbor);
+    writer.Write(pRoot);
+    return cbor;
+}
+
+/**
+ * @brief Short hand for JsonCborReader, returns the tree read from the CBOR.
+ */
+inline JsonValue JsonFromCbor(const std::string& pCbor)
+{
+    return JsonCborReader(pCbor).TakeRoot();
+}
+
+/**
+ * @brief The layout of a frozen document, written by JsonFrozenWriter and read in place by JsonFrozenView.
+ * There are no pointers, everything is found by its offset from the start, so the data can be written to a file and mapped straight back in.
+ * The values are 8 byte slots, a type and count and then an offset or the value itself. Array elements are slots one after another,
+ * object entries are the offset and length of the key followed by the value's slot and are sorted by key so they can be found with a binary search.
+ * Arrays that only hold numbers are packed as doubles. Strings and keys end with a zero so they can be used as c strings.
+ * Everything is in the byte order of the machine that wrote it.
+ */
+struct JsonFrozenFormat
+{
+    static const uint32_t MAGIC = 0x5a464a54;   //!< "TJFZ" when little endian.
+    static const uint32_t VERSION = 1;
+    static const size_t HEADER_SIZE = 24;       //!< Magic, version, the size of the data and the root slot.
+    static const size_t ROOT_SLOT = 16;
+    static const size_t SLOT_SIZE = 8;
+    static const size_t ENTRY_SIZE = 16;        //!< Key offset, key length and the slot.
+    static const uint32_t MAX_COUNT = (1u << 28) - 1; //!< The count shares its 32 bits with the type.
+
+    enum Type
+    {
+        NULL_VALUE,
+        FALSE_VALUE,
+        TRUE_VALUE,
+        INTEGER,        //!< A whole number that fits in 32 bits, held in the slot.
+        NUMBER,         //!< Offset to a double followed by the number's text, count is the length of the text.
+        STRING,         //!< Offset to the text, count is its length.
+        ARRAY,          //!< Offset to count slots.
+        NUMBER_ARRAY,   //!< Offset to count doubles.
+        OBJECT,         //!< Offset to count entries.
+        PACKED_NUMBER   //!< Never written, used by JsonFrozenView for an element of a NUMBER_ARRAY, the offset is to its double.
+    };
+
+    static uint32_t MakeTypeAndCount(Type pType,size_t pCount)
+    {
+        if( pCount > MAX_COUNT )
+        {
+            THROW_JSON_EXCEPTION("Json value is too big to be frozen, it has " + std::to_string(pCount) + " elements or characters");
+        }
+        return uint32_t(pType) | uint32_t(pCount << 4);
+    }
+};
+
+/**
+ * @brief Writes a JsonValue tree as a frozen document, see JsonFrozenFormat, to be read in place with JsonFrozenView.
+ * Keys and short strings that are used more than once are only written once.
+ * The numbers in packed arrays are read back as the double they were, their text is not kept. So 1.50 in a packed array reads back as 1.5,
+ * turn packing off if the text has to be exact. Arrays with whole numbers too big to be held exactly by a double are not packed.
+ * Like the other writers the tree is walked without recursion.
+ */
+class JsonFrozenWriter
+{
+public:
+    static const size_t MAX_SHARED_STRING = 64; //!< Longer strings are not looked for in the strings already written.
+
+    /**
+     * @brief rOutput is replaced with the frozen document.
+     */
+    JsonFrozenWriter(std::string& rOutput,bool pPackNumberArrays = true) :
+        mOutput(rOutput),
+        mPackNumberArrays(pPackNumberArrays)
+    {
+    }
+
+    void Write(const JsonValue& pRoot)
+    {
+        mOutput.assign(JsonFrozenFormat::HEADER_SIZE,'\0');
+        mShared.clear();
+        Put32(0,JsonFrozenFormat::MAGIC);
+        Put32(4,JsonFrozenFormat::VERSION);
+
+        // Each value is written when it is taken off this list, an array or object makes space for its children and puts them on it.
+        std::vector<std::pair<size_t,const JsonValue*>> pending(1,std::make_pair(size_t(JsonFrozenFormat::ROOT_SLOT),&pRoot));
+        while( pending.size() > 0 )
+        {
+            const size_t slot = pending.back().first;
+            const JsonValue& value = *pending.back().second;
+            pending.pop_back();
+
+            switch( value.mType )
+            {
+            case JsonValueType::NULL_VALUE:
+            case JsonValueType::INVALID:
+                PutSlot(slot,JsonFrozenFormat::NULL_VALUE,0,0);
+                break;
+
+            case JsonValueType::BOOLEAN:
+                PutSlot(slot,value.mBoolean ? JsonFrozenFormat::TRUE_VALUE : JsonFrozenFormat::FALSE_VALUE,0,0);
+                break;
+
+            case JsonValueType::NUMBER:
+                WriteNumber(slot,value.mValue);
+                break;
+
+            case JsonValueType::STRING:
+                PutSlot(slot,JsonFrozenFormat::STRING,value.mValue.size(),WriteString(value.mValue));
+                break;
+
+            case JsonValueType::ARRAY:
+                if( mPackNumberArrays && CanPack(value.mArray) )
+                {
+                    Align();
+                    PutSlot(slot,JsonFrozenFormat::NUMBER_ARRAY,value.mArray.size(),mOutput.size());
+                    for( const auto& element : value.mArray )
+                    {
+                        AppendDouble(strtod(element.mValue.c_str(),nullptr));
+                    }
+                }
+                else
+                {
+                    Align();
+                    const size_t first = mOutput.size();
+                    PutSlot(slot,JsonFrozenFormat::ARRAY,value.mArray.size(),first);
+                    mOutput.append(value.mArray.size() * JsonFrozenFormat::SLOT_SIZE,'\0');
+                    for( size_t n = value.mArray.size() ; n > 0 ; n-- )
+                    {
+                        pending.push_back(std::make_pair(first + (n - 1) * JsonFrozenFormat::SLOT_SIZE,&value.mArray[n - 1]));
+                    }
+                }
+                break;
+
+            case JsonValueType::OBJECT:
+                {
+                    Align();
+                    size_t entry = mOutput.size();
+                    PutSlot(slot,JsonFrozenFormat::OBJECT,value.mObject.size(),entry);
+                    mOutput.append(value.mObject.size() * JsonFrozenFormat::ENTRY_SIZE,'\0');
+                    // The std::map has them in key order already, the order the binary search in JsonFrozenView needs.
+                    for( const auto& member : value.mObject )
+                    {
+                        Put32(entry,CheckOffset(WriteString(member.first)));
+                        Put32(entry + 4,uint32_t(member.first.size()));
+                        pending.push_back(std::make_pair(entry + 8,&member.second));
+                        entry += JsonFrozenFormat::ENTRY_SIZE;
+                    }
+                }
+                break;
+            }
+        }
+
+        Align();
+        const uint64_t size = mOutput.size();
+        memcpy(&mOutput[8],&size,sizeof(size));
+    }
+
+private:
+    std::string& mOutput;
+    const bool mPackNumberArrays;
+    std::map<std::string,uint32_t> mShared; //!< Where the keys and short strings already written are.
+
+    static uint32_t CheckOffset(size_t pOffset)
+    {
+        if( pOffset > std::numeric_limits<uint32_t>::max() )
+        {
+            THROW_JSON_EXCEPTION("Json is too big to be frozen, frozen documents can not be bigger than 4GB");
+        }
+        return uint32_t(pOffset);
+    }
+
+    void Put32(size_t pAt,uint32_t pValue)
+    {
+        memcpy(&mOutput[pAt],&pValue,sizeof(pValue));
+    }
+
+    void PutSlot(size_t pAt,JsonFrozenFormat::Type pType,size_t pCount,size_t pOffset)
+    {
+        Put32(pAt,JsonFrozenFormat::MakeTypeAndCount(pType,pCount));
+        Put32(pAt + 4,CheckOffset(pOffset));
+    }
+
+    /**
+     * @brief Pads the output so the next thing written starts on 8 bytes, so the slots and doubles are aligned when the data is.
+     */
+    void Align()
+    {
+        mOutput.append((8 - mOutput.size() % 8) % 8,'\0');
+    }
+
+    void AppendDouble(double pValue)
+    {
+        char bytes[sizeof(pValue)];
+        memcpy(bytes,&pValue,sizeof(pValue));
+        mOutput.append(bytes,sizeof(bytes));
+    }
+
+    /**
+     * @brief Writes the text with a zero after it, or finds where it was written before, and returns its offset.
+     */
+    size_t WriteString(const std::string& pText)
+    {
+        if( pText.size() <= MAX_SHARED_STRING )
+        {
+            auto found = mShared.find(pText);
+            if( found != mShared.end() )
+            {
+                return found->second;
+            }
+            mShared.emplace(pText,CheckOffset(mOutput.size()));
+        }
+        const size_t offset = mOutput.size();
+        mOutput.append(pText.c_str(),pText.size() + 1);
+        return offset;
+    }
+
+    /**
+     * @brief Whole numbers that fit in 32 bits go in the slot, the rest are written as a double followed by their text.
+     */
+    void WriteNumber(size_t pSlot,const std::string& pText)
+    {
+        const char* digits = pText.c_str() + (pText.size() > 0 && pText[0] == '-' ? 1 : 0);
+        const size_t length = pText.size() - (digits - pText.c_str());
+        const bool whole = length > 0 && length <= 10 && (digits[0] != '0' || length == 1) && strspn(digits,"0123456789") == length;
+        if( whole && pText != "-0" )
+        {
+            const long long number = strtoll(pText.c_str(),nullptr,10);
+            if( number >= std::numeric_limits<int32_t>::min() && number <= std::numeric_limits<int32_t>::max() )
+            {
+                PutSlot(pSlot,JsonFrozenFormat::INTEGER,0,0);
+                Put32(pSlot + 4,uint32_t(int32_t(number)));
+                return;
+            }
+        }
+
+        Align();
+        PutSlot(pSlot,JsonFrozenFormat::NUMBER,pText.size(),mOutput.size());
+        AppendDouble(strtod(pText.c_str(),nullptr));
+        mOutput.append(pText.c_str(),pText.size() + 1);
+    }
+
+    /**
+     * @brief True if the array is all numbers that a double holds exactly enough, whole numbers of more than 15 digits may not be.
+     */
+    static bool CanPack(const std::vector<JsonValue>& pArray)
+    {
+        if( pArray.size() == 0 )
+        {
+            return false;
+        }
+        for( const auto& element : pArray )
+        {
+            if( element.mType != JsonValueType::NUMBER )
+            {
+                return false;
+            }
+            if( element.mValue.size() > 15 && element.mValue.find_first_of(".eE") == std::string::npos )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief A read only view of a value in a frozen document, written by JsonFrozenWriter. Nothing is read in or built, so opening one is instant
+ * however big it is, map the file into memory and make a view of it. The views are small and are made as they are asked for, copy them as you like.
+ * The data must stay alive and not change while there are views of it.
+ *     const JsonFrozenView root(mappedData,mappedSize);
+ *     std::cout << root["list"][0]["main"]["temp"].GetDouble() << '\n';
+ * Strings are as they are in a JsonValue, escapes and all, and end with a zero. Keys are found with a binary search.
+ * Every offset is checked against the size of the data before it is used, so a damaged file throws std::runtime_error and is never read past the end.
+ */
+class JsonFrozenView
+{
+public:
+    /**
+     * @brief A view of nothing, its type is INVALID.
+     */
+    JsonFrozenView() = default;
+
+    /**
+     * @brief The view of the root of the frozen document in pData. Checks the header, throws std::runtime_error if it is not a frozen document.
+     */
+    JsonFrozenView(const void* pData,size_t pSize) :
+        mData((const char*)pData),
+        mSize(pSize)
+    {
+        if( pData == nullptr || pSize < JsonFrozenFormat::HEADER_SIZE )
+        {
+            THROW_JSON_EXCEPTION("Frozen json document is too small to have a header");
+        }
+        uint64_t size;
+        memcpy(&size,mData + 8,sizeof(size));
+        if( Get32(0) != JsonFrozenFormat::MAGIC )
+        {
+            THROW_JSON_EXCEPTION("Data is not a frozen json document, or was written on a machine with the other byte order");
+        }
+        if( Get32(4) != JsonFrozenFormat::VERSION )
+        {
+            THROW_JSON_EXCEPTION("Frozen json document is version " + std::to_string(Get32(4)) + ", only version " + std::to_string(JsonFrozenFormat::VERSION) + " can be read");
+        }
+        if( size != pSize )
+        {
+            THROW_JSON_EXCEPTION("Frozen json document should be " + std::to_string(size) + " bytes but is " + std::to_string(pSize));
+        }
+        LoadSlot(JsonFrozenFormat::ROOT_SLOT);
+    }
+
+    JsonFrozenView(const std::string& pData) : JsonFrozenView(pData.data(),pData.size()){}
+
+    JsonValueType GetType()const
+    {
+        switch( mType )
+        {
+        case JsonFrozenFormat::NULL_VALUE:      return mData ? JsonValueType::NULL_VALUE : JsonValueType::INVALID;
+        case JsonFrozenFormat::FALSE_VALUE:
+        case JsonFrozenFormat::TRUE_VALUE:      return JsonValueType::BOOLEAN;
+        case JsonFrozenFormat::INTEGER:
+        case JsonFrozenFormat::NUMBER:
+        case JsonFrozenFormat::PACKED_NUMBER:   return JsonValueType::NUMBER;
+        case JsonFrozenFormat::STRING:          return JsonValueType::STRING;
+        case JsonFrozenFormat::ARRAY:
+        case JsonFrozenFormat::NUMBER_ARRAY:    return JsonValueType::ARRAY;
+        case JsonFrozenFormat::OBJECT:          return JsonValueType::OBJECT;
+        }
+        THROW_JSON_EXCEPTION("Frozen json document has a value of unknown type " + std::to_string(mType));
+    }
+
+    bool IsString()const{return GetType() == JsonValueType::STRING;}
+    bool IsNumber()const{return GetType() == JsonValueType::NUMBER;}
+    bool IsObject()const{return GetType() == JsonValueType::OBJECT;}
+    bool IsArray()const{return GetType() == JsonValueType::ARRAY;}
+    bool IsBool()const{return GetType() == JsonValueType::BOOLEAN;}
+    bool IsNULL()const{return GetType() == JsonValueType::NULL_VALUE;}
+
+    /**
+     * @brief Fetches the size of the array, if the type is an array, else zero.
+     */
+    size_t GetArraySize()const
+    {
+        return IsArray() ? mCount : 0;
+    }
+
+    /**
+     * @brief The number of keys, if the type is an object, else zero.
+     */
+    size_t GetObjectSize()const
+    {
+        return mType == JsonFrozenFormat::OBJECT ? mCount : 0;
+    }
+
+    const JsonFrozenView operator [](size_t pIndex)const
+    {
+        AssertType(JsonValueType::ARRAY);
+        if( pIndex >= mCount )
+        {
+            THROW_JSON_EXCEPTION("Frozen json array index " + std::to_string(pIndex) + " is past the end, the array has " + std::to_string(mCount) + " elements");
+        }
+
+        JsonFrozenView element(*this);
+        if( mType == JsonFrozenFormat::NUMBER_ARRAY )
+        {
+            element.mType = JsonFrozenFormat::PACKED_NUMBER;
+            element.mOffset = mOffset + uint32_t(pIndex * sizeof(double));
+        }
+        else
+        {
+            element.LoadSlot(mOffset + pIndex * JsonFrozenFormat::SLOT_SIZE);
+        }
+        return element;
+    }
+    const JsonFrozenView operator [](int pIndex)const{return (*this)[size_t(pIndex)];}
+
+    /**
+     * @brief The value for the key, throws std::runtime_error if this is not an object or the key is not in it.
+     */
+    const JsonFrozenView operator [](const std::string& pKey)const
+    {
+        const JsonFrozenView found = Find(pKey.data(),pKey.size());
+        if( found.mData == nullptr )
+        {
+            THROW_JSON_EXCEPTION("Json value for key " + pKey + " not found");
+        }
+        return found;
+    }
+    const JsonFrozenView operator [](const char* pKey)const{assert(pKey);return (*this)[std::string(pKey)];}
+
+    /**
+     * @brief Checks that the key passed in exists without throwing an exception.
+     */
+    bool HasValue(const std::string& pKey)const
+    {
+        return mType == JsonFrozenFormat::OBJECT && Find(pKey.data(),pKey.size()).mData != nullptr;
+    }
+
+    /**
+     * @brief The value for the key, or a view of nothing, type INVALID, if the key is not in the object. Throws if this is not an object.
+     */
+    JsonFrozenView Find(const char* pKey,size_t pLength)const
+    {
+        AssertType(JsonValueType::OBJECT);
+        // The entries are in the same order as the keys of a std::map, the order of std::string::compare.
+        size_t first = 0,last = mCount;
+        while( first < last )
+        {
+            const size_t middle = first + (last - first) / 2;
+            const size_t entry = mOffset + middle * JsonFrozenFormat::ENTRY_SIZE;
+            const uint32_t keyLength = Get32(entry + 4);
+            const char* key = GetText(Get32(entry),keyLength);
+            int order = memcmp(key,pKey,std::min(size_t(keyLength),pLength));
+            if( order == 0 )
+            {
+                order = keyLength < pLength ? -1 : (keyLength > pLength ? 1 : 0);
+            }
+
+            if( order == 0 )
+            {
+                JsonFrozenView value(*this);
+                value.LoadSlot(entry + 8);
+                return value;
+            }
+            if( order < 0 )
+            {
+                first = middle + 1;
+            }
+            else
+            {
+                last = middle;
+            }
+        }
+        return JsonFrozenView();
+    }
+
+    /**
+     * @brief The key of entry pIndex of an object, the entries are in key order. With GetValueAt the entries can be gone through like a std::map.
+     */
+    const char* GetKeyAt(size_t pIndex)const
+    {
+        const size_t entry = GetEntry(pIndex);
+        return GetText(Get32(entry),Get32(entry + 4));
+    }
+
+    JsonFrozenView GetValueAt(size_t pIndex)const
+    {
+        JsonFrozenView value(*this);
+        value.LoadSlot(GetEntry(pIndex) + 8);
+        return value;
+    }
+
+    /**
+     * @brief Gets the string, if it is a string type. Else throws an exception. Like JsonValue::GetString it is the text from the json, escapes and all.
+     */
+    const char* GetString()const
+    {
+        AssertType(JsonValueType::STRING);
+        return GetText(mOffset,mCount);
+    }
+
+    size_t GetStringLength()const
+    {
+        AssertType(JsonValueType::STRING);
+        return mCount;
+    }
+
+#if __cplusplus >= 201703L
+    std::string_view GetStringView()const
+    {
+        return std::string_view(GetString(),mCount);
+    }
+#endif
+
+    /**
+     * @brief The text of the number, as it was in the json. Numbers from packed arrays only kept their value, so their text is made from it.
+     */
+    std::string GetNumberText()const
+    {
+        std::string text;
+        switch( mType )
+        {
+        case JsonFrozenFormat::INTEGER:
+            JsonAppendNumber(text,int32_t(mOffset));
+            break;
+
+        case JsonFrozenFormat::NUMBER:
+            text.assign(GetText(mOffset + sizeof(double),mCount),mCount);
+            break;
+
+        default:
+            JsonAppendNumber(text,GetDouble());
+            break;
+        }
+        return text;
+    }
+
+    double GetDouble()const
+    {
+        AssertType(JsonValueType::NUMBER);
+        if( mType == JsonFrozenFormat::INTEGER )
+        {
+            return int32_t(mOffset);
+        }
+        Check(mOffset,sizeof(double));
+        double value;
+        memcpy(&value,mData + mOffset,sizeof(value));
+        return value;
+    }
+
+    float GetFloat()const{return float(GetDouble());}
+    int GetInt()const{return GetInt32();}
+    int32_t GetInt32()const{return mType == JsonFrozenFormat::INTEGER ? int32_t(mOffset) : int32_t(GetInt64());}
+    uint32_t GetUInt32()const{return uint32_t(GetUInt64());}
+
+    /**
+     * @brief Whole numbers too big for a double to hold exactly are read from their text.
+     */
+    int64_t GetInt64()const
+    {
+        if( mType == JsonFrozenFormat::NUMBER )
+        {
+            return strtoll(GetText(mOffset + sizeof(double),mCount),nullptr,10);
+        }
+        return mType == JsonFrozenFormat::INTEGER ? int64_t(int32_t(mOffset)) : int64_t(GetDouble());
+    }
+
+    uint64_t GetUInt64()const
+    {
+        if( mType == JsonFrozenFormat::NUMBER )
+        {
+            return strtoull(GetText(mOffset + sizeof(double),mCount),nullptr,10);
+        }
+        return uint64_t(GetInt64());
+    }
+
+    bool GetBoolean()const
+    {
+        AssertType(JsonValueType::BOOLEAN);
+        return mType == JsonFrozenFormat::TRUE_VALUE;
+    }
+
+    /**
+     * @brief Copies the value, and everything in it, into a JsonValue tree. Done without recursion, like the rest of TinyJson.
+     * Every value has its own slot, or packed double, so a document can not hold more values than it has slots. A damaged one
+     * with an array that holds itself, or that is in more than one place, is turned down once it has given more values than that.
+     */
+    JsonValue Thaw()const
+    {
+        const size_t mostValues = mSize / JsonFrozenFormat::SLOT_SIZE;
+        size_t values = 1;
+        JsonValue root;
+        std::vector<std::pair<JsonFrozenView,JsonValue*>> pending(1,std::make_pair(*this,&root));
+        while( pending.size() > 0 )
+        {
+            const JsonFrozenView view = pending.back().first;
+            JsonValue& value = *pending.back().second;
+            pending.pop_back();
+
+            value.mType = view.GetType();
+            if( value.mType == JsonValueType::ARRAY || value.mType == JsonValueType::OBJECT )
+            {
+                values += view.mCount;
+                if( values > mostValues )
+                {
+                    THROW_JSON_EXCEPTION("Frozen json document is damaged, it has more values than it has room for");
+                }
+            }
+            switch( value.mType )
+            {
+            case JsonValueType::BOOLEAN:
+                value.mBoolean = view.GetBoolean();
+                break;
+
+            case JsonValueType::NUMBER:
+                value.mValue = view.GetNumberText();
+                break;
+
+            case JsonValueType::STRING:
+                value.mValue.assign(view.GetString(),view.mCount);
+                break;
+
+            case JsonValueType::ARRAY:
+                value.mArray.resize(view.mCount);
+                for( size_t n = 0 ; n < view.mCount ; n++ )
+                {
+                    pending.push_back(std::make_pair(view[n],&value.mArray[n]));
+                }
+                break;
+
+            case JsonValueType::OBJECT:
+                for( size_t n = 0 ; n < view.mCount ; n++ )
+                {
+                    const size_t entry = view.GetEntry(n);
+                    JsonValue& member = value.mObject.emplace_hint(value.mObject.end(),std::string(view.GetText(view.Get32(entry),view.Get32(entry + 4)),view.Get32(entry + 4)),JsonValue())->second;
+                    pending.push_back(std::make_pair(view.GetValueAt(n),&member));
+                }
+                break;
+
+            case JsonValueType::NULL_VALUE:
+            case JsonValueType::INVALID:
+                break;
+            }
+        }
+        return root;
+    }
+
+private:
+    const char* mData = nullptr;    //!< The start of the frozen document, all offsets are from here.
+    size_t mSize = 0;
+    uint32_t mType = JsonFrozenFormat::NULL_VALUE;
+    uint32_t mCount = 0;
+    uint32_t mOffset = 0;           //!< Where the value is, or for INTEGER the value.
+
+    void Check(size_t pOffset,size_t pBytes)const
+    {
+        if( pOffset > mSize || pBytes > mSize - pOffset )
+        {
+            THROW_JSON_EXCEPTION("Frozen json document is damaged, it has an offset past its end");
+        }
+    }
+
+    uint32_t Get32(size_t pOffset)const
+    {
+        Check(pOffset,sizeof(uint32_t));
+        uint32_t value;
+        memcpy(&value,mData + pOffset,sizeof(value));
+        return value;
+    }
+
+    /**
+     * @brief Text of pLength characters at pOffset, checked to be inside the data and to have its zero.
+     */
+    const char* GetText(size_t pOffset,size_t pLength)const
+    {
+        Check(pOffset,pLength + 1);
+        if( mData[pOffset + pLength] != 0 )
+        {
+            THROW_JSON_EXCEPTION("Frozen json document is damaged, a string does not end with a zero");
+        }
+        return mData + pOffset;
+    }
+
+    void LoadSlot(size_t pOffset)
+    {
+        const uint32_t typeAndCount = Get32(pOffset);
+        mType = typeAndCount & 15;
+        mCount = typeAndCount >> 4;
+        mOffset = Get32(pOffset + 4);
+        if( mType > JsonFrozenFormat::OBJECT )
+        {
+            THROW_JSON_EXCEPTION("Frozen json document is damaged, it has a value of unknown type " + std::to_string(mType));
+        }
+    }
+
+    size_t GetEntry(size_t pIndex)const
+    {
+        AssertType(JsonValueType::OBJECT);
+        if( pIndex >= mCount )
+        {
+            THROW_JSON_EXCEPTION("Frozen json object entry " + std::to_string(pIndex) + " is past the end, the object has " + std::to_string(mCount) + " entries");
+        }
+        return mOffset + pIndex * JsonFrozenFormat::ENTRY_SIZE;
+    }
+
+    void AssertType(JsonValueType pType)const
+    {
+        if( GetType() != pType )
+        {
+            THROW_JSON_EXCEPTION("Json Type is not what is expected, the type is " + JsonValueTypeToString(GetType()) + " looking for " + JsonValueTypeToString(pType));
+        }
+    }
+};
+
+/**
+ * @brief Short hand for JsonFrozenWriter, returns the frozen document of the tree.
+ */
+inline std::string JsonFreeze(const JsonValue& pRoot,bool pPackNumberArrays = true)
+{
+    std::string frozen;
+    JsonFrozenWriter writer(frozen,pPackNumberArrays);
+    writer.Write(pRoot);
+    return frozen;
+}
+
+/**
+ * @brief Applies RFC 6902 json patches and RFC 7386 merge patches to a tree in place, so a change sent as a patch does not need the document parsing again.
+ * A json patch is applied whole or not at all. Each operation notes what it did, moving out any value it replaced or removed and not copying it,
+ * and if an operation fails those notes are used to put the tree back as it was before the error is thrown.
+ * Paths are json pointers, RFC 6901, matched against the keys as they are held in the tree, escapes and all.
+ */
+class JsonPatcher
+{
+    friend class JsonArrayReader;
+public:
+    JsonPatcher(JsonValue& rTarget) : mTarget(rTarget){}
+
+    /**
+     * @brief Applies the operations of pPatch in order, throws std::runtime_error, leaving the tree as it was, if any of them fail, including a test.
+     */
+    void Apply(const JsonValue& pPatch)
+    {
+        if( pPatch.GetType() != JsonValueType::ARRAY )
+        {
+            THROW_JSON_EXCEPTION("A json patch must be an array of operations");
+        }
+
+        mUndo.clear();
+        try
+        {
+            for( const JsonValue& operation : pPatch.mArray )
+            {
+                ApplyOperation(operation);
+            }
+        }
+        catch( ... )
+        {
+            JsonValue carried;
+            while( mUndo.size() > 0 )
+            {
+                carried = Undo(mUndo.back(),std::move(carried));
+                mUndo.pop_back();
+            }
+            throw;
+        }
+        mUndo.clear();
+    }
+
+    /**
+     * @brief Merges pPatch into the tree, members set to null are removed, objects are merged and anything else replaces what was there.
+     * Can not fail, any json is a merge patch.
+     */
+    void ApplyMerge(const JsonValue& pPatch)
+    {
+        std::vector<std::pair<JsonValue*,const JsonValue*>> pending(1,std::make_pair(&mTarget,&pPatch));
+        while( pending.size() > 0 )
+        {
+            JsonValue& target = *pending.back().first;
+            const JsonValue& patch = *pending.back().second;
+            pending.pop_back();
+            if( patch.mType != JsonValueType::OBJECT )
+            {
+                target = patch;
+                continue;
+            }
+
+            if( target.mType != JsonValueType::OBJECT )
+            {
+                target = JsonValue(JsonValueType::OBJECT);
+            }
+            target.mHash = 0;
+            for( const auto& entry : patch.mObject )
+            {
+                if( entry.second.mType == JsonValueType::NULL_VALUE )
+                {
+                    target.mObject.erase(entry.first);
+                }
+                else if( entry.second.mType == JsonValueType::OBJECT )
+                {
+                    pending.emplace_back(&target.mObject[entry.first],&entry.second);
+                }
+                else
+                {
+                    target.mObject[entry.first] = entry.second;
+                }
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief What an operation did, to be able to put it back.
+     */
+    struct Change
+    {
+        enum Type
+        {
+            ADDED,          //!< mToken was added to the array or object at mPath, undone by taking it out again.
+            REMOVED,        //!< mOld was removed from mToken of the array or object at mPath, undone by putting it back.
+            SWAPPED         //!< The value at mPath was swapped with mOld, undone by swapping them back.
+        };
+        Type mType;
+        std::vector<std::string> mPath;
+        std::string mToken;
+        JsonValue mOld;
+        bool mMoved;        //!< For REMOVED, the value was moved somewhere else and the undo of that gives it back, it is not in mOld.
+    };
+
+    JsonValue& mTarget;
+    std::vector<Change> mUndo;
+
+    static const std::string& GetMember(const JsonValue& pOperation,const char* pKey)
+    {
+        const auto found = pOperation.mObject.find(pKey);
+        if( found == pOperation.mObject.end() || found->second.mType != JsonValueType::STRING )
+        {
+            THROW_JSON_EXCEPTION(std::string("Json patch operation is missing its string member \"") + pKey + "\"");
+        }
+        return found->second.mValue;
+    }
+
+    static const JsonValue& GetValue(const JsonValue& pOperation)
+    {
+        const auto found = pOperation.mObject.find("value");
+        if( found == pOperation.mObject.end() )
+        {
+            THROW_JSON_EXCEPTION("Json patch operation is missing its value");
+        }
+        return found->second;
+    }
+
+    /**
+     * @brief Splits a json pointer into its keys and indices, with ~1 and ~0 turned back into / and ~.
+     */
+    static std::vector<std::string> SplitPointer(const std::string& pPointer)
+    {
+        std::vector<std::string> tokens;
+        if( pPointer.size() > 0 && pPointer[0] != '/' )
+        {
+            THROW_JSON_EXCEPTION("Json pointer " + pPointer + " does not start with a /");
+        }
+        for( size_t n = 0 ; n < pPointer.size() ; n++ )
+        {
+            const char c = pPointer[n];
+            if( c == '/' )
+            {
+                tokens.emplace_back();
+            }
+            else if( c == '~' )
+            {
+                const char escaped = n + 1 < pPointer.size() ? pPointer[++n] : 0;
+                if( escaped != '0' && escaped != '1' )
+                {
+                    THROW_JSON_EXCEPTION("Json pointer " + pPointer + " has a ~ that is not followed by 0 or 1");
+                }
+                tokens.back() += escaped == '0' ? '~' : '/';
+            }
+            else
+            {
+                tokens.back() += c;
+            }
+        }
+        return tokens;
+    }
+
+    /**
+     * @brief The index of an array element, pAllowEnd lets through the size of the array and "-", which both mean after the last element.
+     */
+    static size_t GetIndex(const JsonValue& pArray,const std::string& pToken,bool pAllowEnd)
+    {
+        size_t index = 0;
+        if( pToken == "-" )
+        {
+            index = pArray.mArray.size();
+        }
+        else
+        {
+            if( pToken.empty() || pToken.size() > 18 || (pToken[0] == '0' && pToken.size() > 1) ||
+                std::find_if(pToken.begin(),pToken.end(),[](char c){return c < '0' || c > '9';}) != pToken.end() )
+            {
+                THROW_JSON_EXCEPTION("Json pointer array index " + pToken + " is not a number");
+            }
+            index = size_t(std::stoull(pToken));
+        }
+
+        if( index > pArray.mArray.size() || (index == pArray.mArray.size() && !pAllowEnd) )
+        {
+            THROW_JSON_EXCEPTION("Json pointer array index " + pToken + " is past the end of the array");
+        }
+        return index;
+    }
+
+    /**
+     * @brief Follows the tokens from the root. When pChange is set the value found is about to be changed, so it and the values holding it
+     * lose their JsonValue::mHash.
+     */
+    JsonValue& Find(const std::vector<std::string>& pTokens,bool pChange = false)
+    {
+        JsonValue* value = &mTarget;
+        for( size_t n = 0 ; n < pTokens.size() ; n++ )
+        {
+            if( pChange )
+            {
+                value->mHash = 0;
+            }
+            if( value->mType == JsonValueType::OBJECT )
+            {
+                const auto found = value->mObject.find(pTokens[n]);
+                if( found == value->mObject.end() )
+                {
+                    THROW_JSON_EXCEPTION("Json pointer key " + pTokens[n] + " not found");
+                }
+                value = &found->second;
+            }
+            else if( value->mType == JsonValueType::ARRAY )
+            {
+                value = &value->mArray[GetIndex(*value,pTokens[n],false)];
+            }
+            else
+            {
+                THROW_JSON_EXCEPTION("Json pointer goes into a " + JsonValueTypeToString(value->mType) + " at " + pTokens[n]);
+            }
+        }
+        if( pChange )
+        {
+            value->mHash = 0;
+        }
+        return *value;
+    }
+
+    void ApplyOperation(const JsonValue& pOperation)
+    {
+        if( pOperation.GetType() != JsonValueType::OBJECT )
+        {
+            THROW_JSON_EXCEPTION("A json patch operation must be an object");
+        }
+        const std::string& op = GetMember(pOperation,"op");
+        std::vector<std::string> path = SplitPointer(GetMember(pOperation,"path"));
+        if( op == "add" )
+        {
+            Add(std::move(path),JsonValue(GetValue(pOperation)));
+        }
+        else if( op == "remove" )
+        {
+            Remove(std::move(path),false);
+        }
+        else if( op == "replace" )
+        {
+            Swap(std::move(path),JsonValue(GetValue(pOperation)));
+        }
+        else if( op == "move" || op == "copy" )
+        {
+            std::vector<std::string> from = SplitPointer(GetMember(pOperation,"from"));
+            if( op == "copy" )
+            {
+                Add(std::move(path),JsonValue(Find(from)));
+            }
+            else if( from != path )
+            {
+                if( from.size() < path.size() && std::equal(from.begin(),from.end(),path.begin()) )
+                {
+                    THROW_JSON_EXCEPTION("Json patch can not move a value into one of its own children");
+                }
+                JsonValue moved = Remove(std::move(from),true);
+                try
+                {
+                    Add(std::move(path),std::move(moved));
+                }
+                catch(...)
+                {
+                    // Add throws before taking the value, the remove is undone with it like any other.
+                    mUndo.back().mOld = std::move(moved);
+                    mUndo.back().mMoved = false;
+                    throw;
+                }
+            }
+            else
+            {
+                Find(from); // Moving to the same place does nothing, but the value must be there.
+            }
+        }
+        else if( op == "test" )
+        {
+            if( Find(path) != GetValue(pOperation) )
+            {
+                THROW_JSON_EXCEPTION("Json patch test failed at " + GetMember(pOperation,"path"));
+            }
+        }
+        else
+        {
+            THROW_JSON_EXCEPTION("Json patch operation " + op + " is not known");
+        }
+    }
+
+    void Add(std::vector<std::string>&& rPath,JsonValue&& rValue)
+    {
+        if( rPath.empty() )
+        {
+            Swap(std::move(rPath),std::move(rValue));
+            return;
+        }
+
+        std::string token = std::move(rPath.back());
+        rPath.pop_back();
+        JsonValue& parent = Find(rPath,true);
+        if( parent.mType == JsonValueType::OBJECT )
+        {
+            if( parent.mObject.count(token) )
+            {
+                rPath.push_back(std::move(token));
+                Swap(std::move(rPath),std::move(rValue));
+            }
+            else
+            {
+                parent.mObject.emplace(token,std::move(rValue));
+                Note({Change::ADDED,std::move(rPath),std::move(token),JsonValue(),false});
+            }
+        }
+        else if( parent.mType == JsonValueType::ARRAY )
+        {
+            const size_t index = GetIndex(parent,token,true);
+            parent.mArray.insert(parent.mArray.begin() + index,std::move(rValue));
+            Note({Change::ADDED,std::move(rPath),std::to_string(index),JsonValue(),false});
+        }
+        else
+        {
+            THROW_JSON_EXCEPTION("Json patch can not add to a " + JsonValueTypeToString(parent.mType));
+        }
+    }
+
+    /**
+     * @brief When pMove is set the value is returned for the move to add somewhere else, otherwise it is kept to undo the remove.
+     */
+    JsonValue Remove(std::vector<std::string>&& rPath,bool pMove)
+    {
+        if( rPath.empty() )
+        {
+            THROW_JSON_EXCEPTION("Json patch can not remove the root");
+        }
+
+        std::string token = std::move(rPath.back());
+        rPath.pop_back();
+        JsonValue& parent = Find(rPath,true);
+        JsonValue removed;
+        if( parent.mType == JsonValueType::OBJECT )
+        {
+            const auto found = parent.mObject.find(token);
+            if( found == parent.mObject.end() )
+            {
+                THROW_JSON_EXCEPTION("Json pointer key " + token + " not found");
+            }
+            removed = std::move(found->second);
+            parent.mObject.erase(found);
+        }
+        else if( parent.mType == JsonValueType::ARRAY )
+        {
+            const size_t index = GetIndex(parent,token,false);
+            removed = std::move(parent.mArray[index]);
+            parent.mArray.erase(parent.mArray.begin() + index);
+            token = std::to_string(index);
+        }
+        else
+        {
+            THROW_JSON_EXCEPTION("Json patch can not remove from a " + JsonValueTypeToString(parent.mType));
+        }
+
+        if( pMove )
+        {
+            Note({Change::REMOVED,std::move(rPath),std::move(token),JsonValue(),true});
+            return removed;
+        }
+        Note({Change::REMOVED,std::move(rPath),std::move(token),std::move(removed),false});
+        return JsonValue();
+    }
+
+    void Swap(std::vector<std::string>&& rPath,JsonValue&& rValue)
+    {
+        JsonValue& target = Find(rPath,true);
+        std::swap(target,rValue);
+        Note({Change::SWAPPED,std::move(rPath),std::string(),std::move(rValue),false});
+    }
+
+    void Note(Change&& rChange)
+    {
+        mUndo.push_back(std::move(rChange));
+    }
+
+    /**
+     * @brief The tree is as it was just after the change, so the path is still there. Returns the value the change had put in,
+     * which is what the REMOVED of a move before it needs to put back.
+     */
+    JsonValue Undo(Change& rChange,JsonValue&& rCarried)
+    {
+        JsonValue& place = Find(rChange.mPath,true);
+        JsonValue taken;
+        if( rChange.mType == Change::SWAPPED )
+        {
+            taken = std::move(place);
+            place = std::move(rChange.mOld);
+        }
+        else if( place.mType == JsonValueType::OBJECT )
+        {
+            if( rChange.mType == Change::ADDED )
+            {
+                const auto found = place.mObject.find(rChange.mToken);
+                taken = std::move(found->second);
+                place.mObject.erase(found);
+            }
+            else
+            {
+                place.mObject.emplace(rChange.mToken,rChange.mMoved ? std::move(rCarried) : std::move(rChange.mOld));
+            }
+        }
+        else
+        {
+            const size_t index = size_t(std::stoull(rChange.mToken));
+            if( rChange.mType == Change::ADDED )
+            {
+                taken = std::move(place.mArray[index]);
+                place.mArray.erase(place.mArray.begin() + index);
+            }
+            else
+            {
+                place.mArray.insert(place.mArray.begin() + index,rChange.mMoved ? std::move(rCarried) : std::move(rChange.mOld));
+            }
+        }
+        return taken;
+    }
+};
+
+/**
+ * @brief Makes an RFC 6902 json patch, an array of operations that turns one tree into another, for sending what changed and not the whole document.
+ * The trees are walked together and branches that are the same are passed over, the compare stops at the first difference it finds.
+ * Arrays have the elements that are the same at the start and end taken off, the rest are lined up by their hashes so an element put in
+ * or taken out is one operation and not a change to every element after it. Each array and object is hashed once, with the hashes of its
+ * children kept, so lining up is a compare of two numbers, then a check that they really are the same. When the same number of elements
+ * are left in both, and for arrays too big to line up, more than MAX_ALIGN_CELLS elements in one times elements in the other,
+ * the elements are changed in place and any extra ones added or removed at the end.
+ * Keys and strings are written into the patch as they are held in the tree, escapes and all.
+ */
+class JsonDiff
+{
+public:
+    static const size_t MAX_ALIGN_CELLS = 4 * 1024 * 1024; //!< The biggest table used to line up the elements of two arrays.
+
+    /**
+     * @brief Returns the patch that turns pFrom into pTo, an empty array if they are the same.
+     */
+    JsonValue Make(const JsonValue& pFrom,const JsonValue& pTo)
+    {
+        JsonValue patch(JsonValueType::ARRAY);
+        std::vector<Work> pending;
+        if( IsContainer(pFrom) && pFrom.mType == pTo.mType )
+        {
+            pending.push_back({&pFrom,&pTo,std::string()}); // Comparing first would only read the trees twice.
+        }
+        else if( !Same(pFrom,pTo) )
+        {
+            AddOperation(patch,"replace",std::string(),&pTo);
+        }
+        while( pending.size() > 0 )
+        {
+            const Work work = std::move(pending.back());
+            pending.pop_back();
+            if( work.mFrom->mType == JsonValueType::OBJECT )
+            {
+                DiffObject(work,patch,pending);
+            }
+            else if( work.mFrom->mType == JsonValueType::ARRAY )
+            {
+                DiffArray(work,patch,pending);
+            }
+        }
+
+        return patch;
+    }
+
+private:
+    /**
+     * @brief Two values of the same container type to compare, and the path of the json pointer to them.
+     */
+    struct Work
+    {
+        const JsonValue* mFrom;
+        const JsonValue* mTo;
+        std::string mPath;
+    };
+
+    std::unordered_map<const JsonValue*,uint64_t> mHashes;
+
+    static void AddOperation(JsonValue& rPatch,const char* pOperation,const std::string& pPath,const JsonValue* pValue)
+    {
+        JsonValue& operation = rPatch.EmplaceBack(JsonValueType::OBJECT);
+        operation.Emplace("op",pOperation);
+        operation.Emplace("path",pPath);
+        if( pValue )
+        {
+            operation.Emplace("value",*pValue);
+        }
+    }
+
+    /**
+     * @brief Adds a key to a json pointer, ~ and / in the key become ~0 and ~1.
+     */
+    static std::string AddKey(const std::string& pPath,const std::string& pKey)
+    {
+        std::string path = pPath + '/';
+        for( char c : pKey )
+        {
+            if( c == '~' )
+                path += "~0";
+            else if( c == '/' )
+                path += "~1";
+            else
+                path += c;
+        }
+        return path;
+    }
+
+    static bool IsContainer(const JsonValue& pValue)
+    {
+        return pValue.mType == JsonValueType::OBJECT || pValue.mType == JsonValueType::ARRAY;
+    }
+
+    static std::string AddIndex(const std::string& pPath,size_t pIndex)
+    {
+        return pPath + '/' + std::to_string(pIndex);
+    }
+
+    /**
+     * @brief Either looks at the values under both later, when they are the same type of container, or replaces the old value with the new.
+     */
+    static void Change(const JsonValue& pFrom,const JsonValue& pTo,std::string&& rPath,JsonValue& rPatch,std::vector<Work>& rPending)
+    {
+        if( IsContainer(pFrom) && pFrom.mType == pTo.mType )
+        {
+            rPending.push_back({&pFrom,&pTo,std::move(rPath)});
+        }
+        else
+        {
+            AddOperation(rPatch,"replace",rPath,&pTo);
+        }
+    }
+
+    /**
+     * @brief The keys of both are in order, so they are walked together like a merge.
+     */
+    void DiffObject(const Work& pWork,JsonValue& rPatch,std::vector<Work>& rPending)
+    {
+        const JsonKeyValue& from = pWork.mFrom->mObject;
+        const JsonKeyValue& to = pWork.mTo->mObject;
+        auto f = from.begin();
+        auto t = to.begin();
+        while( f != from.end() || t != to.end() )
+        {
+            if( t == to.end() || (f != from.end() && f->first < t->first) )
+            {
+                AddOperation(rPatch,"remove",AddKey(pWork.mPath,f->first),nullptr);
+                ++f;
+            }
+            else if( f == from.end() || t->first < f->first )
+            {
+                AddOperation(rPatch,"add",AddKey(pWork.mPath,t->first),&t->second);
+                ++t;
+            }
+            else
+            {
+                if( !Same(f->second,t->second) )
+                {
+                    Change(f->second,t->second,AddKey(pWork.mPath,f->first),rPatch,rPending);
+                }
+                ++f;
+                ++t;
+            }
+        }
+    }
+
+    /**
+     * @brief Operations are made from the first element to the last, so the index of an element that is looked at later,
+     * in rPending, is not moved by the elements added or removed after it.
+     */
+    void DiffArray(const Work& pWork,JsonValue& rPatch,std::vector<Work>& rPending)
+    {
+        const std::vector<JsonValue>& from = pWork.mFrom->mArray;
+        const std::vector<JsonValue>& to = pWork.mTo->mArray;
+        size_t first = 0;
+        while( first < from.size() && first < to.size() && Same(from[first],to[first]) )
+        {
+            first++;
+        }
+        const bool firstDiffers = first < from.size() && first < to.size(); // Then there is no need to compare them again from the end.
+        size_t fromEnd = from.size();
+        size_t toEnd = to.size();
+        while( fromEnd > first && toEnd > first && !(firstDiffers && fromEnd - 1 == first && toEnd - 1 == first) && Same(from[fromEnd - 1],to[toEnd - 1]) )
+        {
+            fromEnd--;
+            toEnd--;
+        }
+
+        // The length of the longest run of matching hashes from each pair of positions to the end, when the table is not too big.
+        // When as many elements are left in both they are taken to have been changed in place, which saves hashing them.
+        const size_t fromCount = fromEnd - first;
+        const size_t toCount = toEnd - first;
+        const size_t columns = toCount + 1;
+        std::vector<uint32_t> longest;
+        if( fromCount > 0 && toCount > 0 && fromCount != toCount && fromCount * toCount <= MAX_ALIGN_CELLS )
+        {
+            longest.assign((fromCount + 1) * columns,0);
+            for( size_t f = fromCount ; f-- > 0 ; )
+            {
+                const uint64_t hash = Hash(from[first + f]);
+                for( size_t t = toCount ; t-- > 0 ; )
+                {
+                    longest[f * columns + t] = hash == Hash(to[first + t]) ?
+                        longest[(f + 1) * columns + t + 1] + 1 :
+                        std::max(longest[(f + 1) * columns + t],longest[f * columns + t + 1]);
+                }
+            }
+        }
+
+        size_t f = 0,t = 0;
+        size_t index = first; // Where the elements are in the array as it is being patched.
+        while( f < fromCount || t < toCount )
+        {
+            const JsonValue* fromValue = f < fromCount ? &from[first + f] : nullptr;
+            const JsonValue* toValue = t < toCount ? &to[first + t] : nullptr;
+            if( fromValue && toValue && (longest.empty() || Hash(*fromValue) == Hash(*toValue) ||
+                longest[(f + 1) * columns + t + 1] == longest[f * columns + t]) )
+            {
+                // The same, or as good to change one into the other as to remove one and add the other.
+                if( (f == 0 && t == 0 && firstDiffers) || !Same(*fromValue,*toValue) )
+                {
+                    Change(*fromValue,*toValue,AddIndex(pWork.mPath,index),rPatch,rPending);
+                }
+                f++;
+                t++;
+                index++;
+            }
+            else if( fromValue && (toValue == nullptr || longest[(f + 1) * columns + t] >= longest[f * columns + t + 1]) )
+            {
+                AddOperation(rPatch,"remove",AddIndex(pWork.mPath,index),nullptr);
+                f++;
+            }
+            else
+            {
+                AddOperation(rPatch,"add",AddIndex(pWork.mPath,index),toValue);
+                t++;
+                index++;
+            }
+        }
+    }
+
+    static bool Same(const JsonValue& pA,const JsonValue& pB)
+    {
+        return pA == pB;
+    }
+
+    /**
+     * @brief The hashes of the arrays and objects are kept, so the elements of an array inside an array are only hashed once.
+     * Hashes already in the tree, from JsonProcessor::EnableHashing or UpdateHashes, are used as they are.
+     */
+    uint64_t Hash(const JsonValue& pValue)
+    {
+        return JsonValue::HashTree(pValue,
+            [this](const JsonValue& pKnown) -> uint64_t
+            {
+                if( pKnown.mHash != 0 )
+                {
+                    return pKnown.mHash;
+                }
+                const auto found = mHashes.find(&pKnown);
+                return found != mHashes.end() ? found->second : 0;
+            },
+            [this](const JsonValue& pHashed,uint64_t pHash){mHashes[&pHashed] = pHash;});
+    }
+};
+
+/**
+ * @brief Short hand for JsonDiff, returns the json patch that turns pFrom into pTo.
+ */
+inline JsonValue JsonMakePatch(const JsonValue& pFrom,const JsonValue& pTo)
+{
+    JsonDiff diff;
+    return diff.Make(pFrom,pTo);
+}
+
+/**
+ * @brief Short hand for JsonPatcher, applies the json patch to rTarget, which is left as it was if the patch fails.
+ */
+inline void JsonApplyPatch(JsonValue& rTarget,const JsonValue& pPatch)
+{
+    JsonPatcher patcher(rTarget);
+    patcher.Apply(pPatch);
+}
+
+/**
+ * @brief Short hand for JsonPatcher, merges the merge patch into rTarget.
+ */
+inline void JsonApplyMergePatch(JsonValue& rTarget,const JsonValue& pPatch)
+{
+    JsonPatcher patcher(rTarget);
+    patcher.ApplyMerge(pPatch);
+}
+
+/**
+ * @brief Reads the elements of one array in a json document one at a time, without holding the whole array, for record streams of any size.
+ * The array is picked with a json pointer, "/features" or "" for a root array. Each call to Next parses the next element into a tree,
+ * the memory of the element before it is used again, so the memory used is that of the largest element and not the array.
+ * From a stream the json is read a block at a time. Values on the way to the array that are not on the pointer are read over by their
+ * brackets and quotes, the elements are parsed with a JsonProcessor and checked as any json is. The json after the array is not read.
+ *     tinyjson::JsonArrayReader features(file,"/features");
+ *     while( features.Next() ){Use(features.GetValue());}
+ */
+class JsonArrayReader : private JsonBlockScanner
+{
+public:
+    /**
+     * @brief Reads the array from json in memory, which must be kept until the reading is done.
+     */
+    JsonArrayReader(const char* pJson,size_t pLength,const std::string& pPointer = "") :
+        mPointer(pPointer)
+    {
+        StartMemory(pJson,pLength,false);
+        FindArray();
+    }
+
+    JsonArrayReader(const std::string& pJson,const std::string& pPointer = "") :
+        mPointer(pPointer)
+    {
+        StartMemory(pJson.c_str(),pJson.size(),true);
+        FindArray();
+    }
+
+    /**
+     * @brief Reads the array from rInput, which is read no further than the end of the array.
+     */
+    JsonArrayReader(std::istream& rInput,const std::string& pPointer = "") :
+        mPointer(pPointer)
+    {
+        StartStream(rInput);
+        FindArray();
+    }
+
+    /**
+     * @brief Parses the next element, returns false when there are no more. Throws std::runtime_error if the element or the array is not valid json.
+     */
+    bool Next()
+    {
+        if( mDone )
+        {
+            return false;
+        }
+
+        NextToken();
+        if( mCount > 0 && Peek() == ',' )
+        {
+            NextChar();
+            NextToken();
+            if( Peek() == ']' )
+            {
+                THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, comma not follwed by a value in " + GetName() + ", " + std::to_string(GetOffset()) + " bytes into the json");
+            }
+        }
+        else if( Peek() == ']' )
+        {
+            NextChar();
+            mDone = true;
+            return false;
+        }
+        else if( mCount > 0 )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Json format error detected, " + GetName() + " not terminated with ']', " + std::to_string(GetOffset()) + " bytes into the json");
+        }
+
+        const char* end = FindValueEnd(true);
+        try
+        {
+            mElement.Start(mPos,size_t(end - mPos),mFailOnDuplicateKeys,false,nullptr,nullptr,this);
+        }
+        catch(const std::exception& e)
+        {
+            THROW_JSON_EXCEPTION("Element " + std::to_string(mCount) + " of " + GetName() + ", " + std::to_string(GetOffset()) + " bytes into the json, failed to parse, " + e.what());
+        }
+        SkipTo(end);
+        mCount++;
+        return true;
+    }
+
+    /**
+     * @brief The element the last call to Next parsed, it is replaced by the next call.
+     */
+    const JsonValue& GetValue()const
+    {
+        return mElement.GetRoot();
+    }
+
+    /**
+     * @brief Moves the element out, for when it has to outlive the next call to Next. Its memory can then not be used again.
+     */
+    JsonValue TakeValue()
+    {
+        return mElement.TakeRoot();
+    }
+
+    /**
+     * @brief The index in the array of the element GetValue returns.
+     */
+    size_t GetIndex()const
+    {
+        return mCount - 1;
+    }
+
+    /**
+     * @brief The allocations of the parses of the elements, mReused shows the memory of one element being used again for the next.
+     */
+    const JsonParseStatistics& GetStatistics()const
+    {
+        return mElement.GetStatistics();
+    }
+
+    /**
+     * @brief Sets whether the elements are turned down if an object has the same key twice, see JsonProcessor.
+     */
+    void SetFailOnDuplicateKeys(bool pFail)
+    {
+        mFailOnDuplicateKeys = pFail;
+    }
+
+    /**
+     * @brief Sets how deeply arrays and objects can be nested in the elements, see JsonProcessor::SetMaxDepth.
+     */
+    void SetMaxDepth(size_t pMaxDepth)
+    {
+        mElement.SetMaxDepth(pMaxDepth);
+    }
+
+private:
+    const std::string mPointer;
+    JsonProcessor mElement;             //!< Parses each element, keeping the memory of the last one to use again.
+    size_t mCount = 0;                  //!< Elements read so far.
+    bool mDone = false;                 //!< The end of the array has been read.
+    bool mFailOnDuplicateKeys = false;
+
+    /**
+     * @brief Reads up to the first element of the array mPointer points to.
+     */
+    void FindArray()
+    {
+        const std::vector<std::string> tokens = JsonPatcher::SplitPointer(mPointer);
+        NextToken();
+        for( size_t depth = 0 ; depth < tokens.size() ; depth++ )
+        {
+            AssertDepth(depth + 1);
+            const std::string& token = tokens[depth];
+            const char open = Peek();
+            if( open != '{' && open != '[' )
+            {
+                NotFound(depth);
+            }
+            NextChar();
+            NextToken();
+
+            size_t index = 0;
+            if( open == '[' )
+            {
+                if( token.empty() || token.size() > 18 || (token[0] == '0' && token.size() > 1) || token.find_first_not_of("0123456789") != std::string::npos )
+                {
+                    NotFound(depth);
+                }
+                index = size_t(std::stoull(token));
+            }
+
+            // Read over the entries or elements before the one wanted.
+            for( size_t n = 0 ;; n++ )
+            {
+                if( Peek() == (open == '{' ? '}' : ']') )
+                {
+                    NotFound(depth);
+                }
+                if( n > 0 )
+                {
+                    AssertCorrectChar(',',"Json format error detected, did you forget a comma?");
+                    NextChar();
+                    NextToken();
+                }
+
+                bool wanted = n == index;
+                if( open == '{' )
+                {
+                    FindValueEnd(true);
+                    const char* start;
+                    size_t length;
+                    ScanString(start,length);
+                    std::string key;
+                    JsonUnescapeString(key,start,length);
+                    wanted = key == token;
+                    NextToken();
+                    AssertCorrectChar(':',"Json format error detected, seperator character ':'");
+                    NextChar();
+                    NextToken();
+                }
+
+                if( wanted )
+                {
+                    break;
+                }
+                SkipTo(FindValueEnd(false));
+                NextToken();
+            }
+        }
+
+        if( Peek() != '[' )
+        {
+            THROW_JSON_EXCEPTION("The json at " + (mPointer.empty() ? std::string("the root") : mPointer) + " is not an array");
+        }
+        AssertDepth(tokens.size() + 1);
+        mElement.SetMaxDepth(mMaxDepth - tokens.size() - 1);
+        NextChar();
+    }
+
+    /**
+     * @brief What the array is called in errors.
+     */
+    std::string GetName()const
+    {
+        return mPointer.empty() ? std::string("the root array") : "the array " + mPointer;
+    }
+
+    /**
+     * @brief Throws for the token of the pointer at pDepth, that is not in the object or array, or what it is in is not one.
+     */
+    void NotFound(size_t pDepth)const
+    {
+        const std::vector<std::string> tokens = JsonPatcher::SplitPointer(mPointer);
+        std::string found;
+        for( size_t n = 0 ; n < pDepth ; n++ )
+        {
+            found += "/" + tokens[n];
+        }
+        THROW_JSON_EXCEPTION("Json pointer " + mPointer + " not found, there is no " + tokens[pDepth] + " in " + (found.empty() ? std::string("the root") : found));
+    }
+
+    /**
+     * @brief Finds the end of the value at the current position by its brackets and quotes, reading more of the stream until all of it is in the block.
+     * If pKeep is false the value is not wanted, the position is moved on as more is read so the block does not grow to hold it.
+     */
+    const char* FindValueEnd(bool pKeep)
+    {
+        size_t depth = 0;
+        bool inString = false;
+        size_t scanned = 0; // How much from the position has been looked at.
+        for(;;)
+        {
+            const char* c = mPos + scanned;
+            for( ; c < mJsonEnd ; c++ )
+            {
+                if( inString )
+                {
+                    if( *c == '\\' )
+                    {
+                        if( c + 1 == mJsonEnd )
+                        {
+                            break; // Look at the escape again once there is more.
+                        }
+                        c++;
+                    }
+                    else if( *c == '\"' )
+                    {
+                        inString = false;
+                        if( depth == 0 )
+                        {
+                            return c + 1;
+                        }
+                    }
+                }
+                else if( *c == '\"' )
+                {
+                    inString = true;
+                }
+                else if( *c == '{' || *c == '[' )
+                {
+                    depth++;
+                }
+                else if( *c == '}' || *c == ']' )
+                {
+                    if( depth <= 1 )
+                    {
+                        return depth == 0 ? c : c + 1;
+                    }
+                    depth--;
+                }
+                else if( depth == 0 && (IsWhiteSpace(*c) || *c == ',' || *c == ':') )
+                {
+                    return c;
+                }
+            }
+
+            if( !pKeep )
+            {
+                SkipTo(c);
+            }
+            scanned = size_t(c - mPos);
+            if( !ReadMore() )
+            {
+                return mJsonEnd; // Cut short, the parser or the caller will say so.
+            }
+        }
+    }
+};
+
+/**
+ * @brief Binding lets a struct be read from and written to json without going through a JsonValue tree.
+ * List the fields once inside the struct and JsonDecode and JsonEncode do the rest.
+ *     struct Weather
+ *     {
+ *         int id = 0;
+ *         std::string main;
+ *         std::vector<double> readings;
+ *
+ *         TINYJSON_BIND(
+ *             TINYJSON_FIELD(id)
+ *             TINYJSON_FIELD(main)
+ *             TINYJSON_FIELD_NAMED("values",readings))
+ *     };
+ * Fields can be bool, numbers, std::string, JsonValue, other bound structs and std::vector or std::map with string keys of any of these.
+ * The key names must be string literals. When decoding, the keys of each bound type are put in a JsonKeySet the first time it is read,
+ * so each key in the json is turned into its field with one hash and one compare.
+ */
+#define TINYJSON_FIELD(FIELD__) rBinder.Field(#FIELD__,FIELD__);
+#define TINYJSON_FIELD_NAMED(KEY__,FIELD__) rBinder.Field(KEY__,FIELD__);
+#define TINYJSON_BIND(FIELDS__)                                                 \
+    template<typename BINDER> void JsonBind(BINDER& rBinder){FIELDS__}          \
+    template<typename BINDER> void JsonBind(BINDER& rBinder)const{FIELDS__}
+
+/**
+ * @brief Used to find out if a type has been bound with TINYJSON_BIND.
+ */
+struct JsonBindProbe
+{
+    template<typename NAME,typename FIELD> void Field(const NAME&,const FIELD&){}
+};
+template<typename T,typename = void> struct IsJsonBound : std::false_type{};
+template<typename T> struct IsJsonBound<T,decltype(std::declval<T&>().JsonBind(std::declval<JsonBindProbe&>()))> : std::true_type{};
+
+/**
+ * @brief Reads json straight into bound structs and standard containers, see TINYJSON_BIND, use JsonDecode rather than this directly.
+ * Works from the characters as they are scanned, no JsonValue tree is made. Strings are unescaped.
+ * Keys with no field are read over and ignored, fields with no key in the json are left as they are, as are fields the json sets to null.
+ * Errors are thrown with the line and column like the parser, which includes a value that is the wrong type for its field.
+ */
+class JsonDecoder : private JsonScanner
+{
+public:
+    JsonDecoder(const char* pJsonString,size_t pLength,bool pNullTerminated = false)
+    {
+        if( pJsonString == nullptr || pLength == 0 )
+        {
+            THROW_JSON_EXCEPTION("Empty string passed into JsonDecode");
+        }
+        Reset(pJsonString,pLength,pNullTerminated);
+    }
+
+    template<typename T> void Decode(T& rValue)
+    {
+        Read(rValue);
+        SkipWhiteSpace();
+        if( mPos < mJsonEnd )
+        {
+            THROW_JSON_EXCEPTION(GetErrorPos() + "Data found after root object, invalid Json");
+        }
+    }
+
+    /**
+     * @brief Sets how deeply arrays and objects can be nested, see JsonProcessor::SetMaxDepth. Structs that hold vectors of themselves are read by recursion,
+     * so for those this also limits how much stack decoding can use.
+     */
+    void SetMaxDepth(size_t pMaxDepth)
+    {
+        mMaxDepth = pMaxDepth;
+    }
+
+private:
+    std::string mKey;   //!< Holds a key that had escapes in it, once it has been unescaped.
+    size_t mDepth = 0;  //!< How many arrays and objects the value being read is inside of.
+
+    /**
+     * @brief Handed to JsonBind once the slot of a key has been found, it counts its way through the fields and reads the value into the one in that slot.
+     */
+    struct FieldReader
+    {
+        FieldReader(JsonDecoder& rDecoder,int pSlot):mDecoder(rDecoder),mSlot(pSlot){}
+
+        template<typename NAME,typename FIELD> void Field(const NAME&,FIELD& rField)
+        {
+            if( mField++ == mSlot )
+            {
+                mDecoder.Read(rField);
+            }
+        }
+
+        JsonDecoder& mDecoder;
+        const int mSlot;
+        int mField = 0;
+    };
+
+    /**
+     * @brief Handed to JsonBind to make the list of keys for the JsonKeySet of a bound type, in field order so the slots match FieldReader's count.
+     */
+    struct KeyCollector
+    {
+        template<size_t NAME_SIZE,typename FIELD> void Field(const char (&pName)[NAME_SIZE],const FIELD&)
+        {
+            mKeys.emplace_back(pName,NAME_SIZE - 1);
+        }
+
+        std::vector<std::string> mKeys;
+    };
+
+    /**
+     * @brief Skips the white space before a value, if the value is null it is read over and false returned so the field is left as it is.
+     */
+    bool StartValue()
+    {
+        SkipWhiteSpace();
+        return !MatchLiteral("null");
+    }
+
+    void WrongType(const char* pExpected)
+    {
+        THROW_JSON_EXCEPTION(GetErrorPos() + "Json value is not the right type for the field it is being read into, expecting " + pExpected);
+    }
+
+    void Read(bool& rValue)
+    {
+        if( StartValue() )
+        {
+            if( MatchLiteral("true") )
+                rValue = true;
+            else if( MatchLiteral("false") )
+                rValue = false;
+            else
+                WrongType("a boolean");
+        }
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T,bool>::value>::type Read(T& rValue)
+    {
+        if( !StartValue() )
+        {
+            return;
+        }
+        if( Peek() != '-' && !IsDigit(Peek()) )
         {
-            THROW_JSON_EXCEPTION(std::string("Malformed number ") + std::string(mPos-1,20) );
+            WrongType("a number");
         }
 
-        // Not allowed to start with a zero.
-        if( *mPos == '0' && isdigit(mPos[1]) )
+        const char* start;
+        size_t length;
+        ScanNumber(start,length);
+
+        // Add up the digits as unsigned, checking against the limit of the field's type as we go.
+        const bool negative = *start == '-';
+        const unsigned long long limit = negative ? 0ULL - (unsigned long long)std::numeric_limits<T>::min() : (unsigned long long)std::numeric_limits<T>::max();
+        unsigned long long magnitude = 0;
+        for( const char* c = start + negative ; c < start + length ; c++ )
         {
-            THROW_JSON_EXCEPTION(std::string("Malformed number, not allowed to start with zero.") + std::string(mPos-1,20) );
+            if( !IsDigit(*c) )
+            {
+                THROW_JSON_EXCEPTION(GetErrorPos() + "Json number is not a whole number, it can not be read into an integer field");
+            }
+            const unsigned digit = unsigned(*c - '0');
+            if( digit > limit || magnitude > (limit - digit) / 10 )
+            {
+                THROW_JSON_EXCEPTION(GetErrorPos() + "Json number is too big for the integer field it is being read into");
+            }
+            magnitude = magnitude * 10 + digit;
         }
+        rValue = negative ? T(0ULL - magnitude) : T(magnitude);
+    }
 
-        // Scan for end of digits.
-        while( isdigit(*mPos) )
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type Read(T& rValue)
+    {
+        if( !StartValue() )
         {
-            NextChar();
+            return;
+        }
+        if( Peek() != '-' && !IsDigit(Peek()) )
+        {
+            WrongType("a number");
         }
 
-        // The next character should not be alpha.
-        if( isalpha(*mPos) && *mPos != 'e' && *mPos != 'E' )
+        const char* start;
+        size_t length;
+        ScanNumber(start,length);
+
+        // strtod needs the number to be terminated and it may be the last thing in the data, so it is copied first.
+        char text[64];
+        if( length < sizeof(text) )
+        {
+            memcpy(text,start,length);
+            text[length] = 0;
+            rValue = T(strtod(text,nullptr));
+        }
+        else
         {
-            THROW_JSON_EXCEPTION(std::string("Malformed number, embedded characters ") + std::string(mPos-1,20) );
+            rValue = T(strtod(std::string(start,length).c_str(),nullptr));
         }
+    }
 
-        // Do we have a decimal?
-        if( *mPos == '.' )
+    void Read(std::string& rValue)
+    {
+        if( !StartValue() )
+        {
+            return;
+        }
+        if( Peek() != '\"' )
+        {
+            WrongType("a string");
+        }
+
+        const char* start;
+        size_t length;
+        ScanString(start,length);
+        rValue.clear();
+        JsonUnescapeString(rValue,start,length);
+    }
+
+    /**
+     * @brief For the parts of the json that have no fixed layout, the value is checked and then given to JsonProcessor.
+     */
+    void Read(JsonValue& rValue)
+    {
+        SkipWhiteSpace();
+        const char* start = mPos;
+        SkipValue(mDepth);
+        JsonProcessor json;
+        json.SetMaxDepth(mMaxDepth - mDepth);
+        json.Parse(start,size_t(mPos - start));
+        rValue = json.TakeRoot();
+    }
+
+    template<typename T> void Read(std::vector<T>& rValues)
+    {
+        if( !StartValue() )
+        {
+            return;
+        }
+        if( Peek() != '[' )
+        {
+            WrongType("an array");
+        }
+
+        rValues.clear();
+        ReadArray([this,&rValues]()
+        {
+            rValues.emplace_back();
+            Read(rValues.back());
+        });
+    }
+
+    void Read(std::vector<bool>& rValues)
+    {
+        if( !StartValue() )
+        {
+            return;
+        }
+        if( Peek() != '[' )
+        {
+            WrongType("an array");
+        }
+
+        rValues.clear();
+        ReadArray([this,&rValues]()
+        {
+            bool value = false;
+            Read(value);
+            rValues.push_back(value);
+        });
+    }
+
+    template<typename T> void Read(std::map<std::string,T>& rValues)
+    {
+        if( !StartValue() )
+        {
+            return;
+        }
+        if( Peek() != '{' )
+        {
+            WrongType("an object");
+        }
+
+        rValues.clear();
+        ReadObject([this,&rValues](const char* pKey,size_t pLength)
+        {
+            Read(rValues[std::string(pKey,pLength)]);
+        });
+    }
+
+    template<typename T>
+    typename std::enable_if<IsJsonBound<T>::value>::type Read(T& rValue)
+    {
+        if( !StartValue() )
+        {
+            return;
+        }
+        if( Peek() != '{' )
+        {
+            WrongType("an object");
+        }
+
+        // Made the first time this type is read, after that it is shared by all decoders on all threads.
+        static const JsonKeySet keys = [&rValue]()
+        {
+            KeyCollector collector;
+            rValue.JsonBind(collector);
+            return JsonKeySet(std::move(collector.mKeys));
+        }();
+
+        ReadObject([this,&rValue](const char* pKey,size_t pLength)
+        {
+            const int slot = keys.Find(pKey,pLength);
+            if( slot < 0 )
+            {
+                SkipValue(mDepth);
+                return;
+            }
+            FieldReader reader(*this,slot);
+            rValue.JsonBind(reader);
+        });
+    }
+
+    /**
+     * @brief Reads the elements of the array, pOnElement is called to read each one. mPos must be on the '['.
+     */
+    template<typename ON_ELEMENT> void ReadArray(const ON_ELEMENT& pOnElement)
+    {
+        AssertDepth(++mDepth);
+        NextChar();
+        SkipWhiteSpace();
+        if( Peek() == ']' )
         {
             NextChar();
-            // Now scan more more digits.
-            while( isdigit(*mPos) )
+            mDepth--;
+            return;
+        }
+
+        for(;;)
+        {
+            pOnElement();
+            SkipWhiteSpace();
+            if( Peek() != ',' )
             {
-                NextChar();
+                break;
             }
+            NextChar();
         }
-        // now see if there is an exponent. 
-        if( *mPos == 'E' || *mPos == 'e' )
+        AssertCorrectChar(']',"Json format error detected, array not terminated with ']'");
+        NextChar();
+        mDepth--;
+    }
+
+    /**
+     * @brief Reads the key value pairs of the object, pOnKey is called with each key to read its value. mPos must be on the '{'.
+     */
+    template<typename ON_KEY> void ReadObject(const ON_KEY& pOnKey)
+    {
+        AssertDepth(++mDepth);
+        NextChar();
+        SkipWhiteSpace();
+        if( Peek() == '}' )
         {
             NextChar();
-            // Now must be a sign or a number
-            if( *mPos == '-' || *mPos == '+' || std::isdigit(*mPos) )
-            {
-                if( *mPos == '-' || *mPos == '+' )
-                {// Must be followed by a number.
-                    NextChar();
-                    if( isdigit(*mPos) == false )// after accounting the - or + there must be a number next.
-                    {
-                        THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Malformed exponent in number ") + std::string(mPos-1,20) );
-                    }
-                }
+            mDepth--;
+            return;
+        }
 
-                // Now scan more more digits.
-                while( isdigit(*mPos) )
-                {
-                    NextChar();
-                }
+        for(;;)
+        {
+            const char* key;
+            size_t length;
+            ScanString(key,length);
+            if( memchr(key,'\\',length) )
+            {
+                mKey.clear();
+                JsonUnescapeString(mKey,key,length);
+                key = mKey.data();
+                length = mKey.size();
             }
-            else
+
+            SkipWhiteSpace();
+            AssertCorrectChar(':',"Json format error detected, seperator character ':'");
+            NextChar();
+            pOnKey(key,length);
+
+            SkipWhiteSpace();
+            if( Peek() != ',' )
             {
-                THROW_JSON_EXCEPTION(GetErrorPos() + std::string("Malformed exponent in number ") + std::string(mPos-1,20) );
+                break;
             }
+            NextChar();
         }
+        AssertCorrectChar('}',"End of object not found, invalid Json");
+        NextChar();
+        mDepth--;
+    }
+};
 
-        // This is a big win in the reading. I don't convert the type now, it is done when the user needs it.
-        // I've tested string_view. It reduces memory allocations by 40% but complicates the code as I have to insert NULLs into the data.
-        // Reading is so fast, even on low end arm chips, it's a pointless optimisation! Remember, I'm going for clean code.
-        rString.assign(valueStart,mPos-valueStart);
+/**
+ * @brief Writes bound structs and standard containers to a JsonStreamWriter, the other half of JsonDecoder, use JsonEncode rather than this directly.
+ */
+class JsonEncoder
+{
+public:
+    template<typename T>
+    static typename std::enable_if<std::is_arithmetic<T>::value>::type Write(JsonStreamWriter& rWriter,const T& pValue)
+    {
+        rWriter.Value(pValue);
     }
-};//end of struct JsonProcessor
+
+    static void Write(JsonStreamWriter& rWriter,const std::string& pValue)
+    {
+        rWriter.Value(pValue);
+    }
+
+    static void Write(JsonStreamWriter& rWriter,const JsonValue& pValue)
+    {
+        rWriter.Value(pValue);
+    }
+
+    template<typename T> static void Write(JsonStreamWriter& rWriter,const std::vector<T>& pValues)
+    {
+        rWriter.BeginArray();
+        for( typename std::vector<T>::const_reference element : pValues )
+        {
+            Write(rWriter,element);
+        }
+        rWriter.EndArray();
+    }
+
+    template<typename T> static void Write(JsonStreamWriter& rWriter,const std::map<std::string,T>& pValues)
+    {
+        rWriter.BeginObject();
+        for( const auto& entry : pValues )
+        {
+            rWriter.Key(entry.first);
+            Write(rWriter,entry.second);
+        }
+        rWriter.EndObject();
+    }
+
+    template<typename T>
+    static typename std::enable_if<IsJsonBound<T>::value>::type Write(JsonStreamWriter& rWriter,const T& pValue)
+    {
+        rWriter.BeginObject();
+        FieldWriter writer(rWriter);
+        pValue.JsonBind(writer);
+        rWriter.EndObject();
+    }
+
+private:
+    /**
+     * @brief Handed to JsonBind, writes each field with its name as the key.
+     */
+    struct FieldWriter
+    {
+        FieldWriter(JsonStreamWriter& rWriter):mWriter(rWriter){}
+
+        template<size_t NAME_SIZE,typename FIELD> void Field(const char (&pName)[NAME_SIZE],const FIELD& pField)
+        {
+            mWriter.Key(pName,NAME_SIZE - 1);
+            Write(mWriter,pField);
+        }
+
+        JsonStreamWriter& mWriter;
+    };
+};
 
 /**
- * @brief Writes the Json object tree passed in to the file passed. Use pPretty to set if you want tabs and newlines.
+ * @brief Reads the json into rValue, a bound struct, a standard container or a basic type, without making a JsonValue tree. See TINYJSON_BIND.
+ * throws std::runtime_error if the json is not valid or does not fit rValue, rValue may have been partly filled in.
+ */
+template<typename T> void JsonDecode(const std::string& pJsonString,T& rValue)
+{
+    JsonDecoder(pJsonString.data(),pJsonString.size(),true).Decode(rValue);
+}
+
+/**
+ * @brief Reads pLength bytes of json into rValue, pNullTerminated is the same as for JsonProcessor.
  */
-inline void JsonWriter(std::ofstream& pFile,const JsonValue& pRoot,bool pPretty,int pTabCount = 0)
+template<typename T,typename LENGTH_TYPE,typename = typename std::enable_if<std::is_integral<LENGTH_TYPE>::value && !std::is_same<LENGTH_TYPE,bool>::value>::type>
+void JsonDecode(const char* pJsonString,LENGTH_TYPE pLength,T& rValue,bool pNullTerminated = false)
 {
-    const char* quote = "\"";
-    const char* NewLine = pPretty?"\n":"";
-    const std::string OBJ_TAB(4 * (pTabCount+1) * pPretty,' ');
+    JsonDecoder(pJsonString,size_t(pLength),pNullTerminated).Decode(rValue);
+}
+
+/**
+ * @brief Writes pValue, a bound struct, a standard container or a basic type, as json to the writer, which can be part way through writing a document.
+ */
+template<typename T> void JsonEncode(JsonStreamWriter& rWriter,const T& pValue)
+{
+    JsonEncoder::Write(rWriter,pValue);
+}
+
+/**
+ * @brief Returns pValue as json text.
+ */
+template<typename T> std::string JsonEncode(const T& pValue,bool pPretty = false)
+{
+    std::string json;
+    JsonStreamWriter writer(json,pPretty);
+    JsonEncoder::Write(writer,pValue);
+    return json;
+}
+
+/**
+ * @brief Reads newline delimited json, also known as json lines or ndjson, where each line of the data is a json document.
+ * The data is cut into batches of lines on the calling thread, the batches are parsed on a pool of worker threads and
+ * the records are handed back on the calling thread in the same order they are in the data.
+ * Only a few batches are in flight at once so the memory used does not grow with the size of the data.
+ */
+class JsonLinesProcessor
+{
+public:
+    /**
+     * @brief Called once for each record, pLine is the zero based line number in the data that the record was on.
+     */
+    typedef std::function<void(size_t pLine,const JsonValue& pRecord)> RecordCallback;
+
+    /**
+     * @brief Makes the processor and its worker threads, if pNumThreads is zero one is made for each hardware thread.
+     * The threads are kept for the life of the object so it is worth keeping one around if you process a lot of data.
+     */
+    JsonLinesProcessor(size_t pNumThreads = 0,bool pFailOnDuplicateKeys = false) :
+        mFailOnDuplicateKeys(pFailOnDuplicateKeys),
+        mPool(pNumThreads)
+    {
+    }
 
-    const std::string TAB(4 * pTabCount * pPretty,' ');
+    /**
+     * @brief Parses every line in the data, calling pOnRecord for each one in order. Blank lines are skipped and a \r before the \n is allowed.
+     * throws std::runtime_error with the line number if a record is not valid json, the records before it will have been handed back.
+     */
+    void Process(const char* pData,size_t pLength,const RecordCallback& pOnRecord)
+    {
+        ProcessBatches(pData,pLength,[&pOnRecord](size_t pLine,JsonValue& pRecord){pOnRecord(pLine,pRecord);});
+    }
 
-    switch (pRoot.mType)
+    void Process(const std::string& pData,const RecordCallback& pOnRecord)
     {
-    case JsonValueType::STRING:
-        pFile << quote << pRoot.mValue << quote;
-        break;
-    
-    case JsonValueType::NUMBER:
-        pFile << pRoot.mValue;
-        break;
+        Process(pData.data(),pData.size(),pOnRecord);
+    }
+
+    /**
+     * @brief Parses all the records and returns them in order, handy when the data is not too big to hold all of it at once.
+     */
+    std::vector<JsonValue> ProcessAll(const std::string& pData)
+    {
+        std::vector<JsonValue> records;
+        ProcessBatches(pData.data(),pData.size(),[&records](size_t,JsonValue& pRecord){records.push_back(std::move(pRecord));});
+        return records;
+    }
+
+private:
+    /**
+     * @brief A run of whole lines that is parsed by one worker. mLineCount counts every line, blank ones too, so line numbers can be worked out.
+     * If a line fails mError is set and mLineCount is the number of lines before the one that failed.
+     */
+    struct Batch
+    {
+        const char* mStart = nullptr;
+        const char* mEnd = nullptr;
+        size_t mLineCount = 0;
+        std::vector<std::pair<size_t,JsonValue>> mRecords;
+        std::exception_ptr mError;
+        bool mDone = false;
+    };
+
+    static const size_t BATCH_SIZE = 64 * 1024; //!< Roughly how many bytes go in a batch, big enough that the cost of passing it to a thread is lost in the noise.
+
+    const bool mFailOnDuplicateKeys;
+    JsonThreadPool mPool;
+    std::mutex mMutex;
+    std::condition_variable mBatchDone;
+
+    /**
+     * @brief The pipeline behind the Process functions. Batches are cut and queued until maxInFlight are out, then the oldest is waited for and handed back.
+     */
+    template<typename ON_RECORD> void ProcessBatches(const char* pData,size_t pLength,ON_RECORD pOnRecord)
+    {
+        const char* const dataEnd = pData + pLength;
+        const char* nextBatch = pData;
+        const size_t maxInFlight = mPool.GetNumThreads() * 4;
 
-    case JsonValueType::OBJECT:
+        std::deque<std::shared_ptr<Batch>> inFlight;
+        size_t firstLineOfBatch = 0;
+        try
         {
-            const char* StartObj = NewLine;
-            pFile << NewLine << TAB << "{";
-            for(const auto& o : pRoot.mObject )
+            for(;;)
             {
-                pFile << StartObj << OBJ_TAB << quote << o.first << quote << ":";
-                JsonWriter(pFile,o.second,pPretty,pTabCount+1);
-                StartObj = pPretty?",\n":",";
+                // Keep the workers fed.
+                while( nextBatch < dataEnd && inFlight.size() < maxInFlight )
+                {
+                    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+                    batch->mStart = nextBatch;
+                    batch->mEnd = FindBatchEnd(nextBatch,dataEnd);
+                    nextBatch = batch->mEnd;
+
+                    inFlight.push_back(batch);
+                    mPool.Submit([this,batch](){ParseBatch(*batch);});
+                }
+
+                if( inFlight.size() == 0 )
+                {
+                    return;
+                }
+
+                // Hand back the oldest batch, this is what keeps the records in order.
+                WaitForBatch(*inFlight.front());
+                std::shared_ptr<Batch> batch = inFlight.front();
+                inFlight.pop_front();
+
+                for( auto& record : batch->mRecords )
+                {
+                    pOnRecord(firstLineOfBatch + record.first,record.second);
+                }
+
+                if( batch->mError )
+                {
+                    try{std::rethrow_exception(batch->mError);}
+                    catch(const std::exception& e)
+                    {
+                        THROW_JSON_EXCEPTION("Json lines record on line " + std::to_string(firstLineOfBatch + batch->mLineCount + 1) + " failed to parse, " + e.what());
+                    }
+                }
+                firstLineOfBatch += batch->mLineCount;
             }
-            pFile << NewLine << TAB << "}";
         }
-        break;
-
-    case JsonValueType::ARRAY:
+        catch(...)
         {
-            const char* StartObj = NewLine;
-            pFile << NewLine << TAB << "[";
-            for(const auto& o : pRoot.mArray )
+            // The workers still hold pointers into the data, so they have to finish before we let the caller free it.
+            for( const auto& batch : inFlight )
             {
-                pFile << StartObj << OBJ_TAB;
-                JsonWriter(pFile,o,pPretty,pTabCount+1);
-                StartObj = pPretty?",\n":",";
+                WaitForBatch(*batch);
             }
-            pFile << NewLine << TAB << "]";
+            throw;
         }
-        break;
+    }
 
-    case JsonValueType::BOOLEAN:
-        pFile << (pRoot.mBoolean?"true":"false");
-        break;
+    void WaitForBatch(const Batch& pBatch)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mBatchDone.wait(lock,[&pBatch](){return pBatch.mDone;});
+    }
 
-    case JsonValueType::NULL_VALUE:
-    case JsonValueType::INVALID:
-        pFile << "null";
-        break;
+    /**
+     * @brief Finds the end of a batch, which is the first newline after BATCH_SIZE bytes. Json can not have a newline in a string so it is always the end of a record.
+     */
+    static const char* FindBatchEnd(const char* pStart,const char* pEnd)
+    {
+        if( size_t(pEnd - pStart) <= BATCH_SIZE )
+        {
+            return pEnd;
+        }
+
+        const char* newLine = static_cast<const char*>(memchr(pStart + BATCH_SIZE,'\n',pEnd - (pStart + BATCH_SIZE)));
+        return newLine ? newLine + 1 : pEnd;
     }
-}
+
+    void ParseBatch(Batch& rBatch)
+    {
+        try
+        {
+            const char* line = rBatch.mStart;
+            while( line < rBatch.mEnd )
+            {
+                const char* newLine = static_cast<const char*>(memchr(line,'\n',rBatch.mEnd - line));
+                const char* lineEnd = newLine ? newLine : rBatch.mEnd;
+                const char* recordEnd = lineEnd;
+                while( recordEnd > line && (recordEnd[-1] == '\r' || recordEnd[-1] == ' ' || recordEnd[-1] == '\t') )
+                {
+                    recordEnd--;
+                }
+
+                if( recordEnd > line )// Skip blank lines.
+                {
+                    JsonProcessor json(line,recordEnd - line,mFailOnDuplicateKeys);
+                    rBatch.mRecords.emplace_back(rBatch.mLineCount,json.TakeRoot());
+                }
+
+                rBatch.mLineCount++;
+                if( newLine == nullptr )
+                {
+                    break;
+                }
+                line = newLine + 1;
+            }
+        }
+        catch(...)
+        {
+            rBatch.mError = std::current_exception();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            rBatch.mDone = true;
+        }
+        mBatchDone.notify_all();
+    }
+};
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 };// namespace tinyjson
@@ -0,0 +1,513 @@
+#include <iostream>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <atomic>
+#include <new>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include "TinyJson.h"
+
+/**
+ * @brief Benchmarks parse, access, serialize and teardown over the test files and some made up json, to catch a change in speed when the header changes.
+ * Each phase is run a few times to warm up and then timed over many iterations with steady_clock, the results are written as json or csv.
+ * Run from the benchmark folder so the files in ../unit-tests can be found.
+ *     benchmark [--iterations N] [--warmup N] [--format json|csv] [--corpus NAME] [--output FILE]
+ */
+
+/**
+ * @brief Every allocation made by the program is counted, so the allocations of a phase are the change in the count across it.
+ * Not inlined so the compiler does not see the malloc and free inside and warn they do not match the new and delete they are called by.
+ */
+static std::atomic<uint64_t> AllocationCount(0);
+
+#ifdef __GNUC__
+    #define BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+    #define BENCHMARK_NOINLINE
+#endif
+
+BENCHMARK_NOINLINE void* operator new(size_t pSize)
+{
+    AllocationCount++;
+    void* memory = malloc(pSize ? pSize : 1);
+    if( memory == nullptr )
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+BENCHMARK_NOINLINE void operator delete(void* pMemory)noexcept
+{
+    free(pMemory);
+}
+
+BENCHMARK_NOINLINE void operator delete(void* pMemory,size_t)noexcept
+{
+    free(pMemory);
+}
+
+/**
+ * @brief The json to run the phases over, either a file or made up here. The many small messages corpus has lots of documents, the rest have one.
+ */
+struct Corpus
+{
+    std::string mName;
+    std::vector<std::string> mDocuments;
+
+    size_t GetBytes()const
+    {
+        size_t bytes = 0;
+        for( const auto& document : mDocuments )
+        {
+            bytes += document.size();
+        }
+        return bytes;
+    }
+};
+
+/**
+ * @brief The timings of one phase over one corpus.
+ */
+struct Result
+{
+    std::string mCorpus;
+    std::string mPhase;
+    size_t mBytes;
+    size_t mDocuments;
+    double mBestMS;
+    double mMedianMS;
+    double mMBPerSecond;            //!< From the median time.
+    double mAllocationsPerIteration;
+    long mPeakRSSKB;                //!< Of the whole process so far, so it only goes up.
+};
+
+static std::string LoadFileIntoString(const std::string& pFilename)
+{
+    std::ifstream jsonFile(pFilename);
+    if( jsonFile.is_open() )
+    {
+        std::stringstream jsonStream;
+        jsonStream << jsonFile.rdbuf();// Read the whole file in...
+        return jsonStream.str();
+    }
+    throw std::runtime_error("Json file not found " + pFilename);
+}
+
+static long GetPeakRSSKB()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF,&usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief A small random number generator with a fixed seed, so the made up json is the same every run and on every machine.
+ */
+struct Random
+{
+    uint32_t mState = 12345;
+    uint32_t Next(uint32_t pRange)
+    {
+        mState = mState * 1664525u + 1013904223u;
+        return (mState >> 8) % pRange;
+    }
+};
+
+/**
+ * @brief Lots of strings of different lengths, some with escapes and unicode in them.
+ */
+static Corpus MakeStringCorpus()
+{
+    static const char* const WORDS[] = {"alpha","bravo","charlie","delta","echo","fox\\ttrot","golf","hotel","india \\\"juliet\\\"","kilo","lima\\n","mike","caf\\u00e9","na\\u00efve"};
+    Random random;
+    std::string json = "[";
+    for( int n = 0 ; n < 40000 ; n++ )
+    {
+        json += n ? ",\"" : "\"";
+        for( uint32_t word = random.Next(12) + 1 ; word > 0 ; word-- )
+        {
+            json += WORDS[random.Next(14)];
+            json += ' ';
+        }
+        json += '\"';
+    }
+    json += "]";
+    return {"strings",{json}};
+}
+
+/**
+ * @brief Rows of numbers, whole, fractional and with exponents.
+ */
+static Corpus MakeNumberCorpus()
+{
+    Random random;
+    std::string json = "[";
+    for( int row = 0 ; row < 20000 ; row++ )
+    {
+        json += row ? ",[" : "[";
+        for( int n = 0 ; n < 10 ; n++ )
+        {
+            if( n ){json += ',';}
+            switch( n % 3 )
+            {
+            case 0: json += std::to_string(int32_t(random.Next(2000000)) - 1000000); break;
+            case 1: json += std::to_string(random.Next(100000)) + "." + std::to_string(random.Next(1000000)); break;
+            default: json += std::to_string(random.Next(1000)) + "." + std::to_string(random.Next(1000)) + "e-" + std::to_string(random.Next(30)); break;
+            }
+        }
+        json += "]";
+    }
+    json += "]";
+    return {"numbers",{json}};
+}
+
+/**
+ * @brief Objects and arrays nested hundreds deep, within the default depth limit of the parser.
+ */
+static Corpus MakeNestedCorpus()
+{
+    std::string json = "[";
+    for( int tree = 0 ; tree < 200 ; tree++ )
+    {
+        json += tree ? "," : "";
+        const int depth = 500;
+        for( int n = 0 ; n < depth ; n++ )
+        {
+            json += (n & 1) ? "[" : "{\"level\":" + std::to_string(n) + ",\"next\":";
+        }
+        json += "null";
+        for( int n = depth - 1 ; n >= 0 ; n-- )
+        {
+            json += (n & 1) ? "]" : "}";
+        }
+    }
+    json += "]";
+    return {"nested",{json}};
+}
+
+/**
+ * @brief Many small messages, like the requests a server gets, each parsed on its own.
+ */
+static Corpus MakeMessageCorpus()
+{
+    Random random;
+    Corpus corpus = {"messages",{}};
+    for( int n = 0 ; n < 20000 ; n++ )
+    {
+        corpus.mDocuments.push_back(
+            "{\"id\":" + std::to_string(n) +
+            ",\"user\":\"user" + std::to_string(random.Next(1000)) +
+            "\",\"action\":\"" + (random.Next(2) ? "buy" : "sell") +
+            "\",\"price\":" + std::to_string(random.Next(10000)) + "." + std::to_string(random.Next(100)) +
+            ",\"tags\":[\"a\",\"b\"],\"ok\":true}");
+    }
+    return corpus;
+}
+
+/**
+ * @brief Reads every value in the tree, as a user of it would. Done with a list so deep trees do not recurse.
+ */
+static double AccessTree(const tinyjson::JsonValue& pRoot,std::vector<const tinyjson::JsonValue*>& rPending)
+{
+    double sum = 0;
+    rPending.clear();
+    rPending.push_back(&pRoot);
+    while( rPending.size() > 0 )
+    {
+        const tinyjson::JsonValue& value = *rPending.back();
+        rPending.pop_back();
+        switch( value.GetType() )
+        {
+        case tinyjson::JsonValueType::NUMBER:
+            sum += value.GetDouble();
+            break;
+
+        case tinyjson::JsonValueType::STRING:
+            sum += double(value.GetString().size());
+            break;
+
+        case tinyjson::JsonValueType::BOOLEAN:
+            sum += value.GetBoolean();
+            break;
+
+        default:
+            break;
+        }
+
+        for( const auto& element : value.mArray )
+        {
+            rPending.push_back(&element);
+        }
+        for( const auto& entry : value.mObject )
+        {
+            sum += double(entry.first.size());
+            rPending.push_back(&entry.second);
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief Runs pPhase pWarmup times and then pIterations times timing each one.
+ * pPhase returns the time of the part that is to be measured and sets the count of allocations in that part, if it is given somewhere to put it.
+ */
+template<typename PHASE>
+static Result Measure(const Corpus& pCorpus,const char* pPhaseName,size_t pWarmup,size_t pIterations,const PHASE& pPhase)
+{
+    for( size_t n = 0 ; n < pWarmup ; n++ )
+    {
+        pPhase(nullptr);
+    }
+
+    std::vector<double> times;
+    uint64_t allocations = 0;
+    for( size_t n = 0 ; n < pIterations ; n++ )
+    {
+        uint64_t allocationsInPhase = 0;
+        times.push_back(pPhase(&allocationsInPhase));
+        allocations += allocationsInPhase;
+    }
+    std::sort(times.begin(),times.end());
+
+    Result result;
+    result.mCorpus = pCorpus.mName;
+    result.mPhase = pPhaseName;
+    result.mBytes = pCorpus.GetBytes();
+    result.mDocuments = pCorpus.mDocuments.size();
+    result.mBestMS = times.front();
+    result.mMedianMS = times[times.size() / 2];
+    result.mMBPerSecond = result.mMedianMS > 0 ? (double(result.mBytes) / (1024.0 * 1024.0)) / (result.mMedianMS / 1000.0) : 0;
+    result.mAllocationsPerIteration = double(allocations) / double(pIterations);
+    result.mPeakRSSKB = GetPeakRSSKB();
+    return result;
+}
+
+/**
+ * @brief Times the code between the start and stop of a phase, and counts its allocations.
+ */
+struct PhaseTimer
+{
+    PhaseTimer(uint64_t* pAllocations):mAllocations(pAllocations){}
+
+    void Start()
+    {
+        mAllocationStart = AllocationCount;
+        mStart = std::chrono::steady_clock::now();
+    }
+
+    double Stop()
+    {
+        const auto end = std::chrono::steady_clock::now();
+        if( mAllocations )
+        {
+            *mAllocations = AllocationCount - mAllocationStart;
+        }
+        return std::chrono::duration<double,std::milli>(end - mStart).count();
+    }
+
+    uint64_t* mAllocations;
+    uint64_t mAllocationStart = 0;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+/**
+ * @brief The four phases over one corpus.
+ * parse       A processor that is kept between iterations parses each document, so after the warmup its memory is used again.
+ * access      Every value of every parsed document is read.
+ * serialize   Every parsed document is written back out to a string that is kept between iterations.
+ * teardown    Each document is parsed by its own processor and the trees taken out, the time is that of freeing them.
+ */
+static void RunCorpus(const Corpus& pCorpus,size_t pWarmup,size_t pIterations,std::vector<Result>& rResults)
+{
+    tinyjson::JsonProcessor processor;
+    rResults.push_back(Measure(pCorpus,"parse",pWarmup,pIterations,[&](uint64_t* pAllocations)
+    {
+        PhaseTimer timer(pAllocations);
+        timer.Start();
+        for( const auto& document : pCorpus.mDocuments )
+        {
+            processor.Parse(document);
+        }
+        return timer.Stop();
+    }));
+#ifdef TINYJSON_PROFILE
+    std::cerr << "Parse profile of " << pCorpus.mName << "\n" << processor.GetProfile().GetReport();
+#endif
+
+    std::vector<tinyjson::JsonValue> trees;
+    for( const auto& document : pCorpus.mDocuments )
+    {
+        trees.push_back(tinyjson::JsonProcessor(document).TakeRoot());
+    }
+
+    std::vector<const tinyjson::JsonValue*> pending;
+    volatile double sink = 0;
+    rResults.push_back(Measure(pCorpus,"access",pWarmup,pIterations,[&](uint64_t* pAllocations)
+    {
+        PhaseTimer timer(pAllocations);
+        timer.Start();
+        double sum = 0;
+        for( const auto& tree : trees )
+        {
+            sum += AccessTree(tree,pending);
+        }
+        const double time = timer.Stop();
+        sink = sink + sum;
+        return time;
+    }));
+
+    std::string output;
+    rResults.push_back(Measure(pCorpus,"serialize",pWarmup,pIterations,[&](uint64_t* pAllocations)
+    {
+        PhaseTimer timer(pAllocations);
+        timer.Start();
+        for( const auto& tree : trees )
+        {
+            output.clear();
+            tinyjson::JsonStreamWriter writer(output);
+            writer.Value(tree);
+        }
+        return timer.Stop();
+    }));
+    trees.clear();
+
+    rResults.push_back(Measure(pCorpus,"teardown",pWarmup,pIterations,[&](uint64_t* pAllocations)
+    {
+        std::vector<tinyjson::JsonValue> toFree;
+        toFree.reserve(pCorpus.mDocuments.size());
+        for( const auto& document : pCorpus.mDocuments )
+        {
+            toFree.push_back(tinyjson::JsonProcessor(document).TakeRoot());
+        }
+
+        PhaseTimer timer(pAllocations);
+        timer.Start();
+        toFree.clear();
+        return timer.Stop();
+    }));
+}
+
+static void WriteJson(std::ostream& rStream,const std::vector<Result>& pResults,size_t pWarmup,size_t pIterations)
+{
+    tinyjson::JsonStreamWriter writer(rStream,true);
+    writer.BeginObject();
+    writer.Member("warmup",pWarmup);
+    writer.Member("iterations",pIterations);
+    writer.Key("results").BeginArray();
+    for( const auto& result : pResults )
+    {
+        writer.BeginObject();
+        writer.Member("corpus",result.mCorpus);
+        writer.Member("phase",result.mPhase);
+        writer.Member("bytes",result.mBytes);
+        writer.Member("documents",result.mDocuments);
+        writer.Member("best_ms",result.mBestMS);
+        writer.Member("median_ms",result.mMedianMS);
+        writer.Member("mb_per_second",result.mMBPerSecond);
+        writer.Member("allocations_per_iteration",result.mAllocationsPerIteration);
+        writer.Member("peak_rss_kb",int64_t(result.mPeakRSSKB));
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    writer.Flush();
+    rStream << "\n";
+}
+
+static void WriteCSV(std::ostream& rStream,const std::vector<Result>& pResults)
+{
+    rStream << "corpus,phase,bytes,documents,best_ms,median_ms,mb_per_second,allocations_per_iteration,peak_rss_kb\n";
+    for( const auto& result : pResults )
+    {
+        rStream << result.mCorpus << ',' << result.mPhase << ',' << result.mBytes << ',' << result.mDocuments << ','
+                << result.mBestMS << ',' << result.mMedianMS << ',' << result.mMBPerSecond << ','
+                << result.mAllocationsPerIteration << ',' << result.mPeakRSSKB << '\n';
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t iterations = 20;
+    size_t warmup = 3;
+    std::string format = "json";
+    std::string onlyCorpus;
+    std::string outputFile;
+
+    for( int n = 1 ; n < argc ; n++ )
+    {
+        const std::string arg = argv[n];
+        const bool hasValue = n + 1 < argc;
+        if( arg == "--iterations" && hasValue )     {iterations = std::max(1,atoi(argv[++n]));}
+        else if( arg == "--warmup" && hasValue )    {warmup = size_t(std::max(0,atoi(argv[++n])));}
+        else if( arg == "--format" && hasValue )    {format = argv[++n];}
+        else if( arg == "--corpus" && hasValue )    {onlyCorpus = argv[++n];}
+        else if( arg == "--output" && hasValue )    {outputFile = argv[++n];}
+        else
+        {
+            std::cerr << "Usage: benchmark [--iterations N] [--warmup N] [--format json|csv] [--corpus NAME] [--output FILE]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    if( format != "json" && format != "csv" )
+    {
+        std::cerr << "Unknown format " << format << ", use json or csv\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        std::vector<Corpus> corpora;
+        for( const char* file : {"canada","weather","sample"} )
+        {
+            corpora.push_back({file,{LoadFileIntoString(std::string("../unit-tests/") + file + ".json")}});
+        }
+        corpora.push_back(MakeStringCorpus());
+        corpora.push_back(MakeNumberCorpus());
+        corpora.push_back(MakeNestedCorpus());
+        corpora.push_back(MakeMessageCorpus());
+
+        std::vector<Result> results;
+        for( const auto& corpus : corpora )
+        {
+            if( onlyCorpus.empty() || onlyCorpus == corpus.mName )
+            {
+                std::cerr << "Running " << corpus.mName << "\n";
+                RunCorpus(corpus,warmup,iterations,results);
+            }
+        }
+
+        std::ofstream file;
+        if( outputFile.size() > 0 )
+        {
+            file.open(outputFile);
+            if( !file.is_open() )
+            {
+                std::cerr << "Could not open " << outputFile << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+        std::ostream& output = outputFile.size() > 0 ? file : std::cout;
+
+        if( format == "json" )
+        {
+            WriteJson(output,results,warmup,iterations);
+        }
+        else
+        {
+            WriteCSV(output,results);
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << "Benchmark failed, " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,10 +1,15 @@
 
 #include <iostream>
 #include <chrono>
+#include <unordered_set>
 #include <sstream>
 #include <fstream>
+#include <thread>
+#include <list>
+#include <atomic>
 
 #include <assert.h>
+#include <string.h>
 #include "TinyJson.h"
 
 std::string LoadFileIntoString(const std::string& pFilename)
@@ -88,6 +93,92 @@ static bool TestBasicFormats()
     return true;
 }
 
+/**
+ * @brief Checks that json can be parsed directly from memory that is not null terminated, like a slice of a network buffer.
+ * The bytes after the given length are deliberately things that would change the result if they were read.
+ */
+static bool TestParsingFromMemorySlice()
+{
+    std::cout << "Testing parsing from a slice of memory\n";
+
+    try
+    {
+        {
+            const char buffer[] = "[1,2,3]]]]";
+            tinyjson::JsonProcessor json(buffer,7);
+            if( json.GetRoot().GetArraySize() != 3 )
+            {
+                return false;
+            }
+        }
+
+        {
+            const char buffer[] = "1234";
+            tinyjson::JsonProcessor json(buffer,2);
+            if( json.GetRoot().GetInt() != 12 )
+            {
+                return false;
+            }
+        }
+
+        {
+            const std::string buffer = "{\"a\":\"text\"}{\"b\":12}";
+            tinyjson::JsonProcessor json(buffer.data() + 12,8);
+            if( json.GetRoot()["b"].GetInt() != 12 )
+            {
+                return false;
+            }
+        }
+
+        {
+            // A record in a buffer that has a zero written after it, tells the parser it can use it to stop the scanning loops.
+            char buffer[64] = "{\"id\":42,\"name\":\"fred\"}\n{\"id\":43}";
+            const size_t recordLength = strchr(buffer,'\n') - buffer;
+            buffer[recordLength] = 0;
+            tinyjson::JsonProcessor json(buffer,recordLength,false,true);
+            if( json.GetRoot()["id"].GetInt() != 42 || json.GetRoot()["name"].GetString() != "fred" )
+            {
+                return false;
+            }
+        }
+
+#if __cplusplus >= 201703L
+        {
+            const std::string_view view("{\"Hello\":\"World\"} trailing data",17);
+            tinyjson::JsonProcessor json(view);
+            if( json.GetRoot()["Hello"].GetString() != "World" )
+            {
+                return false;
+            }
+        }
+#endif
+    }
+    catch( std::runtime_error &e )
+    {
+        std::cerr << "Testing parsing from a slice of memory failed: " << e.what() << "\n";
+        return false;
+    }
+
+    // A slice that cuts a value in half must fail, not read on into the rest of the buffer.
+    const char* truncated[] = {"[\"abc\"]","{\"a\":true}","[123,456]"};
+    const size_t lengths[] = {4,9,7};
+    for( int n = 0 ; n < 3 ; n++ )
+    {
+        try
+        {
+            tinyjson::JsonProcessor json(truncated[n],lengths[n]);
+            std::cout << "A truncated slice that should have failed passed! " << truncated[n] << "\n";
+            return false;
+        }
+        catch( std::runtime_error &e )
+        {
+            std::cerr << "Truncated slice error trapped correctly, " << e.what() << '\n';
+        }
+    }
+
+    return true;
+}
+
 /**
  * @brief test root types
  */
@@ -670,6 +761,2119 @@ static bool TestForDuplicateKeyDiscovery()
     return true;
 }
 
+/**
+ * @brief Checks the json lines reader hands back every record, in order, with the right line numbers.
+ */
+static bool TestJsonLines()
+{
+    std::cout << "Testing json lines reader\n";
+
+    // Big enough to be cut into many batches, with blank lines and windows line endings mixed in.
+    std::string jsonLines;
+    for( int n = 0 ; n < 20000 ; n++ )
+    {
+        jsonLines += "{\"n\":" + std::to_string(n) + ",\"name\":\"record " + std::to_string(n) + "\",\"list\":[1,2,3]}";
+        jsonLines += (n % 3) ? "\n" : "\r\n\n";
+    }
+
+    tinyjson::JsonLinesProcessor reader(4);
+    int expected = 0;
+    size_t lastLine = 0;
+    reader.Process(jsonLines,[&expected,&lastLine](size_t pLine,const tinyjson::JsonValue& pRecord)
+    {
+        if( pRecord["n"].GetInt() != expected || (expected > 0 && pLine <= lastLine) )
+        {
+            throw std::runtime_error("Json lines record out of order " + std::to_string(expected));
+        }
+        expected++;
+        lastLine = pLine;
+    });
+
+    if( expected != 20000 || lastLine != 26666 )
+    {
+        std::cout << "Json lines reader did not return all the records " << expected << " " << lastLine << "\n";
+        return false;
+    }
+
+    // An error must report the line it was on.
+    try
+    {
+        reader.ProcessAll("{\"a\":1}\n\n{\"a\":2}\n{\"a\":}\n{\"a\":4}\n");
+        std::cout << "Json lines with a bad record passed!\n";
+        return false;
+    }
+    catch( std::runtime_error &e )
+    {
+        std::cerr << "Json lines error trapped correctly, " << e.what() << '\n';
+        if( std::string(e.what()).find("line 4 ") == std::string::npos )
+        {
+            return false;
+        }
+    }
+
+    return reader.ProcessAll("[1,2]\n[3]\n").size() == 2;
+}
+
+/**
+ * @brief Walks two trees checking they hold the same values.
+ */
+static bool IsSameJson(const tinyjson::JsonValue& pA,const tinyjson::JsonValue& pB)
+{
+    if( pA.GetType() != pB.GetType() || pA.mValue != pB.mValue || pA.mBoolean != pB.mBoolean ||
+        pA.mArray.size() != pB.mArray.size() || pA.mObject.size() != pB.mObject.size() )
+    {
+        return false;
+    }
+
+    for( size_t n = 0 ; n < pA.mArray.size() ; n++ )
+    {
+        if( !IsSameJson(pA.mArray[n],pB.mArray[n]) )
+        {
+            return false;
+        }
+    }
+
+    for( auto a = pA.mObject.begin(), b = pB.mObject.begin() ; a != pA.mObject.end() ; ++a, ++b )
+    {
+        if( a->first != b->first || !IsSameJson(a->second,b->second) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parses the json and returns its tree.
+ */
+static tinyjson::JsonValue ParseJson(const std::string& pJson)
+{
+    return tinyjson::JsonProcessor(pJson).TakeRoot();
+}
+
+/**
+ * @brief Writes the tree as compact json, with the keys in the order they are held.
+ */
+static std::string ToJson(const tinyjson::JsonValue& pValue)
+{
+    std::string json;
+    tinyjson::JsonStreamWriter writer(json);
+    writer.Value(pValue);
+    return json;
+}
+
+/**
+ * @brief Builds a tree with the builder functions and checks it matches the same json parsed.
+ */
+static bool TestBuildingJson()
+{
+    std::cout << "Testing building json\n";
+
+    std::vector<std::string> tags = {"red","green"};
+    std::map<std::string,std::vector<int>> scores = {{"fred",{1,2,3}},{"jim",{}}};
+    const int ids[] = {7,8,9};
+
+    tinyjson::JsonValue root;
+    root.Emplace("name","A \\\"quoted\\\" name");
+    root.Emplace("count",42);
+    root.Emplace("enabled",true);
+    root.Emplace("tags",std::move(tags));
+    root.Emplace("scores",scores);
+    root.Emplace("ids",ids);
+    root.Emplace("range",std::list<int>{4,5});
+    root.Emplace("pairs",std::vector<std::pair<std::string,std::string>>{{"k","v"}});
+    root.Emplace("count",1000); // Already there, must not change.
+
+    tinyjson::JsonValue& people = root.Emplace("people");
+    people.Reserve(3);
+    for( int n = 0 ; n < 3 ; n++ )
+    {
+        tinyjson::JsonValue& person = people.EmplaceBack();
+        person.Emplace("id",n);
+        person.Emplace("nothing",tinyjson::JsonValueType::NULL_VALUE);
+    }
+
+    const std::string expected =
+        "{\"name\":\"A \\\"quoted\\\" name\",\"count\":42,\"enabled\":true,\"tags\":[\"red\",\"green\"],"
+        "\"scores\":{\"fred\":[1,2,3],\"jim\":[]},\"ids\":[7,8,9],\"range\":[4,5],\"pairs\":{\"k\":\"v\"},"
+        "\"people\":[{\"id\":0,\"nothing\":null},{\"id\":1,\"nothing\":null},{\"id\":2,\"nothing\":null}]}";
+    tinyjson::JsonProcessor json(expected);
+    if( !IsSameJson(root,json.GetRoot()) || people.mArray.capacity() != 3 )
+    {
+        std::cout << "Built json does not match\n";
+        return false;
+    }
+
+    try
+    {
+        people.Emplace("key","An array can not have a key");
+        std::cout << "Emplace with a key into an array did not throw\n";
+        return false;
+    }
+    catch( std::runtime_error &e ){}
+
+    return true;
+}
+
+/**
+ * @brief Writes json with the stream writer and JsonWriter and checks it parses back to the same values.
+ */
+static bool TestStreamWriter()
+{
+    std::cout << "Testing stream writer\n";
+
+    std::string text;
+    {
+        tinyjson::JsonStreamWriter writer(text);
+        writer.BeginObject();
+            writer.Key("escaped \"key\"").Value("tab\there\nquote\" slash\\ control\x01 utf8 \xc3\xa9");
+            writer.Member("int",-42).Member("min",INT64_MIN).Member("max",UINT64_MAX);
+            writer.Member("double",0.1).Member("float",0.1f).Member("big",1e300).Member("third",1.0/3.0).Member("sum",0.1+0.7);
+            writer.Member("smallest",5e-324).Member("subnormal",1e-310).Member("negative zero",-0.0).Member("exponent",1e-5).Member("long",123456789012345678.0);
+            writer.Key("flags").BeginArray().Value(true).Value(false).Null().EndArray();
+            writer.Key("empty").BeginObject().EndObject();
+            writer.Key("none").BeginArray().EndArray();
+        writer.EndObject();
+        if( !writer.IsComplete() )
+        {
+            std::cout << "Stream writer did not see the end of the root\n";
+            return false;
+        }
+    }
+
+    tinyjson::JsonProcessor json(text);
+    const tinyjson::JsonValue& root = json.GetRoot();
+    if( root["escaped \\\"key\\\""].GetString() != "tab\\there\\nquote\\\" slash\\\\ control\\u0001 utf8 \xc3\xa9" ||
+        root["int"].GetInt() != -42 || root["min"].GetInt64() != INT64_MIN || root["max"].GetUInt64() != UINT64_MAX ||
+        root["double"].mValue != "0.1" || root["float"].mValue != "0.1" || root["big"].GetDouble() != 1e300 || root["third"].GetDouble() != 1.0/3.0 || root["sum"].mValue != "0.7999999999999999" ||
+        root["smallest"].mValue != "5e-324" || root["subnormal"].mValue != "1e-310" || root["negative zero"].mValue != "-0" ||
+        root["exponent"].mValue != "1e-05" || root["long"].mValue != "1.2345678901234568e+17" ||
+        root["flags"][0].GetBoolean() != true || root["flags"][2].GetType() != tinyjson::JsonValueType::NULL_VALUE ||
+        root["empty"].GetType() != tinyjson::JsonValueType::OBJECT || root["none"].GetArraySize() != 0 )
+    {
+        std::cout << "Stream writer output did not read back the same, " << text << "\n";
+        return false;
+    }
+
+    // Writing to a stream is done in blocks, the result must be the same as writing to a string.
+    std::string expected;
+    std::ostringstream stream;
+    {
+        tinyjson::JsonStreamWriter toString(expected,true);
+        tinyjson::JsonStreamWriter toStream(stream,true);
+        toString.BeginArray();
+        toStream.BeginArray();
+        for( int n = 0 ; n < 50000 ; n++ )
+        {
+            toString.BeginObject().Member("id",n).Member("name","record " + std::to_string(n)).EndObject();
+            toStream.BeginObject().Member("id",n).Member("name","record " + std::to_string(n)).EndObject();
+        }
+        toString.EndArray();
+        toStream.EndArray();
+    }
+    if( stream.str() != expected || tinyjson::JsonProcessor(expected).GetRoot()[49999]["id"].GetInt() != 49999 )
+    {
+        std::cout << "Stream writer wrote different json to a stream\n";
+        return false;
+    }
+
+    // JsonWriter, compact and pretty, must give back the tree it was given.
+    const tinyjson::JsonProcessor canada(LoadFileIntoString("canada.json"));
+    for( bool pretty : {false,true} )
+    {
+        std::ostringstream written;
+        tinyjson::JsonWriter(written,canada.GetRoot(),pretty);
+        if( !IsSameJson(tinyjson::JsonProcessor(written.str()).GetRoot(),canada.GetRoot()) )
+        {
+            std::cout << "JsonWriter did not write the same json back out\n";
+            return false;
+        }
+    }
+
+    // JsonWriter keeps its own pretty layout, each array and object on a new line and empty ones closed on the next line.
+    std::ostringstream layout;
+    tinyjson::JsonWriter(layout,ParseJson("{\"a\":[1,{}],\"b\":[]}"),true);
+    if( layout.str() != "\n{\n    \"a\":\n    [\n        1,\n        \n        {\n        }\n    ],\n    \"b\":\n    [\n    ]\n}" )
+    {
+        std::cout << "JsonWriter pretty layout changed, " << layout.str() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Parts of weather.json bound to structs, for TestStructBinding.
+ */
+struct WeatherInfo
+{
+    int id = 0;
+    std::string main;
+    std::string description;
+    std::string icon;
+
+    TINYJSON_BIND(
+        TINYJSON_FIELD(id)
+        TINYJSON_FIELD(main)
+        TINYJSON_FIELD(description)
+        TINYJSON_FIELD(icon))
+};
+
+struct WeatherCurrent
+{
+    int64_t dt = 0;
+    double temp = 0;
+    double feelsLike = 0;
+    uint32_t pressure = 0;
+    int humidity = 0;
+    std::vector<WeatherInfo> weather;
+
+    TINYJSON_BIND(
+        TINYJSON_FIELD(dt)
+        TINYJSON_FIELD(temp)
+        TINYJSON_FIELD_NAMED("feels_like",feelsLike)
+        TINYJSON_FIELD(pressure)
+        TINYJSON_FIELD(humidity)
+        TINYJSON_FIELD(weather))
+};
+
+struct WeatherDaily
+{
+    int64_t dt = 0;
+    std::map<std::string,float> temp;
+    tinyjson::JsonValue feelsLike;
+
+    TINYJSON_BIND(
+        TINYJSON_FIELD(dt)
+        TINYJSON_FIELD(temp)
+        TINYJSON_FIELD_NAMED("feels_like",feelsLike))
+};
+
+struct WeatherReport
+{
+    double lat = 0;
+    double lon = 0;
+    std::string timezone;
+    WeatherCurrent current;
+    std::vector<WeatherDaily> daily;
+    std::vector<bool> flags;
+    std::string unused = "not in the json";
+
+    TINYJSON_BIND(
+        TINYJSON_FIELD(lat)
+        TINYJSON_FIELD(lon)
+        TINYJSON_FIELD(timezone)
+        TINYJSON_FIELD(current)
+        TINYJSON_FIELD(daily)
+        TINYJSON_FIELD(flags))
+};
+
+/**
+ * @brief Decodes weather.json into structs and checks them against the parsed tree, then encodes them and decodes them again.
+ */
+static bool TestStructBinding()
+{
+    std::cout << "Testing struct binding\n";
+
+    const std::string jsonString = LoadFileIntoString("weather.json");
+    const tinyjson::JsonProcessor json(jsonString);
+    const tinyjson::JsonValue& root = json.GetRoot();
+
+    WeatherReport report;
+    auto decodeStart = std::chrono::steady_clock::now();
+    tinyjson::JsonDecode(jsonString,report);
+    auto decodeEnd = std::chrono::steady_clock::now();
+    std::cout << "Decoded weather.json in " << std::chrono::duration<float,std::micro>(decodeEnd - decodeStart).count() << "us\n";
+
+    const tinyjson::JsonValue& daily = root["daily"];
+    if( report.lat != root["lat"].GetDouble() || report.timezone != "Europe/London" || report.unused != "not in the json" ||
+        report.current.dt != root["current"]["dt"].GetInt64() || report.current.feelsLike != root["current"]["feels_like"].GetDouble() ||
+        report.current.pressure != 1002 || report.current.weather.size() != 1 || report.current.weather[0].description != "overcast clouds" ||
+        report.daily.size() != daily.GetArraySize() || report.daily[7].dt != daily[7]["dt"].GetInt64() ||
+        report.daily[7].temp["max"] != daily[7]["temp"]["max"].GetFloat() || !IsSameJson(report.daily[7].feelsLike,daily[7]["feels_like"]) )
+    {
+        std::cout << "Decoded struct does not match the json\n";
+        return false;
+    }
+
+    // Round trip, with strings that need escaping.
+    report.timezone = "Europe/\"London\"\n\t\xc3\xa9";
+    report.flags = {true,false};
+    WeatherReport decoded;
+    tinyjson::JsonDecode(tinyjson::JsonEncode(report,true),decoded);
+    if( tinyjson::JsonEncode(decoded) != tinyjson::JsonEncode(report) || decoded.timezone != report.timezone || decoded.flags.size() != 2 )
+    {
+        std::cout << "Encoded struct did not decode back the same\n";
+        return false;
+    }
+
+    // Escaped text decodes to the characters.
+    std::vector<std::string> strings;
+    tinyjson::JsonDecode("[\"a\\u00e9\\ud83d\\ude00\\\\\\\"\\/\",null,\"\"]",strings);
+    if( strings.size() != 3 || strings[0] != "a\xc3\xa9\xf0\x9f\x98\x80\\\"/" || strings[1] != "" )
+    {
+        std::cout << "Strings did not unescape\n";
+        return false;
+    }
+
+    const std::vector<std::string> badJson =
+    {
+        "{\"current\":{\"humidity\":\"95\"}}",      // String for a number.
+        "{\"current\":{\"humidity\":95.5}}",        // Not a whole number.
+        "{\"current\":{\"pressure\":-1}}",          // Negative for an unsigned.
+        "{\"current\":{\"dt\":99999999999999999999}}",// Too big.
+        "{\"lat\":[1]}",                            // Array for a number.
+        "{\"daily\":{}}",                           // Object for an array.
+        "{\"timezone\":\"x\",}",                    // Broken json.
+        "{\"skipped\":[1,{\"a\":tru}],\"lat\":1}",  // Broken json in a key that is skipped.
+        "{\"lat\":1} 2"                             // Data after the root.
+    };
+    for( const auto& bad : badJson )
+    {
+        try
+        {
+            WeatherReport result;
+            tinyjson::JsonDecode(bad,result);
+            std::cout << "Bad json decoded without an error " << bad << "\n";
+            return false;
+        }
+        catch( std::runtime_error &e )
+        {
+            std::cerr << "Decode error trapped correctly, " << e.what() << '\n';
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks every key in a key set finds its slot and keys that are not in it, some very like the ones that are, do not.
+ */
+static bool TestKeySet()
+{
+    std::cout << "Testing key sets\n";
+
+    // These only differ in the middle, so the set has to fall back to hashing all of the key.
+    const tinyjson::JsonKeySet similar = {"temp_min_a","temp_max_a","temp_mid_a",""};
+    // And a bigger set of real keys.
+    const tinyjson::JsonKeySet weather = {"dt","sunrise","sunset","temp","feels_like","pressure","humidity","dew_point","uvi","clouds",
+                                          "visibility","wind_speed","wind_deg","weather","id","main","description","icon","pop","rain"};
+
+    for( const tinyjson::JsonKeySet* keys : {&similar,&weather} )
+    {
+        const tinyjson::JsonKeySet copy = *keys;
+        for( size_t n = 0 ; n < keys->GetSize() ; n++ )
+        {
+            if( keys->Find(keys->GetKey(n)) != int(n) || copy.Find(keys->GetKey(n)) != int(n) )
+            {
+                std::cout << "Key set did not find " << keys->GetKey(n) << "\n";
+                return false;
+            }
+        }
+    }
+
+    for( const char* unknown : {"temp_max_b","temp_mix_a","tamp","Temp","temps","d","weathers","x"} )
+    {
+        if( similar.Find(unknown) != -1 || weather.Find(unknown) != -1 )
+        {
+            std::cout << "Key set found a key that is not in it, " << unknown << "\n";
+            return false;
+        }
+    }
+
+    // Too many keys for a perfect hash, the set must still be made and find them all.
+    std::vector<std::string> manyKeys;
+    for( int n = 0 ; n < 5000 ; n++ )
+    {
+        manyKeys.push_back("field_" + std::to_string(n));
+    }
+    const tinyjson::JsonKeySet many(manyKeys);
+    for( size_t n = 0 ; n < manyKeys.size() ; n++ )
+    {
+        if( many.Find(manyKeys[n]) != int(n) )
+        {
+            std::cout << "Big key set did not find " << manyKeys[n] << "\n";
+            return false;
+        }
+    }
+    for( const char* unknown : {"field_5000","field_","field_-1","field_0 ","Field_1","x"} )
+    {
+        if( many.Find(unknown) != -1 )
+        {
+            std::cout << "Big key set found a key that is not in it, " << unknown << "\n";
+            return false;
+        }
+    }
+
+    // A schema with that many properties uses a key set for them.
+    std::string properties;
+    for( int n = 0 ; n < 600 ; n++ )
+    {
+        properties += (n ? ",\"field_" : "\"field_") + std::to_string(n) + "\":{\"type\":\"integer\"}";
+    }
+    const tinyjson::JsonSchema bigSchema(tinyjson::JsonProcessor("{\"type\":\"object\",\"properties\":{" + properties + "}}").GetRoot());
+    tinyjson::JsonProcessor(R"({"field_0":1,"field_599":2,"other":"x"})",bigSchema);
+    try
+    {
+        tinyjson::JsonProcessor(R"({"field_0":1,"field_599":"two"})",bigSchema);
+        std::cout << "A schema with many properties did not check the last one\n";
+        return false;
+    }
+    catch( std::runtime_error &e ){}
+
+    static_assert(tinyjson::JsonKeyHash("temp",4) != tinyjson::JsonKeyHash("pmet",4),"JsonKeyHash should be usable at compile time");
+
+    try
+    {
+        tinyjson::JsonKeySet twice = {"a","b","a"};
+        std::cout << "Key set with the same key twice did not throw\n";
+        return false;
+    }
+    catch( std::runtime_error &e ){}
+
+    return true;
+}
+
+/**
+ * @brief Checks that parsing with a schema accepts json that matches and stops on the first value that does not, saying where it is.
+ */
+static bool TestSchemaValidation()
+{
+    std::cout << "Testing schema validation\n";
+
+    const tinyjson::JsonSchema weatherSchema(tinyjson::JsonProcessor(R"({
+        "type":"object",
+        "required":["lat","lon","timezone","current"],
+        "properties":{
+            "lat":{"type":"number","minimum":-90,"maximum":90},
+            "lon":{"type":"number","minimum":-180,"maximum":180},
+            "timezone":{"type":"string","minLength":1},
+            "timezone_offset":{"type":"integer"},
+            "current":{
+                "type":"object",
+                "required":["dt","temp","weather"],
+                "properties":{
+                    "dt":{"type":"integer","minimum":0},
+                    "temp":{"type":"number"},
+                    "weather":{"type":"array","minItems":1,"items":{
+                        "type":"object",
+                        "properties":{"main":{"type":"string","enum":["Clear","Clouds","Rain","Snow","Drizzle"]}}
+                    }}
+                }
+            },
+            "hourly":{"type":"array","maxItems":48},
+            "daily":{"type":"array","items":{"type":"object"}}
+        }
+    })").GetRoot());
+
+    tinyjson::JsonProcessor json;
+    const std::string weather = LoadFileIntoString("weather.json");
+    try
+    {
+        if( IsSameJson(json.Parse(weather,weatherSchema),tinyjson::JsonProcessor(weather).GetRoot()) == false )
+        {
+            std::cout << "Parsing with a schema gave a different tree\n";
+            return false;
+        }
+    }
+    catch( std::runtime_error &e )
+    {
+        std::cout << "weather.json did not pass its schema, " << e.what() << "\n";
+        return false;
+    }
+
+    const tinyjson::JsonSchema schema(tinyjson::JsonProcessor(R"({
+        "type":"object",
+        "required":["name"],
+        "additionalProperties":false,
+        "properties":{
+            "name":{"type":"string","maxLength":4},
+            "count":{"type":"integer","minimum":0,"maximum":10},
+            "kind":{"enum":["a","b",1]},
+            "list":{"type":"array","maxItems":2,"items":{"type":["number","null"]}}
+        }
+    })").GetRoot());
+
+    // Json that is fine, then json that breaks the schema in one place with the line and column we expect in the error.
+    const std::vector<std::string> good =
+    {
+        R"({"name":"tom"})",
+        R"({"name":"été","count":10,"kind":1.0,"list":[null,2.5]})",
+        R"({"kind":"b","name":"","list":[]})",
+        R"({"name":"tom","count":1.0})",    // Integers can be written with a fraction or an exponent.
+        R"({"name":"tom","count":1e1})",
+        R"({"name":"tom","count":-0.0})",
+        R"({"name":"tom","count":0.05e2})"
+    };
+    const std::vector<std::pair<std::string,std::string>> bad =
+    {
+        {R"([1,2])","Line 1 column 1 "},
+        {R"({"count":1})","Line 1 column 1 "},             // Missing a required key, found at the end of the object but reported at its start.
+        {"{\"name\":\"tom\",\n\"count\":1.5}","Line 2 column 9 "},
+        {R"({"name":"tom","count":11})","Line 1 column 23 "},
+        {R"({"name":"tom","count":-1})","Line 1 column 23 "},
+        {R"({"name":"tomas"})","Line 1 column 9 "},
+        {R"({"name":"tom","kind":"c"})","Line 1 column 22 "},
+        {R"({"name":"tom","other":1})","Line 1 column 23 "},
+        {R"({"name":"tom","list":[1,"2"]})","Line 1 column 25 "},
+        {R"({"name":"tom","list":[1,2,3,4]})","Line 1 column 27 "}, // Fails at the third item, not the end of the array.
+        {R"({"name":true})","Line 1 column 9 "},
+        {R"({"name":"tom","count":1e-1})","Line 1 column 23 "},
+        {R"({"name":"tom","count":2.50})","Line 1 column 23 "}
+    };
+
+    for( const auto& text : good )
+    {
+        try
+        {
+            json.Parse(text,schema);
+        }
+        catch( std::runtime_error &e )
+        {
+            std::cout << "Json that matches the schema failed, " << text << " " << e.what() << "\n";
+            return false;
+        }
+    }
+
+    for( const auto& test : bad )
+    {
+        try
+        {
+            json.Parse(test.first,schema);
+            std::cout << "Json that does not match the schema was parsed, " << test.first << "\n";
+            return false;
+        }
+        catch( std::runtime_error &e )
+        {
+            if( std::string(e.what()).find(test.second) == std::string::npos )
+            {
+                std::cout << "Schema error for " << test.first << " was not at " << test.second << ", " << e.what() << "\n";
+                return false;
+            }
+        }
+    }
+
+    // The processor is still fine to use after a schema error.
+    if( json.Parse(good[1],schema)["list"].GetArraySize() != 2 )
+    {
+        std::cout << "Processor did not recover from a schema error\n";
+        return false;
+    }
+
+    // Annotations are allowed, keywords that would change what is allowed and are not supported are not.
+    tinyjson::JsonSchema(tinyjson::JsonProcessor(R"({"$schema":"https://json-schema.org/draft/2020-12/schema","$id":"x","title":"t","description":"d",
+        "properties":{"a":{"type":"integer","default":1,"examples":[1,2],"$comment":"c"}}})").GetRoot());
+    for( const char* unsupported : {R"({"type":"string","pattern":"^a"})",R"({"properties":{"a":{"multipleOf":2}}})",R"({"items":{"unique":true}})"} )
+    {
+        try
+        {
+            tinyjson::JsonSchema(tinyjson::JsonProcessor(unsupported).GetRoot());
+            std::cout << "Schema with a keyword that is not supported was made, " << unsupported << "\n";
+            return false;
+        }
+        catch( std::runtime_error &e )
+        {
+            std::cerr << "Schema error trapped correctly, " << e.what() << '\n';
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks that json nested too deeply is turned down cleanly, by the parser, the parallel parser and the decoder, and that the limit can be set.
+ */
+static bool TestNestingDepth()
+{
+    std::cout << "Testing nesting depth limit\n";
+
+    // A million '[' would have blown the stack of the old recursive parser.
+    const std::string bomb(1000000,'[');
+    const std::string objectBomb = [](){std::string json;for( int n = 0 ; n < 100000 ; n++ ){json += "{\"a\":";}return json;}();
+
+    tinyjson::JsonProcessor json;
+    for( const std::string* text : {&bomb,&objectBomb} )
+    {
+        try
+        {
+            json.Parse(*text);
+            std::cout << "Json nested a hundred thousand deep was parsed\n";
+            return false;
+        }
+        catch( std::runtime_error &e )
+        {
+            if( std::string(e.what()).find("nested deeper than the 1024 levels") == std::string::npos )
+            {
+                std::cout << "Wrong error for json nested too deep, " << e.what() << "\n";
+                return false;
+            }
+        }
+    }
+
+    // Exactly at the limit is fine, one more is not, and the processor is fine to use after.
+    json.SetMaxDepth(3);
+    const std::vector<std::pair<std::string,bool>> tests =
+    {
+        {R"([[[]]])",true},
+        {R"([[[[]]]])",false},
+        {R"({"a":[{"b":1}],"c":[]})",true},
+        {R"({"a":[{"b":[]}]})",false},
+        {R"([1,[2,[3,{}]]])",false},
+        {R"([1,[2,[3,4]],[5]])",true}
+    };
+    for( const auto& test : tests )
+    {
+        bool parsed = true;
+        try
+        {
+            json.Parse(test.first);
+        }
+        catch( std::runtime_error &e )
+        {
+            parsed = false;
+        }
+        if( parsed != test.second )
+        {
+            std::cout << "Depth limit of 3 got " << test.first << " wrong\n";
+            return false;
+        }
+    }
+
+    // The parallel parse has to give the same result, its elements are parsed not knowing how deep their array is.
+    std::string big = "{\"records\":[";
+    for( int n = 0 ; n < 40000 ; n++ )
+    {
+        big += n ? ",[[" : "[[";
+        big += std::to_string(n) + "]]";
+    }
+    big += "]}";
+    tinyjson::JsonThreadPool pool(4);
+    for( size_t depth : {size_t(3),size_t(4)} )
+    {
+        std::string sequentialError,parallelError;
+        json.SetMaxDepth(depth);
+        try{json.Parse(big);}catch( std::runtime_error &e ){sequentialError = e.what();}
+        try{json.Parse(big,pool);}catch( std::runtime_error &e ){parallelError = e.what();}
+        if( sequentialError != parallelError || sequentialError.empty() != (depth == 4) )
+        {
+            std::cout << "Parallel parse with a depth limit of " << depth << " did not match the sequential parse, \"" << sequentialError << "\" \"" << parallelError << "\"\n";
+            return false;
+        }
+    }
+
+    // The decoder skips values it has no field for without recursing, and has the same limit.
+    WeatherInfo info;
+    try
+    {
+        tinyjson::JsonDecode("{\"other\":" + bomb + "}",info);
+        std::cout << "Decoder skipped json nested a million deep\n";
+        return false;
+    }
+    catch( std::runtime_error &e ){}
+
+    std::vector<std::vector<std::vector<int>>> numbers;
+    tinyjson::JsonDecoder decoder("[[[1,2]],[[3]]]",15);
+    decoder.SetMaxDepth(2);
+    try
+    {
+        decoder.Decode(numbers);
+        std::cout << "Decoder did not keep to its depth limit\n";
+        return false;
+    }
+    catch( std::runtime_error &e ){}
+
+    return true;
+}
+
+/**
+ * @brief Checks that very deep trees can be copied, written and freed, all used to recurse once per level, and that copies are the same as the original.
+ */
+static bool TestDeepTrees()
+{
+    std::cout << "Testing copying, writing and freeing deep trees\n";
+
+    const size_t depth = 500000;
+    tinyjson::JsonProcessor json;
+    json.SetMaxDepth(depth);
+    const std::string nested = std::string(depth,'[') + std::string(depth,']');
+    tinyjson::JsonValue deep(json.Parse(nested));
+    tinyjson::JsonValue copy;
+    copy = deep;
+    for( const tinyjson::JsonValue* tree : {&deep,&copy} )
+    {
+        size_t levels = 1;
+        for( const tinyjson::JsonValue* value = tree ; value->mArray.size() > 0 ; value = &value->mArray[0] )
+        {
+            levels++;
+        }
+        if( levels != depth )
+        {
+            std::cout << "Copy of a tree " << depth << " deep was " << levels << " deep\n";
+            return false;
+        }
+    }
+
+    // Written back out it is the json it was read from, and so is a tree as deep made with EmplaceBack and Emplace.
+    tinyjson::JsonValue built;
+    tinyjson::JsonValue* inner = &built;
+    std::string builtJson;
+    for( size_t n = 0 ; n < depth / 2 ; n++ )
+    {
+        inner = &inner->EmplaceBack(tinyjson::JsonValueType::OBJECT).Emplace("k");
+        builtJson += "[{\"k\":";
+    }
+    builtJson += "null";
+    for( size_t n = 0 ; n < depth / 2 ; n++ )
+    {
+        builtJson += "}]";
+    }
+    const std::pair<const tinyjson::JsonValue*,const std::string*> written[] = {{&deep,&nested},{&built,&builtJson}};
+    for( const auto& tree : written )
+    {
+        std::ostringstream output;
+        tinyjson::JsonWriter(output,*tree.first,false);
+        if( output.str() != *tree.second || tinyjson::JsonToCanonical(*tree.first) != *tree.second )
+        {
+            std::cout << "A tree " << depth << " deep was not written as the json it was made from\n";
+            return false;
+        }
+    }
+
+    // Copies of a normal tree, by construction, assignment and into an array, are the same as the original.
+    const tinyjson::JsonProcessor weather(LoadFileIntoString("weather.json"));
+    tinyjson::JsonValue weatherCopy(weather.GetRoot());
+    tinyjson::JsonValue weatherCopies(tinyjson::JsonValueType::ARRAY);
+    weatherCopies.EmplaceBack(weather.GetRoot());
+    weatherCopies.EmplaceBack(weatherCopy);
+    weatherCopy = weatherCopy;
+    weatherCopies.mArray[1] = weatherCopies.mArray[0];
+    for( const tinyjson::JsonValue* tree : {&weatherCopy,&weatherCopies.mArray[0],&weatherCopies.mArray[1]} )
+    {
+        if( IsSameJson(*tree,weather.GetRoot()) == false )
+        {
+            std::cout << "Copy of weather.json is not the same as the original\n";
+            return false;
+        }
+    }
+
+    // Freed on the pool, the tree is moved out so nothing is left behind.
+    {
+        tinyjson::JsonThreadPool pool(1);
+        tinyjson::JsonFreeInBackground(std::move(deep),pool);
+        tinyjson::JsonFreeInBackground(json.TakeRoot(),pool);
+        if( deep.mArray.size() != 0 || json.GetRoot().mArray.size() != 0 )
+        {
+            std::cout << "Freeing in the background did not take the tree\n";
+            return false;
+        }
+    }// The pool waits for the tree to be freed.
+
+    return true;
+}
+
+/**
+ * @brief Checks the memory and allocation statistics of trees and of the processor.
+ */
+static bool TestMemoryStatistics()
+{
+    std::cout << "Testing memory statistics\n";
+
+    const tinyjson::JsonProcessor small(R"({"a":[1,2.5,"x"],"b":true,"c":null,"a key that is too long to fit":"and a string that is too long to fit"})");
+    const tinyjson::JsonMemoryUsage usage = small.GetRoot().MemoryUsage();
+    if( usage.mObjects != 1 || usage.mArrays != 1 || usage.mNumbers != 2 || usage.mStrings != 2 || usage.mBooleans != 1 || usage.mNulls != 1 ||
+        usage.GetValueCount() != 8 || usage.mKeyBytes == 0 || usage.mStringBytes == 0 || usage.mValueBytes < 8 * sizeof(tinyjson::JsonValue) )
+    {
+        std::cout << "Memory usage of a small tree is wrong\n";
+        return false;
+    }
+
+    tinyjson::JsonProcessor json;
+    json.EnableStatistics();
+    const std::string weather = LoadFileIntoString("weather.json");
+
+    json.Parse(weather);
+    const tinyjson::JsonParseStatistics first = json.GetStatistics();
+    json.Parse(weather);
+    const tinyjson::JsonParseStatistics& second = json.GetStatistics();
+
+    const tinyjson::JsonMemoryUsage tree = json.GetRoot().MemoryUsage();
+    if( first.mAllocations == 0 || first.mReused != 0 || second.mReused == 0 || second.mAllocations >= first.mAllocations ||
+        second.mParses != 2 || second.mTotalAllocations != first.mAllocations + second.mAllocations ||
+        second.mTree.GetTotalBytes() != tree.GetTotalBytes() || second.mTree.GetValueCount() != tree.GetValueCount() ||
+        second.mPeakBytes < tree.GetTotalBytes() )
+    {
+        std::cout << "Processor statistics are wrong, allocations " << first.mAllocations << " then " << second.mAllocations << ", reused " << second.mReused << "\n";
+        return false;
+    }
+    std::cout << "weather.json has " << tree.GetValueCount() << " values using " << tree.GetTotalBytes() << " bytes, parsing again made " << second.mAllocations << " allocations\n";
+
+    json.ResetStatistics();
+    json.EnableStatistics(false);
+    json.Parse(weather);
+    if( json.GetStatistics().mParses != 1 || json.GetStatistics().mTree.GetValueCount() != 0 )
+    {
+        std::cout << "Processor statistics were not reset or turned off\n";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks the parse profile counts the phases, only built in when TINYJSON_PROFILE is defined.
+ */
+static bool TestParseProfile()
+{
+    std::cout << "Testing parse profile\n";
+#ifdef TINYJSON_PROFILE
+    typedef tinyjson::JsonParseProfile Profile;
+    const std::string small = R"({"a":[1,true,"x"], "b" : null})";
+    tinyjson::JsonProcessor json;
+    json.Parse(small);
+    const Profile& profile = json.GetProfile();
+    const Profile::Counter* phases = profile.mPhases;
+    if( phases[Profile::KEYS].mCalls != 2 || phases[Profile::KEYS].mBytes != 6 ||
+        phases[Profile::STRINGS].mCalls != 1 || phases[Profile::STRINGS].mBytes != 3 ||
+        phases[Profile::NUMBERS].mCalls != 1 || phases[Profile::NUMBERS].mBytes != 1 ||
+        phases[Profile::LITERALS].mCalls != 2 || phases[Profile::LITERALS].mBytes != 8 ||
+        phases[Profile::OBJECT_ENTRIES].mCalls != 2 || phases[Profile::ARRAY_ELEMENTS].mCalls != 3 ||
+        phases[Profile::WHITE_SPACE].mBytes != 3 ||
+        profile.mParses.mCalls != 1 || profile.mParses.mBytes != small.size() || profile.mParses.mTicks == 0 )
+    {
+        std::cout << "Profile of a small parse is wrong\n" << profile.GetReport();
+        return false;
+    }
+
+    json.Parse(LoadFileIntoString("canada.json"));
+    std::cout << json.GetProfile().GetReport();
+
+    json.ResetProfile();
+    if( json.GetProfile().mParses.mCalls != 0 || json.GetProfile().mPhases[Profile::WHITE_SPACE].mCalls != 0 )
+    {
+        std::cout << "Profile was not reset\n";
+        return false;
+    }
+#else
+    std::cout << "Not built in, define TINYJSON_PROFILE to test it\n";
+#endif
+    return true;
+}
+
+/**
+ * @brief Checks trees written as CBOR read back the same, that CBOR from elsewhere can be read and that bad CBOR is turned down.
+ */
+static bool TestCbor()
+{
+    std::cout << "Testing cbor\n";
+
+    for( const char* file : {"weather.json","canada.json"} )
+    {
+        const std::string text = LoadFileIntoString(file);
+        auto parseStart = std::chrono::steady_clock::now();
+        const tinyjson::JsonProcessor json(text);
+        auto parseEnd = std::chrono::steady_clock::now();
+        const std::string cbor = tinyjson::JsonToCbor(json.GetRoot());
+        auto readStart = std::chrono::steady_clock::now();
+        const tinyjson::JsonCborReader reader(cbor);
+        auto readEnd = std::chrono::steady_clock::now();
+
+        if( ToJson(reader.GetRoot()) != ToJson(json.GetRoot()) )
+        {
+            std::cout << file << " did not read back from cbor the same\n";
+            return false;
+        }
+        const std::chrono::duration<float,std::milli> parseTime = parseEnd - parseStart;
+        const std::chrono::duration<float,std::milli> readTime = readEnd - readStart;
+        std::cout << file << " " << text.size() << " bytes as json, parsed in " << parseTime.count() << "ms, " << cbor.size() << " bytes as cbor, read in " << readTime.count() << "ms\n";
+    }
+
+    // Numbers keep their text, strings lose their escapes.
+    const tinyjson::JsonProcessor small(R"({"a":[1.50,-2,0.001,-1.5e-20,12345678901234567890123,-0],"b":"x\nü","c":true,"d":null})");
+    const std::string smallCbor = tinyjson::JsonToCbor(small.GetRoot());
+    if( tinyjson::JsonToCbor(tinyjson::JsonProcessor("1.50").GetRoot()) != "\xc4\x82\x21\x18\x96" ||
+        tinyjson::JsonToCbor(tinyjson::JsonProcessor(R"("x\nü")").GetRoot()) != "\x64x\n\xc3\xbc" )
+    {
+        std::cout << "Cbor written is not what was expected\n";
+        return false;
+    }
+    const tinyjson::JsonValue small2 = tinyjson::JsonFromCbor(smallCbor);
+    if( ToJson(small2) != R"({"a":[1.50,-2,0.001,-15e-21,1.2345678901234568e+22,-0],"b":"x\nü","c":true,"d":null})" )
+    {
+        std::cout << "Small tree did not read back from cbor as expected " << ToJson(small2) << "\n";
+        return false;
+    }
+
+    // The largest integers CBOR holds are written as integers and read back exactly, one more becomes a double.
+    const std::pair<std::string,std::string> limits[] =
+    {
+        {"18446744073709551615",std::string("\x1b\xff\xff\xff\xff\xff\xff\xff\xff",9)},
+        {"-18446744073709551616",std::string("\x3b\xff\xff\xff\xff\xff\xff\xff\xff",9)},
+        {"18446744073709551614",std::string("\x1b\xff\xff\xff\xff\xff\xff\xff\xfe",9)},
+        {"-18446744073709551615",std::string("\x3b\xff\xff\xff\xff\xff\xff\xff\xfe",9)}
+    };
+    for( const auto& limit : limits )
+    {
+        const std::string cbor = tinyjson::JsonToCbor(tinyjson::JsonProcessor(limit.first).GetRoot());
+        if( cbor != limit.second || ToJson(tinyjson::JsonFromCbor(cbor)) != limit.first )
+        {
+            std::cout << "Cbor integer " << limit.first << " did not round trip exactly\n";
+            return false;
+        }
+    }
+    for( const char* tooBig : {"18446744073709551616","-18446744073709551617","184467440737095516160","-18446744073709551616.0"} )
+    {
+        if( tinyjson::JsonToCbor(tinyjson::JsonProcessor(tooBig).GetRoot())[0] != char(0xfb) )
+        {
+            std::cout << "Cbor integer " << tooBig << " that does not fit was not written as a double\n";
+            return false;
+        }
+    }
+
+    // CBOR that was not written by us, examples from RFC 8949.
+    const std::pair<std::string,std::string> examples[] =
+    {
+        {std::string("\xf9\x3c\x00",3),"1"},
+        {std::string("\xf9\x80\x00",3),"-0"},
+        {std::string("\xfa\x47\xc3\x50\x00",5),"100000"},
+        {std::string("\xfb\x7e\x37\xe4\x3c\x88\x00\x75\x9c",9),"1e+300"},
+        {std::string("\xf9\x7c\x00",3),"null"},
+        {std::string("\x3b\xff\xff\xff\xff\xff\xff\xff\xff",9),"-18446744073709551616"},
+        {std::string("\xc1\x1a\x51\x4b\x67\xb0",6),"1363896240"},
+        {std::string("\x9f\x01\x82\x02\x03\x9f\x04\x05\xff\xff",10),"[1,[2,3],[4,5]]"},
+        {std::string("\xbf\x61\x61\x01\x61\x62\x9f\x02\x03\xff\xff",11),R"({"a":1,"b":[2,3]})"},
+        {std::string("\xa2\x01\x02\x03\x04",5),R"({"1":2,"3":4})"},
+        {std::string("\x7f\x65strea\x64ming\xff",13),R"("streaming")"},
+        {std::string("\x62\x22\x5c",3),R"("\"\\")"},
+        {std::string("\xf7",1),"null"},
+    };
+    for( const auto& example : examples )
+    {
+        const std::string json = ToJson(tinyjson::JsonFromCbor(example.first));
+        if( json != example.second )
+        {
+            std::cout << "Cbor example read as " << json << " and not " << example.second << "\n";
+            return false;
+        }
+    }
+
+    const std::string bad[] =
+    {
+        std::string("\x82\x01",2),              // Truncated.
+        std::string("\x43\x01\x02\x03",4),      // Byte string.
+        std::string("\x01\x02",2),              // Data after the root.
+        std::string("\xa2\x61\x61\x01\x61\x61\x02",7), // The same key twice.
+        std::string("\xc2\x41\x01",3),          // Bignum.
+        std::string("\x9b\xff\xff\xff\xff\xff\xff\xff\xff",9), // Huge length.
+        std::string("\xff",1),                  // Break with nothing to end.
+        std::string("\xf0",1),                  // Unassigned simple value.
+    };
+    for( const auto& cbor : bad )
+    {
+        try
+        {
+            tinyjson::JsonFromCbor(cbor);
+            std::cout << "Bad cbor was not turned down\n";
+            return false;
+        }
+        catch( const std::exception& e )
+        {
+            std::cout << "Cbor error trapped correctly, " << e.what() << "\n";
+        }
+    }
+
+    // Deep nesting is read and written without recursion.
+    const size_t depth = 100000;
+    const std::string deep = std::string(depth,'\x81') + "\xf6";
+    if( tinyjson::JsonToCbor(tinyjson::JsonFromCbor(deep)) != deep )
+    {
+        std::cout << "Deep cbor did not read back the same\n";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks frozen documents can be read in place, give the same values as the tree they were made from and that damaged ones are turned down.
+ */
+static bool TestFrozenDocuments()
+{
+    std::cout << "Testing frozen documents\n";
+
+    const tinyjson::JsonProcessor weather(LoadFileIntoString("weather.json"));
+    const std::string exact = tinyjson::JsonFreeze(weather.GetRoot(),false);
+    if( ToJson(tinyjson::JsonFrozenView(exact).Thaw()) != ToJson(weather.GetRoot()) )
+    {
+        std::cout << "weather.json did not thaw back the same\n";
+        return false;
+    }
+
+    const std::string frozen = tinyjson::JsonFreeze(weather.GetRoot());
+    const tinyjson::JsonFrozenView root(frozen);
+    const tinyjson::JsonValue& tree = weather.GetRoot();
+    if( root.GetType() != tinyjson::JsonValueType::OBJECT || root.GetObjectSize() != tree.GetObject().size() ||
+        std::string(root["timezone"].GetString()) != tree["timezone"].GetString() ||
+        root["current"]["temp"].GetDouble() != tree["current"]["temp"].GetDouble() ||
+        root["current"]["dt"].GetInt64() != tree["current"]["dt"].GetInt64() ||
+        root["current"]["weather"][0]["id"].GetInt() != 804 ||
+        std::string(root["current"]["weather"][0]["main"].GetString()) != "Clouds" ||
+        root["hourly"].GetArraySize() != tree["hourly"].GetArraySize() ||
+        root.HasValue("nothing") || !root.HasValue("daily") || root.Find("nothing",7).GetType() != tinyjson::JsonValueType::INVALID )
+    {
+        std::cout << "Frozen weather.json does not have the same values\n";
+        return false;
+    }
+    size_t key = 0;
+    for( const auto& entry : tree )
+    {
+        if( entry.first != root.GetKeyAt(key) || root.GetValueAt(key).GetType() != entry.second.GetType() )
+        {
+            std::cout << "Frozen keys are not in the same order\n";
+            return false;
+        }
+        key++;
+    }
+
+    // Packed numbers too small to be normal thaw back to the same value.
+    const tinyjson::JsonValue tiny = ParseJson("[5e-324,1e-310,0.1]");
+    if( tinyjson::JsonFrozenView(tinyjson::JsonFreeze(tiny)).Thaw() != tiny )
+    {
+        std::cout << "Packed subnormal numbers did not thaw back the same\n";
+        return false;
+    }
+
+    // canada.json is nearly all arrays of numbers, which are packed.
+    const std::string canadaText = LoadFileIntoString("canada.json");
+    auto parseStart = std::chrono::steady_clock::now();
+    const tinyjson::JsonProcessor canada(canadaText);
+    auto parseEnd = std::chrono::steady_clock::now();
+    const std::string canadaFrozen = tinyjson::JsonFreeze(canada.GetRoot());
+    auto openStart = std::chrono::steady_clock::now();
+    const tinyjson::JsonFrozenView canadaRoot(canadaFrozen);
+    const tinyjson::JsonFrozenView polygons = canadaRoot["features"][0]["geometry"]["coordinates"];
+    auto openEnd = std::chrono::steady_clock::now();
+
+    const tinyjson::JsonValue& treePolygons = canada.GetRoot()["features"][0]["geometry"]["coordinates"];
+    size_t points = 0;
+    for( size_t p = 0 ; p < treePolygons.GetArraySize() ; p++ )
+    {
+        for( size_t n = 0 ; n < treePolygons[p].GetArraySize() ; n++, points++ )
+        {
+            if( polygons[p][n][0].GetDouble() != treePolygons[p][n][0].GetDouble() || polygons[p][n][1].GetDouble() != treePolygons[p][n][1].GetDouble() )
+            {
+                std::cout << "Frozen canada.json point " << p << "," << n << " is not the same\n";
+                return false;
+            }
+        }
+    }
+    const std::chrono::duration<float,std::milli> parseTime = parseEnd - parseStart;
+    const std::chrono::duration<float,std::milli> openTime = openEnd - openStart;
+    std::cout << "canada.json " << canadaText.size() << " bytes parsed in " << parseTime.count() << "ms, " << canadaFrozen.size() << " bytes frozen opened in " << openTime.count() << "ms, " << points << " points checked\n";
+
+    // Deep documents are frozen and thawed without recursion.
+    const size_t depth = 100000;
+    tinyjson::JsonValue deep;
+    tinyjson::JsonValue* last = &deep;
+    for( size_t n = 0 ; n < depth ; n++ )
+    {
+        last = &last->EmplaceBack();
+    }
+    *last = std::string("bottom");
+    const std::string deepFrozen = tinyjson::JsonFreeze(deep);
+    if( tinyjson::JsonFreeze(tinyjson::JsonFrozenView(deepFrozen).Thaw()) != deepFrozen || deepFrozen.size() < depth * 8 )
+    {
+        std::cout << "Deep document did not thaw back the same\n";
+        return false;
+    }
+
+    std::string damaged = frozen;
+    damaged[20] = char(0xff); // The offset of the root.
+    const std::string bad[] = {frozen.substr(0,frozen.size() - 8),"TJFZ",std::string(frozen.size(),'x'),damaged};
+    for( const auto& data : bad )
+    {
+        try
+        {
+            tinyjson::JsonFrozenView(data)["timezone"].GetString();
+            std::cout << "Damaged frozen document was not turned down\n";
+            return false;
+        }
+        catch( const std::exception& e )
+        {
+            std::cout << "Frozen error trapped correctly, " << e.what() << "\n";
+        }
+    }
+
+    // The slot of the first element of [[1],[2]] rewritten to be the slot of the outer array, so the array holds itself.
+    tinyjson::JsonValue pairs;
+    pairs.EmplaceBack().EmplaceBack(1);
+    pairs.EmplaceBack().EmplaceBack(2);
+    std::string looped = tinyjson::JsonFreeze(pairs,false);
+    uint32_t outer;
+    memcpy(&outer,looped.data() + tinyjson::JsonFrozenFormat::ROOT_SLOT + 4,sizeof(outer));
+    looped.replace(outer,tinyjson::JsonFrozenFormat::SLOT_SIZE,looped,tinyjson::JsonFrozenFormat::ROOT_SLOT,tinyjson::JsonFrozenFormat::SLOT_SIZE);
+    try
+    {
+        tinyjson::JsonFrozenView(looped).Thaw();
+        std::cout << "Frozen array that holds itself was thawed\n";
+        return false;
+    }
+    catch( const std::exception& e )
+    {
+        std::cout << "Frozen error trapped correctly, " << e.what() << "\n";
+    }
+
+    for( auto misuse : {0,1,2} )
+    {
+        try
+        {
+            if( misuse == 0 ){root["nothing"];}
+            if( misuse == 1 ){root["timezone"].GetDouble();}
+            if( misuse == 2 ){root["hourly"][1000];}
+            std::cout << "Frozen view misuse was not trapped\n";
+            return false;
+        }
+        catch( const std::exception& e )
+        {
+            std::cout << "Frozen error trapped correctly, " << e.what() << "\n";
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks the document cache hands back the same document for the same json and only parses what changed when it is not.
+ */
+static bool TestDocumentCache()
+{
+    std::cout << "Testing document cache\n";
+
+    tinyjson::JsonDocumentCache cache;
+    std::string weather = LoadFileIntoString("weather.json");
+    const tinyjson::JsonDocument first = cache.Load("weather",weather);
+    const tinyjson::JsonDocument same = cache.Load("weather",weather);
+    if( &first.GetRoot() != &same.GetRoot() || cache.GetStatistics().mUnchanged != 1 || cache.GetStatistics().mFullParses != 1 )
+    {
+        std::cout << "Loading the same json did not give the same document\n";
+        return false;
+    }
+
+    // Each change is checked against a full parse of the changed json.
+    auto loadChanged = [&](const std::string& pFind,const std::string& pReplace,size_t pMostBytes)
+    {
+        const size_t at = weather.find(pFind);
+        assert(at != std::string::npos);
+        weather.replace(at,pFind.size(),pReplace);
+        const tinyjson::JsonCacheStatistics before = cache.GetStatistics();
+        const tinyjson::JsonDocument loaded = cache.Load("weather",weather);
+        const tinyjson::JsonCacheStatistics after = cache.GetStatistics();
+        if( ToJson(loaded.GetRoot()) != ToJson(tinyjson::JsonProcessor(weather).GetRoot()) )
+        {
+            std::cout << "Changing " << pFind << " to " << pReplace << " did not give the same tree as a full parse\n";
+            return false;
+        }
+        if( after.mPartialParses != before.mPartialParses + 1 || after.mBytesParsed - before.mBytesParsed > pMostBytes )
+        {
+            std::cout << "Changing " << pFind << " to " << pReplace << " parsed " << after.mBytesParsed - before.mBytesParsed << " bytes\n";
+            return false;
+        }
+        return true;
+    };
+
+    if( !loadChanged("\"temp\": 283.15","\"temp\": 290.5",10) ||            // A number.
+        !loadChanged("\"overcast clouds\"","\"clear sky\"",20) ||           // A string.
+        !loadChanged("\"feels_like\": 277.59","\"feels like\": 277.59",1000) || // A key, its object is parsed again.
+        !loadChanged("\"dew_point\": 282.39,","",1000) )                    // An entry removed.
+    {
+        return false;
+    }
+
+    // The documents handed out are never changed.
+    if( first.GetRoot()["current"]["temp"].GetDouble() != 283.15 || !first.GetRoot()["current"].HasValue("dew_point") )
+    {
+        std::cout << "A document handed out by the cache was changed\n";
+        return false;
+    }
+
+    // Json that is no longer valid gives the error of a full parse and leaves the last document in the cache.
+    try
+    {
+        cache.Load("weather",weather.substr(0,weather.size() - 2));
+        std::cout << "Invalid json was not turned down\n";
+        return false;
+    }
+    catch( const std::exception& e )
+    {
+        std::cout << "Cache error trapped correctly, " << e.what() << "\n";
+    }
+    const size_t unchanged = cache.GetStatistics().mUnchanged;
+    cache.Load("weather",weather);
+    if( cache.GetStatistics().mUnchanged != unchanged + 1 )
+    {
+        std::cout << "Invalid json replaced the document in the cache\n";
+        return false;
+    }
+
+    // A big file with one number changed.
+    std::string canada = LoadFileIntoString("canada.json");
+    cache.Load("canada",canada);
+    canada[canada.size() / 2] = canada[canada.size() / 2] == '1' ? '2' : '1';
+    const size_t bytesParsed = cache.GetStatistics().mBytesParsed;
+    auto reloadStart = std::chrono::steady_clock::now();
+    const tinyjson::JsonDocument reloaded = cache.Load("canada",canada);
+    auto reloadEnd = std::chrono::steady_clock::now();
+    const std::chrono::duration<float,std::milli> reloadTime = reloadEnd - reloadStart;
+    std::cout << "canada.json with one character changed reloaded in " << reloadTime.count() << "ms\n";
+    if( cache.GetStatistics().mBytesParsed - bytesParsed > 100 || ToJson(reloaded.GetRoot()) != ToJson(tinyjson::JsonProcessor(canada).GetRoot()) )
+    {
+        std::cout << "Changing one number of canada.json did not parse just that number\n";
+        return false;
+    }
+
+    // Both values of a key that is there twice are parsed into the one entry, so a change to either is a full parse.
+    cache.Load("duplicates",R"({"a":{"b":1,"c":1},"a":{"b":2}})");
+    if( tinyjson::JsonProcessor(R"({"a":{"b":1,"c":1},"a":{"b":2}})").GetStatistics().mDuplicateKeys != 2 ) // The second "b" is parsed into the first "a" as well.
+    {
+        std::cout << "The key that is there twice was not counted\n";
+        return false;
+    }
+    const std::string duplicates = R"({"a":{"b":1,"c":5},"a":{"b":2}})";
+    const size_t fullParses = cache.GetStatistics().mFullParses;
+    if( ToJson(cache.Load("duplicates",duplicates).GetRoot()) != ToJson(tinyjson::JsonProcessor(duplicates).GetRoot()) || cache.GetStatistics().mFullParses != fullParses + 1 )
+    {
+        std::cout << "A change to a key that is there twice was not a full parse\n";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks json patches made by diffing two trees turn one into the other, and that patches and merge patches are applied as the RFCs say.
+ */
+static bool TestJsonPatch()
+{
+    std::cout << "Testing json patch\n";
+
+    // Examples from RFC 6902, with keys that need escaping in the pointers.
+    const std::vector<std::vector<std::string>> examples =
+    {
+        {R"({"foo":"bar"})",R"([{"op":"add","path":"/baz","value":"qux"}])",R"({"baz":"qux","foo":"bar"})"},
+        {R"({"foo":["bar","baz"]})",R"([{"op":"add","path":"/foo/1","value":"qux"}])",R"({"foo":["bar","qux","baz"]})"},
+        {R"({"foo":["bar"]})",R"([{"op":"add","path":"/foo/-","value":["abc","def"]}])",R"({"foo":["bar",["abc","def"]]})"},
+        {R"({"baz":"qux","foo":"bar"})",R"([{"op":"remove","path":"/baz"}])",R"({"foo":"bar"})"},
+        {R"({"foo":["bar","qux","baz"]})",R"([{"op":"remove","path":"/foo/1"}])",R"({"foo":["bar","baz"]})"},
+        {R"({"baz":"qux","foo":"bar"})",R"([{"op":"replace","path":"/baz","value":"boo"}])",R"({"baz":"boo","foo":"bar"})"},
+        {R"({"foo":{"bar":"baz","waldo":"fred"},"qux":{"corge":"grault"}})",R"([{"op":"move","from":"/foo/waldo","path":"/qux/thud"}])",
+            R"({"foo":{"bar":"baz"},"qux":{"corge":"grault","thud":"fred"}})"},
+        {R"({"foo":["all","grass","cows","eat"]})",R"([{"op":"move","from":"/foo/1","path":"/foo/3"}])",R"({"foo":["all","cows","eat","grass"]})"},
+        {R"({"baz":"qux","foo":["a",2,"c"]})",R"([{"op":"test","path":"/baz","value":"qux"},{"op":"test","path":"/foo/1","value":2.0}])",R"({"baz":"qux","foo":["a",2,"c"]})"},
+        {R"({"a/b":1,"m~n":[1]})",R"([{"op":"copy","from":"/a~1b","path":"/m~0n/0"},{"op":"replace","path":"","value":{"root":true}}])",R"({"root":true})"},
+    };
+    for( const auto& example : examples )
+    {
+        tinyjson::JsonValue target = ParseJson(example[0]);
+        tinyjson::JsonApplyPatch(target,ParseJson(example[1]));
+        if( ToJson(target) != ToJson(ParseJson(example[2])) )
+        {
+            std::cout << "Patch " << example[1] << " gave " << ToJson(target) << "\n";
+            return false;
+        }
+    }
+
+    // A patch that fails part way leaves the tree as it was.
+    const std::string before = R"({"list":[1,2,3],"name":"fred","inner":{"a":1}})";
+    const std::vector<std::string> failing =
+    {
+        R"([{"op":"add","path":"/list/1","value":9},{"op":"move","from":"/inner","path":"/name"},{"op":"remove","path":"/list/0"},{"op":"test","path":"/list/0","value":1}])",
+        R"([{"op":"replace","path":"","value":[]},{"op":"add","path":"/x","value":1}])",
+        R"([{"op":"move","from":"/inner","path":"/inner/b"}])",
+        R"([{"op":"add","path":"/list/4","value":1}])",
+        R"([{"op":"remove","path":"/missing"}])",
+        R"([{"op":"copy","from":"/list/01","path":"/a"}])",
+        R"([{"op":"jump","path":"/a"}])",
+        R"([{"op":"move","from":"/list/2","path":"/x/b"}])",
+        R"([{"op":"move","from":"/list/0","path":"/list/7"}])",
+        R"([{"op":"move","from":"/inner","path":"/name/a"}])",
+    };
+    for( const auto& patch : failing )
+    {
+        tinyjson::JsonValue target = ParseJson(before);
+        try
+        {
+            tinyjson::JsonApplyPatch(target,ParseJson(patch));
+            std::cout << "Patch " << patch << " should have failed\n";
+            return false;
+        }
+        catch( const std::exception& e )
+        {
+            std::cout << "Patch error trapped correctly, " << e.what() << "\n";
+        }
+        if( ToJson(target) != ToJson(ParseJson(before)) )
+        {
+            std::cout << "Failed patch " << patch << " left " << ToJson(target) << "\n";
+            return false;
+        }
+    }
+
+    // The merge patch example from RFC 7386.
+    tinyjson::JsonValue merged = ParseJson(R"({"title":"Goodbye!","author":{"givenName":"John","familyName":"Doe"},"tags":["example","sample"],"content":"This will be unchanged"})");
+    tinyjson::JsonApplyMergePatch(merged,ParseJson(R"({"title":"Hello!","phoneNumber":"+01-555-1234","author":{"familyName":null},"tags":["example"]})"));
+    if( ToJson(merged) != ToJson(ParseJson(R"({"title":"Hello!","author":{"givenName":"John"},"tags":["example"],"content":"This will be unchanged","phoneNumber":"+01-555-1234"})")) )
+    {
+        std::cout << "Merge patch gave " << ToJson(merged) << "\n";
+        return false;
+    }
+
+    // Diffs, each checked by applying the patch to the old tree.
+    const tinyjson::JsonValue weather = ParseJson(LoadFileIntoString("weather.json"));
+    auto checkDiff = [&](const tinyjson::JsonValue& pFrom,const tinyjson::JsonValue& pTo,size_t pOperations)
+    {
+        const tinyjson::JsonValue patch = tinyjson::JsonMakePatch(pFrom,pTo);
+        tinyjson::JsonValue patched = pFrom;
+        tinyjson::JsonApplyPatch(patched,patch);
+        if( ToJson(patched) != ToJson(pTo) || patch.GetArraySize() != pOperations )
+        {
+            std::cout << "Diff gave the patch " << ToJson(patch) << "\n";
+            return false;
+        }
+        return true;
+    };
+
+    tinyjson::JsonValue changed = weather;
+    changed["current"]["temp"] = tinyjson::JsonValue(290.5);
+    changed["hourly"].mArray.erase(changed["hourly"].mArray.begin() + 3);
+    changed["daily"].mArray.insert(changed["daily"].mArray.begin() + 2,tinyjson::JsonValue("a day"));
+    changed.mObject.erase("timezone");
+    changed["extra"] = tinyjson::JsonValue(true);
+    if( !checkDiff(weather,weather,0) || !checkDiff(weather,changed,5) || !checkDiff(changed,weather,5) ||
+        !checkDiff(weather,ParseJson("[1,2]"),1) || !checkDiff(ParseJson("[1,2,3,4]"),ParseJson("[0,1,3,4,5]"),3) )
+    {
+        return false;
+    }
+
+    // A big tree with one number changed is one operation.
+    const tinyjson::JsonValue canada = ParseJson(LoadFileIntoString("canada.json"));
+    tinyjson::JsonValue moved = canada;
+    moved["features"].mArray[0]["geometry"]["coordinates"].mArray[10].mArray[5].mArray[0] = tinyjson::JsonValue(1.5);
+    auto diffStart = std::chrono::steady_clock::now();
+    const tinyjson::JsonValue patch = tinyjson::JsonMakePatch(canada,moved);
+    auto diffEnd = std::chrono::steady_clock::now();
+    const std::chrono::duration<float,std::milli> diffTime = diffEnd - diffStart;
+    std::cout << "canada.json diff with one number changed took " << diffTime.count() << "ms\n";
+    if( ToJson(patch) != R"([{"op":"replace","path":"/features/0/geometry/coordinates/10/5/0","value":1.5}])" )
+    {
+        std::cout << "Diff of canada.json gave " << ToJson(patch) << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks trees that hold the same values compare and hash the same however they were written, and that hashes made by the parser are used.
+ */
+static bool TestValueHashing()
+{
+    std::cout << "Testing value hashing\n";
+
+    const std::vector<std::pair<std::string,std::string>> same =
+    {
+        {R"({"a":1,"b":[1.0,"x"]})",R"({"b":[10e-1,"x"],"a":1.00})"},
+        {R"([0,-0,0.0e5,100,-2.50])",R"([-0.0,0,0,1e2,-25E-1])"},
+        {R"({"\u0041":1,"B":"\u0063"})",R"({"A":1,"B":"c"})"},
+        {R"([0.001,123456789012345678901234567890])",R"([1e-3,1.2345678901234567890123456789e29])"},
+    };
+    for( const auto& pair : same )
+    {
+        const tinyjson::JsonValue a = ParseJson(pair.first);
+        const tinyjson::JsonValue b = ParseJson(pair.second);
+        if( a != b || a.GetHash() != b.GetHash() )
+        {
+            std::cout << pair.first << " and " << pair.second << " should be the same\n";
+            return false;
+        }
+    }
+
+    const std::vector<std::pair<std::string,std::string>> different =
+    {
+        {R"({"a":1})",R"({"a":2})"},
+        {R"({"a":1})",R"({"b":1})"},
+        {R"([1,2])",R"([2,1])"},
+        {R"([1])",R"([1,1])"},
+        {R"({"a":[]})",R"({"a":{}})"},
+        {R"(["1"])",R"([1])"},
+        {R"([0.1])",R"([0.10000000000000001])"},
+        {R"([true])",R"([false])"},
+        {R"([123456789012345678901234567890])",R"([123456789012345678901234567891])"},
+    };
+    for( const auto& pair : different )
+    {
+        const tinyjson::JsonValue a = ParseJson(pair.first);
+        const tinyjson::JsonValue b = ParseJson(pair.second);
+        if( a == b || a.GetHash() == b.GetHash() )
+        {
+            std::cout << pair.first << " and " << pair.second << " should be different\n";
+            return false;
+        }
+    }
+
+    // Hashes worked out by the parser, on one thread and on a pool, are the ones GetHash would give.
+    const std::string canadaJson = LoadFileIntoString("canada.json");
+    tinyjson::JsonProcessor hashed;
+    hashed.EnableHashing();
+    hashed.Parse(canadaJson);
+    tinyjson::JsonThreadPool pool(4);
+    tinyjson::JsonProcessor hashedOnPool;
+    hashedOnPool.EnableHashing();
+    hashedOnPool.Parse(canadaJson,pool);
+    const tinyjson::JsonValue plain = ParseJson(canadaJson);
+    if( hashed.GetRoot().mHash == 0 || hashed.GetRoot().mHash != plain.GetHash() || hashedOnPool.GetRoot().mHash != plain.GetHash() ||
+        hashed.GetRoot()["features"][0]["geometry"].mHash != plain["features"][0]["geometry"].GetHash() )
+    {
+        std::cout << "The parser did not give the same hashes as GetHash\n";
+        return false;
+    }
+
+    // A duplicate key read over an array leaves no hash behind from it.
+    const std::string duplicated = "{\"a\":[1,2],\"a\":3}";
+    tinyjson::JsonProcessor duplicates;
+    duplicates.EnableHashing();
+    duplicates.Parse(duplicated);
+    if( duplicates.GetRoot().mHash != ParseJson(duplicated).GetHash() )
+    {
+        std::cout << "A duplicate key kept the hash of the value it replaced\n";
+        return false;
+    }
+
+    // With hashes on both sides a difference deep down is found at the root.
+    tinyjson::JsonValue changed = hashed.GetRoot();
+    changed["features"].mArray[0]["geometry"]["coordinates"].mArray[479].mArray[0].mArray[1] = tinyjson::JsonValue(1.5);
+    changed.UpdateHashes();
+    auto compareStart = std::chrono::steady_clock::now();
+    const bool hashedSame = hashed.GetRoot() == changed;
+    auto compareEnd = std::chrono::steady_clock::now();
+    const bool plainSame = plain == changed;
+    auto plainEnd = std::chrono::steady_clock::now();
+    const std::chrono::duration<float,std::milli> hashedTime = compareEnd - compareStart;
+    const std::chrono::duration<float,std::milli> plainTime = plainEnd - compareEnd;
+    std::cout << "canada.json compared in " << hashedTime.count() << "ms with hashes, " << plainTime.count() << "ms without\n";
+    if( hashedSame || plainSame )
+    {
+        std::cout << "Changed canada.json compared the same\n";
+        return false;
+    }
+
+    // Going over an object so its values can be changed clears its hash.
+    tinyjson::JsonValue iterated = hashed.GetRoot();
+    for( auto& entry : iterated )
+    {
+        (void)entry;
+    }
+    if( iterated.mHash != 0 )
+    {
+        std::cout << "Iterating over a hashed object kept its hash\n";
+        return false;
+    }
+
+    // Changing a hashed tree with a patch does not leave old hashes behind.
+    tinyjson::JsonValue patched = hashed.GetRoot();
+    tinyjson::JsonApplyPatch(patched,ParseJson(R"([{"op":"replace","path":"/features/0/geometry/coordinates/479/0/1","value":1.5}])"));
+    if( patched != changed || patched.GetHash() != changed.GetHash() )
+    {
+        std::cout << "A patched tree kept its old hashes\n";
+        return false;
+    }
+
+    // The same events written in different ways are kept once.
+    std::unordered_set<tinyjson::JsonValue,tinyjson::JsonValueHash> events;
+    for( int n = 0 ; n < 300 ; n++ )
+    {
+        const int id = n % 100;
+        const std::string json = n < 100 ? "{\"id\":" + std::to_string(id) + ",\"name\":\"event\",\"scale\":1.5}" :
+                                 n < 200 ? "{\"scale\":15e-1,\"name\":\"ev\\u0065nt\",\"id\":" + std::to_string(id) + ".0}" :
+                                           "{\"name\":\"event\",\"id\":" + std::to_string(id) + ",\"scale\":1.50}";
+        events.insert(ParseJson(json));
+    }
+    if( events.size() != 100 )
+    {
+        std::cout << "Kept " << events.size() << " events and not 100\n";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks the canonical writer against the examples in RFC 8785, and that equal trees written differently give the same bytes.
+ */
+static bool TestCanonicalWriter()
+{
+    std::cout << "Testing canonical writer\n";
+    const std::string example = R"({
+        "numbers": [333333333.33333329, 1E30, 4.50, 2e-3, 0.000000000000000000000000001],
+        "string": "€$\u000F\u000aA'B\"\\\\\"\/",
+        "literals": [null, true, false]
+    })";
+    const std::string exampleCanonical = R"({"literals":[null,true,false],"numbers":[333333333.3333333,1e+30,4.5,0.002,1e-27],"string":"€$\u000f\nA'B\"\\\\\"/"})";
+    if( tinyjson::JsonToCanonical(ParseJson(example)) != exampleCanonical )
+    {
+        std::cout << "RFC 8785 example written as " << tinyjson::JsonToCanonical(ParseJson(example)) << "\n";
+        return false;
+    }
+
+    // The doubles from appendix B of the RFC, by their bits.
+    const std::vector<std::pair<uint64_t,std::string>> numbers = {
+        {0x0000000000000000ULL,"0"},{0x8000000000000000ULL,"0"},{0x0000000000000001ULL,"5e-324"},{0x8000000000000001ULL,"-5e-324"},
+        {0x7fefffffffffffffULL,"1.7976931348623157e+308"},{0xffefffffffffffffULL,"-1.7976931348623157e+308"},
+        {0x4340000000000000ULL,"9007199254740992"},{0xc340000000000000ULL,"-9007199254740992"},{0x4430000000000000ULL,"295147905179352830000"},
+        {0x44b52d02c7e14af5ULL,"9.999999999999997e+22"},{0x44b52d02c7e14af6ULL,"1e+23"},{0x44b52d02c7e14af7ULL,"1.0000000000000001e+23"},
+        {0x444b1ae4d6e2ef4eULL,"999999999999999700000"},{0x444b1ae4d6e2ef4fULL,"999999999999999900000"},{0x444b1ae4d6e2ef50ULL,"1e+21"},
+        {0x3eb0c6f7a0b5ed8cULL,"9.999999999999997e-7"},{0x3eb0c6f7a0b5ed8dULL,"0.000001"},{0x41b3de4355555553ULL,"333333333.3333332"},
+        {0x41b3de4355555554ULL,"333333333.33333325"},{0x41b3de4355555555ULL,"333333333.3333333"},{0x41b3de4355555556ULL,"333333333.3333334"},
+        {0x41b3de4355555557ULL,"333333333.33333343"},{0xbecbf647612f3696ULL,"-0.0000033333333333333333"},{0x43143ff3c1cb0959ULL,"1424953923781206.2"}
+    };
+    for( const auto& number : numbers )
+    {
+        double value;
+        memcpy(&value,&number.first,sizeof(value));
+        const std::string canonical = tinyjson::JsonToCanonical(tinyjson::JsonValue(value));
+        if( canonical != number.second )
+        {
+            std::cout << "Double " << std::hex << number.first << std::dec << " written as " << canonical << " and not " << number.second << "\n";
+            return false;
+        }
+    }
+
+    // Keys sort by utf16 code units, the emoji's surrogates come before U+FB33 where in utf8 it would come after.
+    const std::string keys = R"({"€":"Euro Sign","\r":"Carriage Return","דּ":"Hebrew Letter Dalet With Dagesh","1":"One",
+        "😀":"Emoji: Grinning Face","\u0080":"Control","ö":"Latin Small Letter O With Diaeresis"})";
+    const std::string canonicalKeys = tinyjson::JsonToCanonical(ParseJson(keys));
+    std::vector<size_t> positions;
+    for( const char* name : {"Carriage Return","One","Control","Latin Small Letter O With Diaeresis","Euro Sign","Emoji: Grinning Face","Hebrew Letter Dalet With Dagesh"} )
+    {
+        positions.push_back(canonicalKeys.find(name));
+    }
+    if( !std::is_sorted(positions.begin(),positions.end()) || positions.back() == std::string::npos || ParseJson(canonicalKeys) != ParseJson(keys) )
+    {
+        std::cout << "Keys not sorted by utf16 " << canonicalKeys << "\n";
+        return false;
+    }
+
+    // The same tree written in different ways is the same bytes.
+    if( tinyjson::JsonToCanonical(ParseJson(R"({ "b" : [ 1.0, 2e0, -0 ], "a" : "A\/" })")) != R"({"a":"A/","b":[1,2,0]})" )
+    {
+        std::cout << "Equal trees written differently\n";
+        return false;
+    }
+
+    // Big documents give the same bytes when written pretty first, and writing the canonical form again changes nothing.
+    for( const char* file : {"canada.json","sample.json"} )
+    {
+        const tinyjson::JsonValue root = ParseJson(LoadFileIntoString(file));
+        auto writeStart = std::chrono::steady_clock::now();
+        const std::string canonical = tinyjson::JsonToCanonical(root);
+        auto writeEnd = std::chrono::steady_clock::now();
+        const std::chrono::duration<float,std::milli> writeTime = writeEnd - writeStart;
+        std::cout << file << " written canonically in " << writeTime.count() << "ms\n";
+        std::stringstream pretty;
+        tinyjson::JsonWriter(pretty,root,true);
+        if( tinyjson::JsonToCanonical(ParseJson(pretty.str())) != canonical || tinyjson::JsonToCanonical(ParseJson(canonical)) != canonical )
+        {
+            std::cout << file << " did not give the same canonical form each time\n";
+            return false;
+        }
+    }
+
+    // There is no canonical form for numbers bigger than a double.
+    try
+    {
+        tinyjson::JsonToCanonical(ParseJson("[1e400]"));
+        std::cout << "A number too big for a double was written\n";
+        return false;
+    }
+    catch( const std::exception& e )
+    {
+        std::cout << "Too big number error trapped correctly, " << e.what() << '\n';
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks minifying and pretty printing json text without a tree, from memory and from streams read a block at a time.
+ */
+static bool TestReformatter()
+{
+    std::cout << "Testing reformatter\n";
+
+    // Keys stay in their order and numbers and strings as they were written.
+    const std::string json = "{ \"b\" : [ 1.50, -2E3, \"x\\u0041\" ],\n\t\"a\" : { }, \"c\" : [], \"d\" : TRUE, \"e\" : null }";
+    if( tinyjson::JsonMinify(json) != "{\"b\":[1.50,-2E3,\"x\\u0041\"],\"a\":{},\"c\":[],\"d\":true,\"e\":null}" )
+    {
+        std::cout << "Minified as " << tinyjson::JsonMinify(json) << "\n";
+        return false;
+    }
+    if( tinyjson::JsonPrettyPrint("[1,{\"a\":[]}]") != "[\n    1,\n    {\n        \"a\":[]\n    }\n]" )
+    {
+        std::cout << "Pretty printed as " << tinyjson::JsonPrettyPrint("[1,{\"a\":[]}]") << "\n";
+        return false;
+    }
+
+    // With the keys already in order the output is what JsonStreamWriter writes from the tree.
+    const std::string sample = LoadFileIntoString("sample.json");
+    for( bool pretty : {false,true} )
+    {
+        std::string written;
+        tinyjson::JsonStreamWriter(written,pretty).Value(ParseJson(sample));
+        std::string reformatted;
+        tinyjson::JsonReformatter(pretty).Reformat(written,reformatted);
+        if( reformatted != written )
+        {
+            std::cout << "Reformatting sample.json did not give what JsonStreamWriter wrote\n";
+            return false;
+        }
+    }
+
+    // From a stream, with tokens cut by the ends of the blocks and a string longer than a block.
+    const std::string canadaJson = LoadFileIntoString("canada.json");
+    auto minifyStart = std::chrono::steady_clock::now();
+    const std::string minified = tinyjson::JsonMinify(canadaJson);
+    auto minifyEnd = std::chrono::steady_clock::now();
+    std::stringstream written;
+    tinyjson::JsonWriter(written,ParseJson(canadaJson),false);
+    auto treeEnd = std::chrono::steady_clock::now();
+    const std::chrono::duration<float,std::milli> minifyTime = minifyEnd - minifyStart;
+    const std::chrono::duration<float,std::milli> treeTime = treeEnd - minifyEnd;
+    std::cout << "canada.json minified in " << minifyTime.count() << "ms, " << treeTime.count() << "ms through a tree\n";
+
+    const std::string longString(tinyjson::JsonReformatter::BLOCK_SIZE * 2 + 17,'s');
+    for( const std::string& input : {canadaJson,"[1,\"" + longString + "\", 2]"} )
+    {
+        std::stringstream in(input),out;
+        tinyjson::JsonReformatter().Reformat(in,out);
+        if( out.str() != tinyjson::JsonMinify(input) )
+        {
+            std::cout << "Reformatting a stream did not give the same as from memory\n";
+            return false;
+        }
+    }
+    if( ParseJson(minified) != ParseJson(canadaJson) )
+    {
+        std::cout << "Minified canada.json is not the same json\n";
+        return false;
+    }
+
+    // Bad json is found, from a stream the error says how far in it is.
+    for( const char* bad : {"[1,]","{\"a\" 1}","[1 2]","{\"a\":1","[01]","[\"a\tb\"]","[true] x","[nul]",""} )
+    {
+        try
+        {
+            tinyjson::JsonMinify(bad);
+            std::cout << "Bad json " << bad << " was reformatted\n";
+            return false;
+        }
+        catch( const std::exception& e )
+        {
+            std::cout << "Reformat error trapped correctly, " << e.what() << '\n';
+        }
+    }
+    try
+    {
+        std::stringstream in(canadaJson.substr(0,100000) + "]]]"),out;
+        tinyjson::JsonReformatter().Reformat(in,out);
+        std::cout << "Cut short canada.json was reformatted\n";
+        return false;
+    }
+    catch( const std::exception& e )
+    {
+        std::cout << "Reformat error trapped correctly, " << e.what() << '\n';
+        if( strstr(e.what(),"bytes into the input") == nullptr )
+        {
+            return false;
+        }
+    }
+
+    // An error blocks into a stream is at the line and column of the whole json, as the parser gives them.
+    std::string lines = "[\n";
+    for( int n = 0 ; n < 20000 ; n++ )
+    {
+        lines += "    {\"a\":1},\n";
+    }
+    lines += "    {\"a\":}]";
+    for( bool stream : {false,true} )
+    {
+        try
+        {
+            if( stream )
+            {
+                std::stringstream in(lines),out;
+                tinyjson::JsonReformatter().Reformat(in,out);
+            }
+            else
+            {
+                tinyjson::JsonProcessor json(lines);
+            }
+            std::cout << "Json with an error on its last line was read\n";
+            return false;
+        }
+        catch( const std::exception& e )
+        {
+            std::cout << "Error on the last line trapped correctly, " << e.what() << '\n';
+            if( strstr(e.what(),"Line 20002 column 10 ") == nullptr )
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks reading the elements of an array one at a time, from memory and from a stream, against the whole tree.
+ */
+static bool TestArrayReader()
+{
+    std::cout << "Testing array reader\n";
+
+    // Every ring of canada.json, read from a stream, is the same as in the whole tree and reuses the memory of the one before.
+    const std::string canadaJson = LoadFileIntoString("canada.json");
+    const tinyjson::JsonValue canada = ParseJson(canadaJson);
+    const tinyjson::JsonValue& rings = canada["features"][0]["geometry"]["coordinates"];
+    {
+        std::stringstream in(canadaJson);
+        tinyjson::JsonArrayReader reader(in,"/features/0/geometry/coordinates");
+        size_t count = 0;
+        while( reader.Next() )
+        {
+            if( reader.GetIndex() != count || reader.GetValue() != rings.mArray[count] )
+            {
+                std::cout << "Ring " << count << " of canada.json is not the same as in the tree\n";
+                return false;
+            }
+            count++;
+        }
+        if( count != rings.mArray.size() || reader.Next() || reader.GetStatistics().mReused == 0 )
+        {
+            std::cout << "Read " << count << " rings of canada.json and not " << rings.mArray.size() << "\n";
+            return false;
+        }
+    }
+
+    // Keys and indices in the pointer, escaped keys, and values in the way that look like brackets.
+    const std::string json = R"({"skip":{"s":"]}\"[","n":[[[]]]},"a~b/c":[0,{"x":[true,"y"]}],"records":[ {"id":1} ,{"id":2},
+        3 ]})";
+    tinyjson::JsonArrayReader inner(json,"/a~0b~1c/1/x");
+    if( !inner.Next() || inner.GetValue().GetBoolean() != true || !inner.Next() || inner.GetValue().GetString() != "y" || inner.Next() )
+    {
+        std::cout << "Did not read the array /a~0b~1c/1/x\n";
+        return false;
+    }
+    tinyjson::JsonArrayReader records(json.c_str(),json.size(),"/records");
+    std::vector<tinyjson::JsonValue> taken;
+    while( records.Next() )
+    {
+        taken.push_back(records.TakeValue());
+    }
+    if( taken.size() != 3 || taken[1]["id"].GetInt() != 2 || taken[2].GetInt() != 3 )
+    {
+        std::cout << "Did not read the array /records\n";
+        return false;
+    }
+
+    // A long export read from a stream, with an element longer than a block.
+    std::string exported = "[";
+    const size_t recordCount = 100000;
+    for( size_t n = 0 ; n < recordCount ; n++ )
+    {
+        exported += (n ? "," : "") + std::string("{\"id\":") + std::to_string(n) + ",\"name\":\"record " + std::to_string(n) + "\"}";
+    }
+    exported += ",\"" + std::string(tinyjson::JsonReformatter::BLOCK_SIZE * 3,'x') + "\"]";
+    std::stringstream in(exported);
+    auto readStart = std::chrono::steady_clock::now();
+    tinyjson::JsonArrayReader reader(in);
+    size_t idTotal = 0,count = 0;
+    while( reader.Next() && reader.GetValue().GetType() == tinyjson::JsonValueType::OBJECT )
+    {
+        idTotal += size_t(reader.GetValue()["id"].GetInt64());
+        count++;
+    }
+    auto readEnd = std::chrono::steady_clock::now();
+    const std::chrono::duration<float,std::milli> readTime = readEnd - readStart;
+    std::cout << recordCount << " records read from a stream in " << readTime.count() << "ms\n";
+    if( count != recordCount || idTotal != recordCount * (recordCount - 1) / 2 || reader.GetValue().GetString().size() != tinyjson::JsonReformatter::BLOCK_SIZE * 3 )
+    {
+        std::cout << "Read " << count << " of the exported records\n";
+        return false;
+    }
+
+    // Pointers to nothing, and arrays or elements that are not valid json.
+    const std::vector<std::pair<std::string,std::string>> bad = {
+        {json,"/missing"},{json,"/a~0b~1c/2"},{json,"/skip/s"},{"[1,2,]",""},{"[1 2]",""},{"[1,{\"a\":}]",""},{"[1,[2",""},{"{\"a\":1}",""}
+    };
+    for( const auto& test : bad )
+    {
+        try
+        {
+            tinyjson::JsonArrayReader reader(test.first,test.second);
+            while( reader.Next() )
+            {
+            }
+            std::cout << "Read the array " << test.second << " of " << test.first << "\n";
+            return false;
+        }
+        catch( const std::exception& e )
+        {
+            std::cout << "Array reader error trapped correctly, " << e.what() << '\n';
+        }
+    }
+
+    // Errors blocks into a stream, in an element and between them, are at the line and column of the whole json.
+    std::string lines = "[\n";
+    for( int n = 0 ; n < 20000 ; n++ )
+    {
+        lines += "    {\"a\":1},\n";
+    }
+    for( const char* last : {"    {\"a\":}]","    {\"a\":1} 2]"} )
+    {
+        try
+        {
+            std::stringstream in(lines + last);
+            tinyjson::JsonArrayReader reader(in);
+            while( reader.Next() )
+            {
+            }
+            std::cout << "Read the array with an error on its last line\n";
+            return false;
+        }
+        catch( const std::exception& e )
+        {
+            std::cout << "Array reader error trapped correctly, " << e.what() << '\n';
+            if( strstr(e.what(),"Line 20002 column") == nullptr )
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks that parsing with a thread pool gives the same tree as parsing on one thread, and the same errors.
+ */
+static bool TestParallelParsing()
+{
+    std::cout << "Testing parallel parsing\n";
+
+    tinyjson::JsonThreadPool pool(4);
+
+    // Strings full of brackets, commas, quotes and escapes so that the chunks often start in the middle of a string.
+    std::string tricky = "{\"records\":[";
+    for( int n = 0 ; n < 30000 ; n++ )
+    {
+        tricky += n ? "," : "";
+        tricky += "{\"id\":" + std::to_string(n) + ",\"text\":\"[not, an {array}] \\\" \\\\\",\"nested\":[[1,2],[\"a,b\",\"]\"],[]]}";
+    }
+    tricky += "],\"end\":true}";
+
+    const std::vector<std::string> documents = {LoadFileIntoString("canada.json"),LoadFileIntoString("sample.json"),tricky};
+    for( const auto& jsonString : documents )
+    {
+        auto frameStart = std::chrono::steady_clock::now();
+        tinyjson::JsonProcessor parallel(jsonString,pool);
+        auto frameEnd = std::chrono::steady_clock::now();
+        tinyjson::JsonProcessor sequential(jsonString);
+        auto sequentialEnd = std::chrono::steady_clock::now();
+
+        std::cout << "Parallel " << std::chrono::duration<float,std::milli>(frameEnd - frameStart).count() << "ms, ";
+        std::cout << "sequential " << std::chrono::duration<float,std::milli>(sequentialEnd - frameEnd).count() << "ms\n";
+        if( !IsSameJson(parallel.GetRoot(),sequential.GetRoot()) )
+        {
+            std::cout << "Parallel parse did not match sequential parse\n";
+            return false;
+        }
+    }
+
+    // Errors in a big document must still be found.
+    std::string broken = tricky;
+    broken[broken.size() / 2] = '}';
+    try
+    {
+        tinyjson::JsonProcessor json(broken,pool);
+        std::cout << "A broken document passed the parallel parse!\n";
+        return false;
+    }
+    catch( std::runtime_error &e )
+    {
+        std::cerr << "Parallel parse error trapped correctly, " << e.what() << '\n';
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks a processor that is used for many parses gives the same trees as a new processor each time.
+ * The documents change shape so that the memory kept from one parse is used for different values in the next.
+ */
+static bool TestReusableProcessor()
+{
+    std::cout << "Testing reusable processor\n";
+
+    const std::vector<std::string> documents =
+    {
+        LoadFileIntoString("weather.json"),
+        LoadFileIntoString("sample.json"),
+        "{\"a long key that will not fit in a small string\":\"a long value that will not fit in a small string\",\"b\":[1,2,3],\"c\":{}}",
+        "[\"\",{\"a long key that will not fit in a small string\":\"\"},[],[[]],\"\"]",
+        LoadFileIntoString("canada.json"),
+        "{\"b\":[\"x\"],\"b\":[\"y\"]}"
+    };
+
+    tinyjson::JsonProcessor reused;
+    for( int pass = 0 ; pass < 3 ; pass++ )
+    {
+        for( const auto& jsonString : documents )
+        {
+            tinyjson::JsonProcessor fresh(jsonString);
+            if( !IsSameJson(reused.Parse(jsonString),fresh.GetRoot()) )
+            {
+                std::cout << "Reused processor gave a different tree\n";
+                return false;
+            }
+        }
+
+        // A failed parse must not stop the processor being used again.
+        try
+        {
+            reused.Parse("{\"a\":[1,2,{\"b\":\"c\"}");
+            std::cout << "A broken document passed the reused processor!\n";
+            return false;
+        }
+        catch( std::runtime_error &e ){}
+
+        try
+        {
+            reused.Parse("{\"a\":1,\"a\":2}",true);
+            std::cout << "A duplicate key passed the reused processor!\n";
+            return false;
+        }
+        catch( std::runtime_error &e ){}
+    }
+
+    reused.ReleaseMemory();
+    if( reused.Parse(documents[2])["b"][2].GetInt() != 3 )
+    {
+        std::cout << "Reused processor failed after releasing its memory\n";
+        return false;
+    }
+
+    // With a pool the elements are parsed by other processors, the memory kept must still stay at one tree.
+    std::string big = "[";
+    for( int n = 0 ; n < 20000 ; n++ )
+    {
+        big += n ? "," : "";
+        big += "{\"name\":\"a name that will not fit in a small string " + std::to_string(n) + "\",\"values\":[1,2,3]}";
+    }
+    big += "]";
+
+    tinyjson::JsonThreadPool pool(4);
+    tinyjson::JsonProcessor pooled;
+    pooled.EnableStatistics();
+    size_t firstSpare = 0;
+    for( int pass = 0 ; pass < 6 ; pass++ )
+    {
+        if( pooled.Parse(big,pool).GetArraySize() != 20000 )
+        {
+            std::cout << "Reused processor with a pool gave the wrong tree\n";
+            return false;
+        }
+        // The first parse has nothing to reuse and the second is the first with spares, after that it must not grow.
+        if( pass == 2 )
+        {
+            firstSpare = pooled.GetStatistics().mSpareBytes;
+        }
+        else if( pass > 2 && pooled.GetStatistics().mSpareBytes > firstSpare )
+        {
+            std::cout << "Reused processor with a pool kept " << pooled.GetStatistics().mSpareBytes << " spare bytes, was " << firstSpare << "\n";
+            return false;
+        }
+    }
+    if( pooled.GetStatistics().mReused == 0 )
+    {
+        std::cout << "Reused processor with a pool did not use its spares\n";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks readers on other threads always see a whole version of a document whilst new versions are published.
+ */
+static bool TestSharedDocuments()
+{
+    std::cout << "Testing shared documents\n";
+
+    auto makeVersion = [](int pVersion)
+    {
+        std::string json = "{\"version\":" + std::to_string(pVersion) + ",\"values\":[";
+        for( int n = 0 ; n < pVersion ; n++ )
+        {
+            json += n ? "," : "";
+            json += std::to_string(pVersion);
+        }
+        return json + "]}";
+    };
+
+    tinyjson::JsonDocumentHolder config(tinyjson::JsonDocument::Parse(makeVersion(1)));
+    std::atomic<bool> stop(false);
+    std::atomic<int> errors(0);
+
+    std::vector<std::thread> readers;
+    for( int n = 0 ; n < 4 ; n++ )
+    {
+        readers.emplace_back([&config,&stop,&errors]()
+        {
+            tinyjson::JsonDocumentHolder::Reader reader(config);
+            while( !stop )
+            {
+                const tinyjson::JsonValue& root = reader.Get().GetRoot();
+                const int version = root["version"].GetInt();
+                if( int(root["values"].GetArraySize()) != version || root["values"][version-1].GetInt() != version )
+                {
+                    errors++;
+                }
+            }
+        });
+    }
+
+    for( int version = 2 ; version < 200 ; version++ )
+    {
+        config.Parse(makeVersion(version));
+    }
+
+    // The readers are stopped first, the change below makes a version they would count as an error.
+    stop = true;
+    for( auto& reader : readers )
+    {
+        reader.join();
+    }
+
+    // A copy on write change must not touch a version someone is still holding.
+    const tinyjson::JsonDocument before = config.Get();
+    config.Update([](tinyjson::JsonValue& rRoot){rRoot["values"].mArray.clear();});
+
+    if( errors > 0 || before["values"].GetArraySize() != 199 || config.Get()["values"].GetArraySize() != 0 || config.GetVersion() != 199 )
+    {
+        std::cout << "Shared document test failed\n";
+        return false;
+    }
+
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     std::cout << "Unit test app for TinyJson build by appbuild.\n";
@@ -682,6 +2886,7 @@ int main(int argc, char *argv[])
 
     const std::vector<bool(*)()> tests = {
         TestBasicFormats,
+        TestParsingFromMemorySlice,
         TestRootTypes,
         TestBasicTypesWork,
         TestThatIncorrectTypeRequestsWork,
@@ -691,7 +2896,28 @@ int main(int argc, char *argv[])
         RunningUnitTestFiles,
         LargeComplexJsonFileTest,
         TimedTestedAgainstVeryLargeCanadaFile,
-        TestForDuplicateKeyDiscovery
+        TestForDuplicateKeyDiscovery,
+        TestJsonLines,
+        TestParallelParsing,
+        TestSharedDocuments,
+        TestReusableProcessor,
+        TestBuildingJson,
+        TestStreamWriter,
+        TestStructBinding,
+        TestKeySet,
+        TestSchemaValidation,
+        TestNestingDepth,
+        TestDeepTrees,
+        TestMemoryStatistics,
+        TestParseProfile,
+        TestCbor,
+        TestFrozenDocuments,
+        TestDocumentCache,
+        TestJsonPatch,
+        TestValueHashing,
+        TestCanonicalWriter,
+        TestReformatter,
+        TestArrayReader
     };
 
     for( auto& test : tests )